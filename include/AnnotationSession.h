@@ -0,0 +1,100 @@
+#pragma once 
+
+#include <cstdint>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <string>
+#include <vector>
+#include "ImageBuffer.h"
+
+namespace cam_cad { 
+
+/**
+ * @brief Class for annotating a CAD drawing with any number of defect layers 
+ * Note: to use: 
+ * 1. create session instance
+ * 2. call open() with the unannotated drawing (decoded once)
+ * 3. call any of addPoints(), addPolyline() or addPolygon() for each defect layer
+ * 4. call write() to encode the annotated drawing (encoded once)
+ */
+class AnnotationSession { 
+public: 
+
+  /**
+   * @brief Empty constructor
+   */
+    AnnotationSession (); 
+
+  /**
+   * @brief Default destructor
+   */
+    ~AnnotationSession () = default;
+
+  /**
+   * @brief Method for loading the unannotated image that layers are drawn onto
+   * @param src_file_name_ absolute path of the unannotated image
+   * @return read success
+   */
+    bool open (std::string src_file_name_);
+
+  /**
+   * @brief Method for adding a layer of single pixels, points outside of the image are skipped
+   * @param points_ 2D point set 
+   * @param color_ color to set pixels in output image (default = "black", options = "red", "green", "blue")
+   * @return true if the session has an image to draw onto
+   */
+    bool addPoints (std::vector<point>* points_, std::string color_ = "black");
+
+  /**
+   * @brief Method for adding a polyline layer connecting the points in order
+   * @param points_ 2D point set (polyline vertices)
+   * @param color_ line color (default = "black", options = "red", "green", "blue")
+   * @param thickness_ line thickness in pixels
+   * @param closed_ if set to true, the last point is connected back to the first
+   * @return true if the session has an image to draw onto
+   */
+    bool addPolyline (std::vector<point>* points_, std::string color_ = "black", 
+                      uint16_t thickness_ = 1, bool closed_ = false);
+
+  /**
+   * @brief Method for adding a filled polygon layer 
+   * @param points_ 2D point set (polygon vertices)
+   * @param color_ fill color (default = "black", options = "red", "green", "blue")
+   * @return true if the session has an image to draw onto
+   */
+    bool addPolygon (std::vector<point>* points_, std::string color_ = "black");
+
+  /**
+   * @brief Method for encoding the annotated image with all layers added so far
+   * @param target_file_name_ absolute path of the annotated image to create
+   * @return write success 
+   */
+    bool write (std::string target_file_name_);
+
+  /**
+   * @brief Accessor method to retrieve the number of layers drawn in this session
+   */
+    uint32_t getNumLayers ();
+
+  /**
+   * @brief Accessor methods to retrieve the size of the loaded image in pixels (0 if no image is loaded)
+   */
+    uint32_t getWidth ();
+    uint32_t getHeight ();
+
+  /**
+   * @brief Method for converting a color name to the pixel value written to the image
+   * @param color_ color name (options = "black", "red", "green", "blue", unknown names map to black)
+   */
+    static cv::Vec3b getColor (std::string color_);
+
+private: 
+
+    std::vector<cv::Point> toPixels (std::vector<point>* points_);
+
+    cv::Mat image;
+    uint32_t num_layers;
+
+};
+
+}
@@ -0,0 +1,297 @@
+#pragma once 
+
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <Eigen/Dense>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include "ImageBuffer.h"
+#include "EdgeMap.h"
+#include "AnnotationSession.h"
+#include "VectorWriter.h"
+#include "Solver.h"
+#include "JointSolver.h"
+#include "CADCache.h"
+#include "SolutionCache.h"
+#include "util.h"
+
+namespace cam_cad { 
+
+/**
+ * @brief Struct for the result and per-stage timing of one batch job
+ */
+struct BatchJobResult { 
+    std::string id;
+    bool success;
+    bool converged;
+    std::string error;
+    Eigen::Matrix4d T_CS;
+    double initial_pixel_error, final_pixel_error;
+    int solution_iterations;
+    bool cached;                        // solution looked up in the solution cache instead of solved
+    uint32_t num_defects;
+    uint32_t num_defect_points;
+    uint32_t num_dropped_points;        // defect pixels that could not be back projected onto the structure
+    uint32_t num_simplified_points;
+    bool joint_refined;
+    double read_ms, solve_ms, transfer_ms, write_ms, total_ms;
+
+    BatchJobResult () {
+        success = false;
+        converged = false;
+        T_CS = Eigen::Matrix4d::Identity();
+        initial_pixel_error = 0;
+        final_pixel_error = 0;
+        solution_iterations = 0;
+        cached = false;
+        num_defects = 0;
+        num_defect_points = 0;
+        num_dropped_points = 0;
+        num_simplified_points = 0;
+        joint_refined = false;
+        read_ms = 0;
+        solve_ms = 0;
+        transfer_ms = 0;
+        write_ms = 0;
+        total_ms = 0;
+    }
+};
+
+/**
+ * @brief Struct for the result of the joint refinement of the jobs of one CAD face
+ */
+struct BatchJointResult { 
+    std::string CAD_labels;
+    uint32_t num_images;
+    bool converged;
+    double cloud_scale;                 // refined CAD scale used for the defect transfer
+    double initial_pixel_error, final_pixel_error;
+    int solution_iterations;
+    double solve_ms;
+
+    BatchJointResult () {
+        num_images = 0;
+        converged = false;
+        cloud_scale = 0;
+        initial_pixel_error = 0;
+        final_pixel_error = 0;
+        solution_iterations = 0;
+        solve_ms = 0;
+    }
+};
+
+/**
+ * @brief Struct for the state a job keeps between its pose solution and its outputs
+ */
+struct BatchJobState { 
+    bool solved;
+    std::shared_ptr<Util> util;                            // camera model and CAD offset of the job
+    std::shared_ptr<const PreparedCAD> CAD;
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud; // finest camera cloud solved
+    Eigen::Matrix4d T_CS_measured;                         // initial pose, before the solution
+    double cloud_scale;
+
+    BatchJobState () {
+        solved = false;
+        T_CS_measured = Eigen::Matrix4d::Identity();
+        cloud_scale = 0;
+    }
+};
+
+/**
+ * @brief Class to run pose estimation and defect transfer for every job in a manifest 
+ * in parallel and collect the results
+ * 
+ * The manifest is a json file of the form (see config/example_manifest.json): 
+ * {
+ *   "solution_parameters": path to SolutionParameters.json, 
+ *   "workers": number of parallel workers (optional, default = number of cores),
+ *   "results": path of the results file to write (optional),
+ *   "camera_density": densify index for camera labels (optional, default = 10),
+ *   "CAD_density": densify index for CAD labels (optional, default = 2),
+ *   "simplify_tolerance": largest deviation in pixels allowed when removing near-collinear label 
+ *                         points before densifying them (optional, default = 0 keeps every point, 
+ *                         see ImageBuffer::simplifyPoints),
+ *   "recordings": directory to save the solver recording of every job that does not converge 
+ *                 to, as <id>.rec (optional, see SolveRecorder.h),
+ *   "record_iterations": number of iterations kept per recording (optional, default = 32),
+ *   "renderings": existing directory to render the iterations of every job to without a display 
+ *                 (optional, see ConvergenceRenderer.h), as <id>/ png sequences or <id>.<format> videos,
+ *   "rendering_format": "png", "avi" or "mp4" (optional, default = "png"),
+ *   "edge_map": edge extraction settings for jobs with a "camera_image" (optional, see EdgeMapParameters),
+ *   "joint_refinement": after the independent solutions, refine the poses of all jobs of a CAD face 
+ *                       together with their shared CAD scale before the defects are transferred, 
+ *                       "refine_intrinsics" of the solution parameters is ignored 
+ *                       (optional, default = false, see JointSolver.h),
+ *   "joint_min_images": smallest number of solved jobs of a CAD face refined jointly (optional, default = 2),
+ *   "solution_cache": solution cache file, read before and written after the run; jobs whose 
+ *                     inputs are unchanged are looked up instead of solved, only converged 
+ *                     solutions are cached and an unreadable file is ignored (optional, see 
+ *                     SolutionCache.h and SolutionKey),
+ *   "solution_cache_size": largest number of cached solutions, the least recently used are 
+ *                          evicted (optional, default = 10000),
+ *   "jobs": [
+ *     {
+ *       "id": job name, 
+ *       "camera_labels": camera image label file, 
+ *       "camera_image": unlabelled camera image, its edges are used instead of "camera_labels" 
+ *                       and solved from the coarsest to the finest level (see EdgeMap.h),
+ *       "roi": [x, y, width, height] region of interest of the camera image (optional),
+ *       "CAD_labels": CAD drawing label file,
+ *       "camera_model": camera model file (optional, default from solution parameters),
+ *       "camera_id": ladybug camera ID (optional),
+ *       "initial_pose": euler angle - translation pose file (optional, see Solver::LoadInitialPose) 
+ *       "robot_pose", "structure_pose": T_CW and T_WS pose files (optional, instead of initial_pose),
+ *       "camera_robot_pose": additional transform applied to the initial pose (optional),
+ *       "T_CS": row major 4x4 initial transform (optional, instead of the pose files),
+ *       "defect_labels": label file with the defect outlines to transfer, every shape is 
+ *                        transferred (optional),
+ *       "CAD_image": unannotated CAD drawing (optional), 
+ *       "output_image": annotated CAD drawing to write (optional, requires CAD_image),
+ *       "output_vector": SVG/DXF defect overlay to write, sized to the "CAD_image" or else to the 
+ *                        imageWidth and imageHeight of the "CAD_labels" (optional),
+ *       "output_defects": json file to write the label, ID and CAD pixels of every defect to (optional),
+ *       "output_pose": json file to write the solved T_CS to (optional)
+ *     }
+ *   ]
+ * }
+ * Relative paths are resolved with respect to the directory of the manifest.
+ */
+class BatchRunner { 
+public: 
+
+  /**
+   * @brief Empty constructor
+   */
+    BatchRunner (); 
+
+  /**
+   * @brief Default destructor
+   */
+    ~BatchRunner () = default;
+
+  /**
+   * @brief Method to read the job manifest 
+   * @param manifest_file_name_ absolute path to the manifest json file 
+   * @return read success 
+   */
+    bool ReadManifest (std::string manifest_file_name_);
+
+  /**
+   * @brief Setter method to override the number of parallel workers given in the manifest
+   * @param num_workers_ number of workers (0 = number of cores)
+   */
+    void SetNumWorkers (uint16_t num_workers_);
+
+  /**
+   * @brief Method to run all jobs of the manifest on the configured number of workers 
+   * @return true if every job completed (solution convergence is reported per job)
+   */
+    bool Run ();
+
+  /**
+   * @brief Method to run a single job 
+   * @param job_ job entry of the manifest 
+   * @return job result 
+   */
+    BatchJobResult RunJob (const nlohmann::json& job_, std::shared_ptr<SolverWorkspace> workspace_);
+
+  /**
+   * @brief Method to run the reading and pose solution of a single job 
+   * @param job_ job entry of the manifest 
+   * @param workspace_ workspace of the worker
+   * @param state_ receives what the outputs of the job need, solved is false if the job failed
+   * @return job result 
+   */
+    BatchJobResult SolveJob (const nlohmann::json& job_, std::shared_ptr<SolverWorkspace> workspace_, 
+                             BatchJobState* state_);
+
+  /**
+   * @brief Method to run the defect transfer and write the outputs of a solved job 
+   * @param job_ job entry of the manifest 
+   * @param state_ state of the job after SolveJob (and the joint refinement)
+   * @param result_ job result to complete 
+   */
+    void OutputJob (const nlohmann::json& job_, const BatchJobState& state_, BatchJobResult* result_);
+
+  /**
+   * @brief Method to refine the solved jobs of each CAD face jointly (see JointSolver.h), 
+   * updates the poses and convergence of the results and the CAD scale of the states
+   * @param states_ states of all jobs of the manifest, in manifest order
+   */
+    void RefineJointly (std::vector<BatchJobState>& states_);
+
+  /**
+   * @brief Method to write the machine readable results of the last run 
+   * @param results_file_name_ absolute path of the results json file, if empty the 
+   * "results" path of the manifest is used
+   * @return write success
+   */
+    bool WriteResults (std::string results_file_name_ = "");
+
+  /**
+   * @brief Accessor method to retrieve the results of the last run (in manifest order)
+   */
+    const std::vector<BatchJobResult>& GetResults ();
+
+  /**
+   * @brief Accessor method to retrieve the joint refinement results of the last run, one per CAD face
+   */
+    const std::vector<BatchJointResult>& GetJointResults ();
+
+  /**
+   * @brief Accessor method to retrieve the solution cache, e.g. for its hit and miss counts
+   */
+    SolutionCache& GetSolutionCache ();
+
+private: 
+
+    std::string ResolvePath (std::string path_);
+
+    bool LoadPose (Solver& solver_, const nlohmann::json& job_);
+
+    // reads the "imageWidth" and "imageHeight" of a labelme file, false if either is missing
+    bool ReadImageSize (std::string labels_file_, uint32_t* width_, uint32_t* height_);
+
+    // reads the hash, camera model and CAD scale of the solution parameters once per run, so 
+    // solutions are looked up without constructing a solver
+    bool ReadCacheParameters ();
+
+    // hash of every input of the pose solution of a job, computed from the job's files and 
+    // parameters before any of them is read: the camera labels (or image and edge settings), the 
+    // CAD labels and their preparation, the camera model and ID, the initial pose inputs and the 
+    // solution parameters
+    bool SolutionKey (const nlohmann::json& job_, uint64_t& key_);
+
+    nlohmann::json manifest;
+    std::string manifest_dir, solution_parameters_file, results_file, recordings_dir;
+    std::string renderings_dir, rendering_format;
+    uint32_t record_iterations;
+    uint16_t num_workers;
+    uint8_t camera_density, CAD_density;
+    float simplify_tolerance;
+    EdgeMapParameters edge_map_parameters;
+    bool joint_refinement;
+    uint32_t joint_min_images;
+    std::string solution_cache_file;
+    bool cache_parameters_read;
+    uint64_t cache_parameters_hash;
+    std::string cache_camera_model;
+    double cache_cloud_scale;
+
+    std::vector<BatchJobResult> results;
+    std::vector<BatchJointResult> joint_results;
+    double wall_time_ms;
+
+    CADCache CAD_cache;
+    SolutionCache solution_cache;
+
+};
+
+}
@@ -0,0 +1,97 @@
+#pragma once 
+
+#include <cstdint>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <fstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "ImageBuffer.h"
+#include "util.h"
+
+namespace cam_cad { 
+
+/**
+ * @brief Struct for a CAD cloud that has been read, densified, centered on the origin and scaled 
+ * Note: prepared clouds are shared between solvers and threads and must not be modified
+ */
+struct PreparedCAD { 
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud;        // centered, CAD pixel units
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr scaled_cloud; // centered, cloud * scale
+    double offset_x, offset_y;                             // offset removed by Util::originCloudxy
+    double scale;                                          
+    uint8_t density;
+    float simplify_tolerance;                              // see ImageBuffer::simplifyPoints
+    size_t num_simplified;                                 // label points removed by the simplification
+    uint64_t hash;                                         // hash of the label file and parameters
+};
+
+/**
+ * @brief Class for caching prepared CAD clouds so that each CAD face is only prepared once 
+ * Clouds are keyed by a hash of the label file contents and the preprocessing parameters, so an 
+ * edited label file is prepared again even if its path is unchanged. Get() can be called from 
+ * any number of threads; when several threads request the same cloud, one prepares it and 
+ * the others wait for the result.
+ */
+class CADCache { 
+public: 
+
+  /**
+   * @brief Empty constructor
+   */
+    CADCache (); 
+
+  /**
+   * @brief Default destructor
+   */
+    ~CADCache () = default;
+
+  /**
+   * @brief Method to get a prepared CAD cloud, preparing it if it is not in the cache 
+   * @param CAD_labels_file_ absolute path to the CAD label json file 
+   * @param density_ densify index (see ImageBuffer::densifyPoints)
+   * @param scale_ scale applied to the centered cloud (see Solver cloud_scale)
+   * @param simplify_tolerance_ largest deviation in CAD pixels allowed when simplifying the labels 
+   * before densifying them (see ImageBuffer::simplifyPoints), 0 to keep every label point
+   * @return prepared CAD cloud, nullptr if the label file can not be read
+   */
+    std::shared_ptr<const PreparedCAD> Get (std::string CAD_labels_file_, uint8_t density_, double scale_, 
+                                            float simplify_tolerance_ = 0);
+
+  /**
+   * @brief Method to remove all cached clouds, clouds still held by callers remain valid
+   */
+    void Clear ();
+
+  /**
+   * @brief Accessor method to retrieve the number of cached clouds
+   */
+    size_t GetSize ();
+
+  /**
+   * @brief Accessor method to retrieve the number of times a cloud has been prepared (cache misses)
+   */
+    uint64_t GetNumPrepared ();
+
+  /**
+   * @brief Method to compute the 64 bit FNV-1a hash of a string 
+   * @param data_ data to hash
+   * @param seed_ hash to continue from (to hash several strings in sequence)
+   */
+    static uint64_t Hash (const std::string& data_, uint64_t seed_ = 14695981039346656037ULL);
+
+private: 
+
+    std::shared_ptr<const PreparedCAD> Prepare (std::string CAD_labels_file_, uint8_t density_, 
+                                                double scale_, float simplify_tolerance_, uint64_t hash_);
+
+    std::map<uint64_t, std::shared_future<std::shared_ptr<const PreparedCAD>>> cache;
+    std::mutex mtx;
+    uint64_t num_prepared;
+
+};
+
+}
@@ -0,0 +1,76 @@
+#pragma once 
+
+#include <beam_calibration/CameraModel.h>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace cam_cad { 
+
+/**
+ * @brief Process wide registry of camera models, each calibration file (and ladybug camera ID) 
+ * is read from disk once and the same model is shared by every solver and utility object
+ * 
+ * Thread safety: 
+ * - Get(), GetNumLoaded() and Clear() can be called from any number of threads. When several 
+ *   threads request a model that is not loaded yet, one thread reads it and the others wait. 
+ * - Shared models are never modified after Get(). Concurrent projection and back projection 
+ *   (ProjectPoint, ProjectPointPrecise, BackProject) on the same model has only been checked for 
+ *   the analytic json models (RADTAN, used by the batch and pose estimator tests), whose 
+ *   projections only read the intrinsics. Other models, ladybug in particular, have not been 
+ *   checked and may keep state in the calibration library while projecting; run their batches 
+ *   with one worker (-j 1) until they are. 
+ * - SetCameraID (or any other setter) must NOT be called on a shared model. The camera ID is 
+ *   part of the registry key instead: Get(file, ID) returns a model with that camera selected, 
+ *   and Util::SetCameraID swaps its handle rather than modifying the shared model. 
+ * - Because the selected camera is state of the model, every ladybug camera ID is a separate 
+ *   full model read from the same file: a job set that uses all 6 cameras holds 6 copies of the 
+ *   calibration. Each copy is still read once per process, so the memory grows with the number 
+ *   of distinct camera IDs used and not with the number of jobs; Clear() releases the copies 
+ *   once no solver holds them. 
+ */
+class CameraModelRegistry { 
+public: 
+
+  /**
+   * @brief Accessor method to retrieve the process wide registry
+   */
+    static CameraModelRegistry& GetInstance ();
+
+  /**
+   * @brief Method to get the shared model for a calibration file, reading it on first use 
+   * @param intrinsics_file_path_ absolute path to the camera configuration file
+   * @param cam_ID_ camera ID to select (ladybug only), a negative value leaves the default camera
+   * @return shared read-only camera model, nullptr if it could not be created
+   */
+    std::shared_ptr<beam_calibration::CameraModel> Get (std::string intrinsics_file_path_, 
+                                                        int16_t cam_ID_ = -1);
+
+  /**
+   * @brief Method to drop all models from the registry, models still held by callers remain valid
+   */
+    void Clear ();
+
+  /**
+   * @brief Accessor method to retrieve the number of models read from disk so far, reads that 
+   * failed are not counted
+   */
+    uint32_t GetNumLoaded ();
+
+private: 
+
+    CameraModelRegistry ();
+
+    CameraModelRegistry (const CameraModelRegistry&) = delete;
+    CameraModelRegistry& operator= (const CameraModelRegistry&) = delete;
+
+    std::map<std::string, std::shared_future<std::shared_ptr<beam_calibration::CameraModel>>> models;
+    std::mutex mtx;
+    uint32_t num_loaded;
+
+};
+
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/correspondence.h>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cam_cad {
+
+/**
+ * @brief Struct for one solver iteration queued for rendering
+ */
+struct RenderFrame {
+    uint32_t session;
+    uint32_t iteration;                 // 0 = initial pose
+    double pixel_error;
+    std::shared_ptr<const std::vector<cv::Point2f>> camera_points; // shared by the session
+    std::vector<cv::Point2f> proj_points;
+    std::vector<std::pair<uint32_t, uint32_t>> corrs;   // projected index, camera index
+};
+
+/**
+ * @brief Class rendering the solver iterations (camera cloud, projected CAD cloud and
+ * correspondences) into images without a display, for batch servers and documentation
+ *
+ * The solver thread only copies the projected points and correspondences of an iteration into
+ * a bounded queue (Render never blocks on drawing or encoding, a frame is dropped and counted
+ * when the queue is full). A background thread draws the frames with OpenCV and encodes them
+ * either as a PNG sequence or as a video:
+ * - output ending in ".avi" (MJPG) or ".mp4" (mp4v): one video for all sessions of the renderer
+ * - any other output is a directory receiving <session>_<iteration>.png
+ *
+ * Frames are drawn in camera pixels scaled down so the longer image side is at most max_size_
+ * pixels: the camera cloud in white, correspondences in green and the projected CAD cloud in red.
+ */
+class ConvergenceRenderer {
+public:
+
+  /**
+   * @brief Constructor, starts the encoder thread
+   * @param output_ video file (.avi or .mp4) or directory (created if missing) to write to
+   * @param max_size_ maximum rendered image width / height in pixels
+   * @param queue_size_ maximum number of frames waiting to be encoded
+   * @param fps_ frame rate of a video output
+   */
+    ConvergenceRenderer (std::string output_, uint16_t max_size_ = 1024,
+                         uint32_t queue_size_ = 16, double fps_ = 4);
+
+  /**
+   * @brief Destructor, encodes the queued frames and stops the encoder thread
+   */
+    ~ConvergenceRenderer ();
+
+  /**
+   * @brief Method to start rendering a new solution
+   * @param camera_cloud_ image label cloud the solution is run against
+   * @param image_width_ camera image width in pixels
+   * @param image_height_ camera image height in pixels
+   */
+    void BeginSession (pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_,
+                       uint32_t image_width_, uint32_t image_height_);
+
+  /**
+   * @brief Method to queue one solver iteration for rendering, never blocks on encoding
+   * @param iteration_ solver iteration (0 for the initial pose)
+   * @param pixel_error_ average pixel error of the projection
+   * @param proj_cloud_ projected CAD cloud
+   * @param corrs_ correspondences between the projected and camera cloud
+   * @return false if the frame was dropped
+   */
+    bool Render (uint32_t iteration_, double pixel_error_,
+                 pcl::PointCloud<pcl::PointXYZ>::ConstPtr proj_cloud_,
+                 pcl::CorrespondencesConstPtr corrs_);
+
+  /**
+   * @brief Method to wait until every queued frame is encoded and close the output,
+   * called by the destructor, no frames can be rendered afterwards
+   */
+    void Close ();
+
+  /**
+   * @brief Accessor method to retrieve the number of frames written so far
+   */
+    uint32_t GetNumWritten ();
+
+  /**
+   * @brief Accessor method to retrieve the number of frames dropped because the queue was full
+   * or the output could not be written
+   */
+    uint32_t GetNumDropped ();
+
+private:
+
+    void Encode ();
+
+    void Draw (const RenderFrame& frame_, cv::Mat& image_);
+
+    bool Write (const RenderFrame& frame_, const cv::Mat& image_);
+
+    std::string output;
+    bool video_output;
+    uint16_t max_size;
+    uint32_t queue_size;
+    double fps;
+
+    // session state, solver thread only
+    uint32_t session;
+    std::shared_ptr<const std::vector<cv::Point2f>> camera_points;
+
+    // image geometry of the current session, read by the encoder with each frame
+    struct Geometry { uint32_t width, height; double scale; };
+    std::deque<std::pair<Geometry, RenderFrame>> queue;
+    Geometry geometry;
+
+    cv::VideoWriter writer;
+    cv::Size video_size;
+
+    std::atomic<uint32_t> num_written, num_dropped;
+    std::mutex mtx;
+    std::condition_variable cv_queue;
+    bool closing;
+    std::thread encoder;
+
+};
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ImageBuffer.h"
+
+namespace cam_cad {
+
+/**
+ * @brief Struct for the edge extraction settings of an EdgeMap
+ */
+struct EdgeMapParameters {
+    double canny_low = 50;              // Canny hysteresis thresholds
+    double canny_high = 150;
+    double blur_sigma = 1.0;            // gaussian blur before Canny, 0 = none
+    cv::Rect roi;                       // region of interest in pixels, empty = whole image
+    uint32_t max_points = 4000;         // maximum number of points kept per level
+    uint8_t num_levels = 3;             // pyramid levels, each half the resolution of the previous
+
+    EdgeMapParameters () = default;
+
+  /**
+   * @brief Constructor from json, missing keys keep their defaults:
+   * {"canny_low", "canny_high", "blur_sigma", "max_points", "levels", "roi": [x, y, width, height]}
+   */
+    EdgeMapParameters (const nlohmann::json& J_);
+};
+
+/**
+ * @brief Class extracting the edge pixels of an unlabelled camera image as camera points,
+ * instead of hand labelled outlines
+ *
+ * The image (restricted to the region of interest) is reduced into a pyramid of num_levels
+ * resolutions, level 0 being the full resolution. Canny edges are extracted at every level
+ * and subsampled on a grid so that at most max_points are kept per level: one edge pixel is
+ * kept per grid cell, which keeps the points evenly spread along the edges instead of
+ * weighting dense (textured) regions more heavily. Coarse levels hold the large outlines with
+ * few points and are used to converge from a poor initial pose, the finer levels then refine it.
+ *
+ * All points are returned in full resolution image pixels, so every level can be used with the
+ * same camera model.
+ */
+class EdgeMap {
+public:
+
+  /**
+   * @brief Constructor
+   * @param params_ edge extraction settings
+   */
+    EdgeMap (EdgeMapParameters params_ = EdgeMapParameters());
+
+  /**
+   * @brief Default destructor
+   */
+    ~EdgeMap () = default;
+
+  /**
+   * @brief Method to read a camera image and extract its edge points at every level
+   * @param image_file_name_ absolute path to the camera image
+   * @return read success
+   */
+    bool Extract (std::string image_file_name_);
+
+  /**
+   * @brief Method to extract the edge points of an image at every level
+   * @param image_ camera image (grayscale or BGR)
+   * @return false if the image or the region of interest is empty
+   */
+    bool Extract (const cv::Mat& image_);
+
+  /**
+   * @brief Accessor method to retrieve the number of levels extracted, levels whose image
+   * would be smaller than 16 pixels are skipped
+   */
+    uint8_t GetNumLevels ();
+
+  /**
+   * @brief Method to get the subsampled edge points of a level in full resolution pixels
+   * @param level_ pyramid level (0 = full resolution)
+   * @param points_ vector the points are appended to
+   */
+    void GetPoints (uint8_t level_, std::vector<point>* points_);
+
+  /**
+   * @brief Accessor method to retrieve the number of edge pixels found at a level before subsampling
+   * @param level_ pyramid level (0 = full resolution)
+   */
+    size_t GetNumEdgePixels (uint8_t level_);
+
+private:
+
+    // keeps one edge pixel per grid cell, growing the cells until at most max_points remain
+    void Subsample (const std::vector<cv::Point>& edges_, int width_, int height_,
+                    double scale_, std::vector<point>& points_);
+
+    EdgeMapParameters params;
+
+    std::vector<std::vector<point>> levels;
+    std::vector<size_t> num_edge_pixels;
+
+};
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <beam_calibration/CameraModel.h>
+#include <Eigen/Dense>
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace cam_cad {
+
+/**
+ * @brief Class projecting camera frame points to pixels in single precision, the float32 fast
+ * path of the transform and projection kernel (see Util::SetFloatPrecision)
+ *
+ * beam_calibration camera models only project in double precision through a virtual call per
+ * point. For the camera types implemented here (RADTAN) the projection is evaluated inline in
+ * float instead, which the compiler can vectorize twice as wide. Pixel labels are integers, so
+ * the float rounding error (about 1e-4 px at 2048 px) is far below the label resolution.
+ *
+ * Init validates the float projection against the double camera model on a grid of rays
+ * covering the image and beyond it. A model of another type, or one whose projection does not
+ * match to within max_error_ pixels, leaves the projector invalid and the double path is used.
+ */
+class FloatProjector {
+public:
+
+  /**
+   * @brief Constructor, the projector is invalid until Init succeeds
+   */
+    FloatProjector ();
+
+  /**
+   * @brief Default destructor
+   */
+    ~FloatProjector () = default;
+
+  /**
+   * @brief Method to set up the projector for a camera model
+   * @param camera_model_ camera model to reproduce
+   * @param camera_model_file_ configuration file the model was read from (for the camera type)
+   * @param max_error_ largest pixel difference to the double projection accepted by the validation
+   * @return false if the camera type has no float implementation or the validation failed
+   */
+    bool Init (std::shared_ptr<beam_calibration::CameraModel> camera_model_,
+               std::string camera_model_file_, float max_error_ = 1e-2);
+
+  /**
+   * @brief Accessor method to check whether the projector reproduces the given camera model
+   * @param camera_model_ camera model in use
+   */
+    bool IsValidFor (const beam_calibration::CameraModel* camera_model_) const;
+
+  /**
+   * @brief Accessor method to retrieve the largest pixel difference to the double projection
+   * found by the last validation
+   */
+    float GetValidationError () const;
+
+  /**
+   * @brief Method to project a camera frame point to a pixel
+   * @param point_ point in the camera frame
+   * @param pixel_ receives the pixel
+   * @return false if the point is behind the camera or projects outside of the image
+   */
+    inline bool Project (const Eigen::Vector3f& point_, Eigen::Vector2f& pixel_) const {
+        if (!ProjectUnchecked(point_, pixel_)) return false;
+        if (!check_bounds) return true;
+        return pixel_[0] >= 0 && pixel_[1] >= 0 && pixel_[0] <= max_u && pixel_[1] <= max_v;
+    }
+
+private:
+
+    // projection without the image bounds check, false only behind the camera
+    inline bool ProjectUnchecked (const Eigen::Vector3f& point_, Eigen::Vector2f& pixel_) const {
+        if (point_[2] <= 0) return false;
+
+        float x = point_[0] / point_[2], y = point_[1] / point_[2];
+        float x2 = x * x, y2 = y * y, xy = x * y, r2 = x2 + y2;
+        float radial = k1 * r2 + k2 * r2 * r2;
+
+        float x_d = x + x * radial + 2 * p1 * xy + p2 * (r2 + 2 * x2);
+        float y_d = y + y * radial + 2 * p2 * xy + p1 * (r2 + 2 * y2);
+
+        pixel_[0] = fx * x_d + cx;
+        pixel_[1] = fy * y_d + cy;
+        return true;
+    }
+
+    // compares the float and double projections on a grid of rays, returns the largest difference
+    // or a negative value if the two disagree on which points are visible
+    float Validate (std::shared_ptr<beam_calibration::CameraModel> camera_model_);
+
+    float fx, fy, cx, cy, k1, k2, p1, p2;
+    float max_u, max_v;
+    bool check_bounds;                  // whether the camera model rejects pixels outside of the image
+
+    const beam_calibration::CameraModel* model;
+    float validation_error;
+
+};
+
+}
@@ -14,6 +14,7 @@
 #include <string>
 #include <math.h>
 #include <vector>
+#include "StageTimer.h"
 
 namespace cam_cad { 
 
@@ -35,6 +36,21 @@ struct point {
     }
 };
 
+/**
+ * @brief Struct for one labelled shape (defect or outline) read in from a labelled image
+ */
+struct LabelledShape {
+    std::string label;
+    int32_t id;                         // labelme "group_id", the index of the shape in the file if not set
+    bool closed;                        // false for "linestrip" and "line" shapes
+    std::vector<point> points;
+
+    LabelledShape () {
+        id = 0;
+        closed = true;
+    }
+};
+
 /**
  * @brief Class containing input/ouput operations for reading and converting labelled image data and writing to ouput images
  */
@@ -60,6 +76,15 @@ public:
    */
     bool readPoints (std::string filename_, std::vector<point>* points_); 
 
+  /**
+   * @brief Method for reading every labelled shape of an image (e.g. all defects) from a json file,
+   * keeping the label name and ID of each shape
+   * @param filename_ absolute path to the json file to read data from 
+   * @param shapes_ vector the shapes are appended to, in file order
+   * @return read success 
+   */
+    bool readShapes (std::string filename_, std::vector<LabelledShape>* shapes_); 
+
   /**
    * @brief Method for scaling the 2D feature points wrt the origin (top let corner) of the original image
    * @param points_ vector of feature points 
@@ -67,6 +92,20 @@ public:
    */
     void scalePoints (std::vector<point>* points_, float scale_);
 
+  /**
+   * @brief Method for removing near-collinear points from a labelled outline with the Douglas-Peucker 
+   * algorithm, to run before densifyPoints. Every removed point lies within max_deviation_ pixels of 
+   * the segment between the retained points around it, so the outline moves by at most that much
+   * @param points_ vector of feature points, simplified in place (the order is kept)
+   * @param max_deviation_ largest distance in pixels of a removed point to the simplified outline, 
+   * nothing is removed if <= 0
+   * @param closed_ whether the last point connects back to the first (polygon labels)
+   * @param deviation_ receives the largest deviation of a removed point (optional)
+   * @return number of points removed
+   */
+    size_t simplifyPoints (std::vector<point>* points_, float max_deviation_, bool closed_ = true, 
+                           float* deviation_ = nullptr);
+
   /**
    * @brief Method for interpolating points in a feature point vector for a more dense outline of a feature - helps to converge minimization solution
    * @param points_ vector of feature points 
@@ -97,7 +136,8 @@ public:
    * @param target_file_name_ absolute path of image annotated image to create (unnanotated image with written data overlayed)
    * @param color_ color to set pixels in output image (default = "black", options = "red", "green", "blue")
    * @return write success 
-   * @todo update to interpolate pixels (lines? splines?) to color between points
+   * Note: to write several defect sets to the same drawing, use an AnnotationSession 
+   * so that the drawing is only decoded and encoded once
    */
     bool writeToImage (std::vector<point>* points_, std::string src_file_name_, std::string target_file_name_, std::string color_ = "black");
 
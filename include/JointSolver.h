@@ -0,0 +1,173 @@
+#pragma once
+
+#include <ceres/ceres.h>
+#include <ceres/autodiff_cost_function.h>
+#include <ceres/rotation.h>
+#include <beam_calibration/CameraModel.h>
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "util.h"
+#include "FloatProjector.h"
+#include "SolverWorkspace.h"
+
+namespace cam_cad {
+
+/**
+ * @brief Struct for one image of a joint refinement
+ */
+struct JointImage {
+    std::string id;
+    std::shared_ptr<Util> util;                            // camera model (and ID) of the image
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud;
+    Eigen::Matrix4d T_CS;                                  // independent solution in, joint solution out
+    Eigen::Matrix4d T_CS_measured;                         // measured pose the translation prior pulls toward
+    bool converged;                                        // pixel error within the convergence limit
+    double initial_pixel_error, final_pixel_error;
+
+    JointImage () {
+        T_CS = Eigen::Matrix4d::Identity();
+        T_CS_measured = Eigen::Matrix4d::Identity();
+        converged = false;
+        initial_pixel_error = 0;
+        final_pixel_error = 0;
+    }
+};
+
+/**
+ * @brief Class to refine the poses of many images of one CAD face together with the quantities
+ * they share, in one sparse ceres problem
+ *
+ * Each image keeps its own pose block, while the CAD scale (structure unit/CAD pixel) and,
+ * optionally, the camera intrinsics are one block shared by all images. Pose blocks are
+ * eliminated first by the SPARSE_SCHUR solver, so the reduced system only has the shared blocks.
+ * The independent solutions (see Solver) are the starting point; the solution then alternates
+ * correspondence estimation and joint optimization like Solver::SolveOptimization until the
+ * pixel error of every image is within the convergence limit.
+ *
+ * A perspective camera can not tell the scale of the structure from its distance, so the scale
+ * is only observable together with a prior on the camera translations: every image pulls its
+ * translation toward its measured pose (e.g. from the robot) with the standard deviation
+ * "translation_prior_sigma". Without it the scale is held fixed. Intrinsics can only be refined
+ * for RADTAN camera models shared by all images (validated with FloatProjector). The refined
+ * intrinsics are returned by GetIntrinsics but not written to the camera model, so the
+ * correspondences keep using the original intrinsics.
+ *
+ * The parameters are read from the solution parameters file (see Solver), with the optional block
+ * "joint_refinement": {"refine_scale": bool (default true), "refine_intrinsics": bool (default
+ * false), "translation_prior_sigma": structure units (default 0 = no prior), "huber_threshold":
+ * robust loss threshold in pixels (default 0 = no robust loss)}
+ */
+class JointSolver {
+public:
+
+  /**
+   * @brief Constructor
+   * @param config_file_name_ absolute path to the solution configuration json file
+   */
+    JointSolver (std::string config_file_name_);
+
+  /**
+   * @brief Default destructor
+   */
+    ~JointSolver () = default;
+
+  /**
+   * @brief Method for refining the poses of all images and the shared quantities jointly
+   * @param CAD_cloud_ CAD cloud (centered in x and y, CAD pixel units, not scaled)
+   * @param images_ images of the CAD face, the pose, convergence and pixel errors of each are updated
+   * @return true if every image has converged
+   */
+    bool Solve (pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_, std::vector<JointImage>* images_);
+
+  /**
+   * @brief Setter method to set the initial CAD scale, overrides "cloud_scale" of the solution parameters
+   * @param scale_ scale applied to the CAD cloud (structure unit/CAD pixel)
+   */
+    void SetCloudScale (double scale_);
+
+  /**
+   * @brief Setter method to enable or disable the refinement of the shared CAD scale
+   */
+    void SetRefineScale (bool enable_);
+
+  /**
+   * @brief Setter method to enable or disable the refinement of the shared intrinsics
+   */
+    void SetRefineIntrinsics (bool enable_);
+
+  /**
+   * @brief Setter method to set the standard deviation of the measured camera translations
+   * @param sigma_ standard deviation in structure units, 0 to disable the translation prior
+   */
+    void SetTranslationPriorSigma (double sigma_);
+
+  /**
+   * @brief Accessor method to retrieve the CAD scale, refined by the last solution
+   */
+    double GetCloudScale ();
+
+  /**
+   * @brief Accessor method to retrieve whether the shared intrinsics are refined
+   */
+    bool GetRefineIntrinsics ();
+
+  /**
+   * @brief Accessor method to retrieve the intrinsics refined by the last solution
+   * (fx, fy, cx, cy, k1, k2, p1, p2), empty if they were not refined
+   */
+    const Eigen::VectorXd& GetIntrinsics ();
+
+  /**
+   * @brief Accessor method to retrieve the mean pixel error over all images before the joint solution
+   */
+    double GetInitialPixelError ();
+
+  /**
+   * @brief Accessor method to retrieve the mean pixel error over all images after the joint solution
+   */
+    double GetFinalPixelError ();
+
+  /**
+   * @brief Accessor method to retrieve the number of iterations of the last joint solution
+   */
+    int GetSolutionIterations ();
+
+private:
+
+    // estimates the correspondences of every image and updates the pixel errors, returns the mean
+    double EstimateCorrespondences (pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_,
+                                    std::vector<JointImage>& images_);
+
+    void BuildCeresProblem (ceres::Problem& problem_, pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_,
+                            std::vector<JointImage>& images_, bool free_scale_, bool free_intrinsics_);
+
+    void ReadSolutionParams (std::string file_name_);
+
+    // Solution parameters
+    uint32_t max_solution_iterations_, max_ceres_iterations_;
+    std::string offset_type_;
+    bool minimizer_progress_to_stdout_;
+    uint32_t max_solver_time_in_seconds_;
+    double function_tolerance_, gradient_tolerance_, parameter_tolerance_, cloud_scale_, convergence_limit_;
+    bool refine_scale_, refine_intrinsics_;
+    double translation_prior_sigma_, huber_threshold_;
+
+    double initial_projection_error_, final_projection_error_;
+    int solution_iterations_;
+
+    std::vector<std::vector<double>> poses;                // quaternion and translation of every image
+    std::vector<std::shared_ptr<SolverWorkspace>> workspaces;
+    double scale;
+    Eigen::VectorXd intrinsics;
+
+    std::unique_ptr<ceres::LocalParameterization> se3_parameterization_;
+    std::unique_ptr<ceres::LossFunction> loss_function_;
+
+};
+
+}
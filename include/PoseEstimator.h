@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <Eigen/Dense>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ImageBuffer.h"
+#include "Solver.h"
+#include "SolverWorkspace.h"
+#include "util.h"
+#include "visualizer.h"
+
+namespace cam_cad {
+
+/**
+ * @brief Struct for the result of one pose solution
+ */
+struct PoseSolution {
+    Eigen::Matrix4d T_CS;
+    bool converged;
+    double initial_pixel_error, final_pixel_error;
+    int solution_iterations;
+
+    PoseSolution () {
+        T_CS = Eigen::Matrix4d::Identity();
+        converged = false;
+        initial_pixel_error = 0;
+        final_pixel_error = 0;
+        solution_iterations = 0;
+    }
+};
+
+/**
+ * @brief Class for pose estimation, back projection and defect transfer on points held in
+ * memory, for callers that do not go through label files (e.g. the python module, see
+ * src/PythonBindings.cpp)
+ *
+ * Points are passed as interleaved x, y pixel pairs (the layout of a C contiguous (N, 2) float32
+ * array and of std::vector<point>), so they are read where the caller keeps them. An estimator
+ * holds the camera model and the CAD face of its images; its methods can be called from several
+ * threads but run one at a time, so parallel solutions need one estimator per thread.
+ */
+class PoseEstimator {
+public:
+
+  /**
+   * @brief Constructor
+   * @param config_file_name_ absolute path to the solution configuration json file
+   * @param camera_model_file_ camera model file, if empty the camera of the solution parameters is used
+   * @param camera_id_ ladybug camera ID, -1 if the camera model is not a ladybug configuration
+   */
+    PoseEstimator (std::string config_file_name_, std::string camera_model_file_ = "", int camera_id_ = -1);
+
+  /**
+   * @brief Default destructor
+   */
+    ~PoseEstimator () = default;
+
+  /**
+   * @brief Method to set the CAD face the images are solved against, replaces the previous one
+   * @param points_ CAD label outline, num_points_ interleaved x, y pairs in CAD pixels
+   * @param num_points_ number of points
+   * @param density_ densify index (see ImageBuffer::densifyPoints)
+   * @param simplify_tolerance_ largest deviation in CAD pixels allowed when simplifying the
+   * outline before densifying it (see ImageBuffer::simplifyPoints), 0 to keep every point
+   * @return false if the outline has no points
+   */
+    bool SetCAD (const float* points_, size_t num_points_, uint8_t density_ = 2, float simplify_tolerance_ = 0);
+
+  /**
+   * @brief Method to solve the pose of a camera image against the CAD face
+   * @param points_ camera label outline, num_points_ interleaved x, y pairs in image pixels
+   * @param num_points_ number of points
+   * @param T_CS_initial_ initial structure -> camera transformation matrix
+   * @param solution_ receives the solved pose, convergence, pixel errors and iterations
+   * @param density_ densify index (see ImageBuffer::densifyPoints)
+   * @param simplify_tolerance_ see SetCAD, in image pixels
+   * @return false if the CAD face is not set or the outline has no points
+   */
+    bool Solve (const float* points_, size_t num_points_, const Eigen::Matrix4d& T_CS_initial_,
+                PoseSolution* solution_, uint8_t density_ = 10, float simplify_tolerance_ = 0);
+
+  /**
+   * @brief Method to back project image pixels onto the structure plane (see Util::BackProject)
+   * @param pixels_ num_pixels_ interleaved x, y pairs in image pixels
+   * @param num_pixels_ number of pixels
+   * @param T_CS_ structure -> camera transformation matrix
+   * @return back projected points in the camera frame, fewer than num_pixels_ if some pixels could 
+   * not be back projected onto the structure plane
+   */
+    pcl::PointCloud<pcl::PointXYZ>::Ptr BackProject (const float* pixels_, size_t num_pixels_,
+                                                     const Eigen::Matrix4d& T_CS_);
+
+  /**
+   * @brief Method to transfer camera image shapes (e.g. the defects of an image) to the CAD
+   * drawing (see Util::TransferShapes)
+   * @param shapes_camera_ shapes in camera image pixels
+   * @param T_CS_ structure -> camera transformation matrix
+   * @param shapes_CAD_ vector the shapes in CAD pixels are appended to, in the order of the input
+   * @param cloud_scale_ CAD scale of the solution, 0 for the "cloud_scale" of the solution parameters
+   * @return false if the CAD face is not set or a pixel could not be back projected
+   */
+    bool TransferShapes (const std::vector<LabelledShape>& shapes_camera_, const Eigen::Matrix4d& T_CS_,
+                         std::vector<LabelledShape>* shapes_CAD_, double cloud_scale_ = 0);
+
+  /**
+   * @brief Accessor method to retrieve the CAD scale of the solution parameters
+   */
+    double GetCloudScale ();
+
+private:
+
+    // reads num_points_ interleaved x, y pairs
+    void ReadPoints (const float* points_, size_t num_points_, std::vector<point>* output_);
+
+    std::shared_ptr<Util> util;
+    std::shared_ptr<SolverWorkspace> workspace;
+    Solver solver;
+    ImageBuffer image_buffer;
+    pcl::PointCloud<pcl::PointXYZ>::Ptr CAD_cloud;         // centered, CAD pixel units
+    std::mutex mtx;
+
+};
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <Eigen/Dense>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <string>
+#include <vector>
+#include "ImageBuffer.h"
+#include "util.h"
+
+namespace cam_cad {
+
+/**
+ * @brief Struct for the parameters of a synthetic scenario, see config/example_scenario.json
+ * lengths are in CAD pixels unless noted otherwise
+ */
+struct ScenarioConfig {
+    uint32_t num_images = 10;
+    uint32_t num_CAD = 1;                  // distinct CAD faces, image i uses face i % num_CAD
+    uint32_t seed = 1;
+    std::string camera_model = "";         // camera configuration file used for rendering
+    std::string solution_parameters = "";  // written to the manifest for the batch runner
+    double cloud_scale = 0.01;             // CAD pixels -> meters, must match the solution parameters
+
+    // CAD faces
+    uint16_t CAD_size = 1000;              // outline fits in a CAD_size x CAD_size drawing (< 2048)
+    uint32_t outline_vertices = 64;
+    double outline_roughness = 0.3;        // 0 = circle, 1 = radius anywhere in (0, r]
+    uint16_t num_openings = 2;
+    uint32_t opening_vertices = 16;
+
+    // ground truth poses (structure -> camera)
+    double min_distance = 8, max_distance = 14;  // meters along the camera axis
+    double max_offset = 1;                 // meters in camera x and y
+    double max_rotation = 10;              // degrees about each axis
+
+    // camera side labels
+    double pixel_noise = 1;                // standard deviation in pixels
+    double outlier_rate = 0.01;            // fraction of label vertices replaced by outliers
+    double outlier_distance = 40;          // maximum outlier displacement in pixels
+
+    // defects
+    uint16_t num_defects = 3;
+    uint32_t defect_vertices = 20;
+
+    // initial pose written to the manifest (truth perturbed by these amounts, random sign)
+    double initial_rotation_error = 2;     // degrees about each axis
+    double initial_translation_error = 0.2;// meters along each axis
+};
+
+/**
+ * @brief Class generating reproducible synthetic datasets for load and scaling tests
+ * For each CAD face a star shaped outline with openings is generated. Openings are joined to
+ * the outline by a bridge (keyhole polygon) so the whole face is a single labelled shape, as
+ * ImageBuffer::readPoints reads one shape per file. For each image a ground truth pose is drawn,
+ * the CAD outline (centered and scaled the same way as the solver input) is rendered into the
+ * image with Util::TransformCloud and Util::ProjectCloud using the configured camera model, and
+ * noise and outliers are added. Defects are random polylines on the structure, written both in
+ * CAD pixels (ground truth) and as camera labels. All files use the labelme json format of the
+ * labelled images, and a batch manifest (see BatchRunner.h) listing every image is written with
+ * the ground truth pose of each job.
+ * Every CAD face and image has its own random generator seeded by (seed, face/image index), so a
+ * dataset only depends on its configuration and can be generated in parallel.
+ */
+class ScenarioGenerator {
+public:
+
+  /**
+   * @brief Default constructor
+   */
+    ScenarioGenerator ();
+
+  /**
+   * @brief Default destructor
+   */
+    ~ScenarioGenerator () = default;
+
+  /**
+   * @brief Method to read the scenario parameters from a json file, missing keys keep their defaults
+   * @param config_file_name_ absolute path to the scenario configuration file
+   * @return false if the file can not be read
+   */
+    bool ReadConfig (std::string config_file_name_);
+
+  /**
+   * @brief Setter method to set the scenario parameters
+   */
+    void SetConfig (const ScenarioConfig& config_);
+
+  /**
+   * @brief Accessor method to retrieve the scenario parameters
+   */
+    const ScenarioConfig& GetConfig ();
+
+  /**
+   * @brief Method to generate the dataset
+   * files: CAD/CAD_<face>.json, images/image_<i>.json, defects/image_<i>.json (camera labels),
+   * truth/image_<i>.json (defects in CAD pixels) and manifest.json
+   * @param output_dir_ directory to write to (created if missing)
+   * @param num_workers_ number of generator threads (0 = hardware concurrency)
+   * @return true if every CAD face and image was generated
+   */
+    bool Generate (std::string output_dir_, uint16_t num_workers_ = 0);
+
+  /**
+   * @brief Method to generate the outline (with openings) of one CAD face
+   * @param index_ CAD face index
+   * @param outline_ receives the closed keyhole polygon in CAD pixels
+   */
+    void GenerateCAD (uint32_t index_, std::vector<point>* outline_);
+
+  /**
+   * @brief Method to generate the labels of one image
+   * @param index_ image index
+   * @param CAD_outline_ outline of the CAD face used by the image (CAD pixels)
+   * @param util_ utility object with the camera model loaded (one per thread)
+   * @param T_CS_ receives the ground truth structure -> camera transform
+   * @param camera_labels_ receives the noisy outline in the image
+   * @param defects_CAD_ receives the defects in CAD pixels
+   * @param defects_camera_ receives the defects in the image
+   * @return false if no pose keeping the structure in the image was found
+   */
+    bool GenerateImage (uint32_t index_, const std::vector<point>& CAD_outline_, Util& util_,
+                        Eigen::Matrix4d& T_CS_, std::vector<point>* camera_labels_,
+                        std::vector<std::vector<point>>* defects_CAD_,
+                        std::vector<std::vector<point>>* defects_camera_);
+
+private:
+
+    std::vector<point> RadialPolygon (std::mt19937& gen_, double center_x_, double center_y_,
+                                      double radius_, uint32_t num_vertices_, bool clockwise_);
+
+    bool Render (const std::vector<point>& CAD_points_, double offset_x_, double offset_y_,
+                 Eigen::Matrix4d& T_CS_, Util& util_, std::vector<point>* image_points_);
+
+    bool WriteLabels (std::string file_name_, std::string image_path_,
+                      const std::vector<std::string>& labels_,
+                      const std::vector<std::vector<point>>& shapes_, bool closed_);
+
+    ScenarioConfig config;
+    uint32_t image_width, image_height;
+
+};
+
+}
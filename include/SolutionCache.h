@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <Eigen/Dense>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "CADCache.h"
+
+namespace cam_cad {
+
+/**
+ * @brief Struct for a cached pose solution
+ */
+struct CachedSolution {
+    Eigen::Matrix4d T_CS;
+    bool converged;
+    double initial_pixel_error, final_pixel_error;
+    int solution_iterations;
+
+    CachedSolution () {
+        T_CS = Eigen::Matrix4d::Identity();
+        converged = false;
+        initial_pixel_error = 0;
+        final_pixel_error = 0;
+        solution_iterations = 0;
+    }
+};
+
+/**
+ * @brief Class for caching pose solutions across runs, so that a job whose inputs have not
+ * changed is looked up instead of solved again
+ *
+ * Solutions are keyed by a content hash of everything the solution depends on (see
+ * CADCache::Hash), e.g. the camera label contents, camera model, CAD face, initial pose and
+ * solution parameters; the caller computes the key. The cache holds at most max_entries
+ * solutions and evicts the least recently used one when it is full. It is read from and
+ * written to a json file, in least recently used order, so the eviction order is kept between
+ * runs. Get() and Put() can be called from any number of threads.
+ */
+class SolutionCache {
+public:
+
+  /**
+   * @brief Constructor
+   * @param max_entries_ largest number of cached solutions
+   */
+    SolutionCache (size_t max_entries_ = 10000);
+
+  /**
+   * @brief Default destructor
+   */
+    ~SolutionCache () = default;
+
+  /**
+   * @brief Method to read the cached solutions from a file, replacing the current ones
+   * @param file_name_ absolute path to the cache json file, a missing file is an empty cache
+   * @return read success, false if the file exists but can not be parsed, entries that can not 
+   * be read are skipped
+   */
+    bool Load (std::string file_name_);
+
+  /**
+   * @brief Method to write the cached solutions to a file, the file is written to 
+   * <file_name_>.tmp first and renamed over the old one, so it is never left half written
+   * @param file_name_ absolute path to the cache json file
+   * @return write success, the old file is kept if the write fails
+   */
+    bool Save (std::string file_name_);
+
+  /**
+   * @brief Method to look up a solution, marks it as the most recently used one
+   * @param key_ hash of the inputs of the solution
+   * @param solution_ receives the cached solution
+   * @return true if the solution is cached
+   */
+    bool Get (uint64_t key_, CachedSolution& solution_);
+
+  /**
+   * @brief Method to add or replace a solution, evicting the least recently used solutions
+   * if the cache is full
+   * @param key_ hash of the inputs of the solution
+   * @param solution_ solution to cache
+   */
+    void Put (uint64_t key_, const CachedSolution& solution_);
+
+  /**
+   * @brief Setter method to set the largest number of cached solutions, evicts the least
+   * recently used solutions above it
+   */
+    void SetMaxEntries (size_t max_entries_);
+
+  /**
+   * @brief Method to remove all cached solutions
+   */
+    void Clear ();
+
+  /**
+   * @brief Accessor method to retrieve the number of cached solutions
+   */
+    size_t GetSize ();
+
+  /**
+   * @brief Accessor method to retrieve the number of lookups that found a solution
+   */
+    uint64_t GetNumHits ();
+
+  /**
+   * @brief Accessor method to retrieve the number of lookups that did not find a solution
+   */
+    uint64_t GetNumMisses ();
+
+  /**
+   * @brief Accessor method to retrieve the number of solutions evicted to stay within max_entries
+   */
+    uint64_t GetNumEvicted ();
+
+  /**
+   * @brief Method to continue a hash with the contents of a file
+   * @param file_name_ absolute path to the file to hash
+   * @param hash_ hash to continue from, receives the new hash
+   * @return read success
+   */
+    static bool HashFile (std::string file_name_, uint64_t& hash_);
+
+  /**
+   * @brief Method to continue a hash with the exact values of a transform
+   * @param T_ transform to hash
+   * @param seed_ hash to continue from
+   */
+    static uint64_t HashTransform (const Eigen::Matrix4d& T_, uint64_t seed_);
+
+private:
+
+    // removes least recently used solutions above max_entries, the caller holds the lock
+    void Evict ();
+
+    typedef std::list<std::pair<uint64_t, CachedSolution>> EntryList;
+
+    EntryList entries;                                       // least recently used first
+    std::unordered_map<uint64_t, EntryList::iterator> index;
+    size_t max_entries;
+    uint64_t num_hits, num_misses, num_evicted;
+    std::mutex mtx;
+
+};
+
+}
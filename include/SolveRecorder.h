@@ -0,0 +1,128 @@
+#pragma once 
+
+#include <cstdint>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/correspondence.h>
+#include <Eigen/Dense>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cam_cad { 
+
+/**
+ * @brief Struct for one recorded solver iteration
+ */
+struct RecordedFrame { 
+    uint32_t iteration;                 // 0 = initial pose
+    double pixel_error;                 // average pixel error after the iteration
+    Eigen::Matrix4d T_CS;
+    std::vector<float> trans_cloud;     // transformed CAD cloud, x y z per point
+    std::vector<float> proj_cloud;      // projected CAD cloud, x y per point (pixels)
+    std::vector<uint32_t> corrs;        // projected index, camera index per correspondence
+};
+
+/**
+ * @brief Class recording the per-iteration state of the solver into a bounded ring buffer so 
+ * solutions can be inspected after the fact without the interactive visualizer
+ * 
+ * Recording never blocks the solver: frames are copied into preallocated slots, the oldest frame 
+ * is overwritten once the buffer is full, and a frame is dropped (and counted) rather than 
+ * waiting if the buffer is being saved at the same time. Record() and BeginSession() are meant 
+ * to be called by the solver thread only, Save() can be called from any thread. 
+ * 
+ * Recordings are saved to a compact binary file (raw float clouds) which can be loaded again 
+ * with Load() and replayed in the visualizer (see tests/src/replay_recording.cpp). 
+ */
+class SolveRecorder { 
+public: 
+
+  /**
+   * @brief Constructor
+   * @param capacity_ number of iterations kept (the most recent ones)
+   */
+    SolveRecorder (uint32_t capacity_ = 32);
+
+  /**
+   * @brief Default destructor
+   */
+    ~SolveRecorder () = default;
+
+  /**
+   * @brief Method to start recording a new solution, clears the buffer and stores the camera cloud
+   * @param camera_cloud_ image label cloud the solution is run against
+   */
+    void BeginSession (pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_);
+
+  /**
+   * @brief Method to record one solver iteration, never blocks 
+   * @param iteration_ solver iteration (0 for the initial pose)
+   * @param pixel_error_ average pixel error of the projection
+   * @param T_CS_ structure -> camera transform
+   * @param trans_cloud_ transformed CAD cloud
+   * @param proj_cloud_ projected CAD cloud
+   * @param corrs_ correspondences between the projected and camera cloud
+   * @return false if the frame was dropped
+   */
+    bool Record (uint32_t iteration_, double pixel_error_, const Eigen::Matrix4d& T_CS_, 
+                 pcl::PointCloud<pcl::PointXYZ>::ConstPtr trans_cloud_, 
+                 pcl::PointCloud<pcl::PointXYZ>::ConstPtr proj_cloud_, 
+                 pcl::CorrespondencesConstPtr corrs_);
+
+  /**
+   * @brief Method to save the recorded frames (oldest first) to a file
+   * @param file_name_ absolute path of the recording to write
+   * @return true if the file was written
+   */
+    bool Save (std::string file_name_);
+
+  /**
+   * @brief Method to load a saved recording, replaces the current content of the recorder
+   * @param file_name_ absolute path of the recording to read
+   * @return true if the file was read, false if it is truncated or a size stored in it does not fit 
+   * the file length (nothing is allocated for such sizes and the recorder is left empty)
+   */
+    bool Load (std::string file_name_);
+
+  /**
+   * @brief Accessor method to retrieve the number of frames held (at most the capacity)
+   */
+    uint32_t GetNumFrames ();
+
+  /**
+   * @brief Accessor method to retrieve the number of frames dropped since the session began
+   */
+    uint32_t GetNumDropped ();
+
+  /**
+   * @brief Method to get a frame and its clouds for display 
+   * @param index_ frame index, 0 = oldest frame held
+   * @param frame_ receives the frame
+   * @param camera_cloud_ receives the camera cloud of the session
+   * @param trans_cloud_ receives the transformed CAD cloud
+   * @param proj_cloud_ receives the projected CAD cloud
+   * @param corrs_ receives the correspondences
+   * @return false if the index is out of range
+   */
+    bool GetFrame (uint32_t index_, RecordedFrame& frame_, 
+                   pcl::PointCloud<pcl::PointXYZ>::Ptr camera_cloud_, 
+                   pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud_, 
+                   pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud_, 
+                   pcl::CorrespondencesPtr corrs_);
+
+private: 
+
+    std::vector<RecordedFrame> frames; // ring buffer
+    std::vector<float> camera_cloud;   // x y per point
+    uint32_t capacity;
+    uint32_t head;                     // next slot to write
+    uint32_t num_frames;
+    std::atomic<uint32_t> num_dropped;
+    std::mutex mtx;
+
+};
+
+}
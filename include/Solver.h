@@ -8,6 +8,9 @@
 #include <Eigen/Geometry>
 #include "util.h"
 #include "visualizer.h"
+#include "CADCache.h"
+#include "SolveRecorder.h"
+#include "ConvergenceRenderer.h"
 #include <stdio.h>
 #include "beam_optimization/CamPoseReprojectionCost.hpp"
 #include <nlohmann/json.hpp>
@@ -45,6 +48,15 @@ public:
     bool SolveOptimization (pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_, 
                             pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_);
 
+  /**
+   * @brief Method for estimating the camera pose for an image from a prepared (cached) CAD cloud, 
+   * the cached scaled cloud is used when it was scaled with this solver's cloud scale
+   * @param CAD_ prepared CAD cloud (see CADCache)
+   * @param camera_cloud_ 3D point cloud generated from the camera image
+   */
+    bool SolveOptimization (std::shared_ptr<const PreparedCAD> CAD_, 
+                            pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_);
+
   /**
    * @brief Accessor method to retrieve the structure - camera transformation matrix 
    * @return stucture - camera transformation matrix (T_CS)
@@ -87,6 +99,72 @@ public:
     */
     void SetMaxMinimizerIterations (uint16_t max_iter_);
 
+   /**
+    * @brief Setter method to enable or disable the solution visualizer, this overrides the 
+    * "visualize" parameter of the solution parameters file
+    * @param enable_ enable visualization, when enabled the solution blocks for console input between iterations
+    */
+    void SetVisualization (bool enable_);
+
+   /**
+    * @brief Setter method to run the transform and projection of every iteration in single precision 
+    * (see Util::SetFloatPrecision), this overrides the "float_precision" parameter of the solution 
+    * parameters file. The ceres pose optimization always runs in double
+    * @param enable_ use the float32 path
+    */
+    void SetFloatPrecision (bool enable_);
+
+   /**
+    * @brief Setter method to record every iteration of the following solutions into a ring buffer 
+    * (see SolveRecorder.h), recording does not block the solution and works with visualization off. 
+    * The caller keeps the recorder and saves it (SolveRecorder::Save) when it needs the recording
+    * @param recorder_ recorder to use, nullptr to stop recording
+    */
+    void SetRecorder (std::shared_ptr<SolveRecorder> recorder_);
+
+   /**
+    * @brief Accessor method to retrieve the recorder of the solver (nullptr if not recording)
+    */
+    std::shared_ptr<SolveRecorder> GetRecorder ();
+
+   /**
+    * @brief Setter method to render every iteration of the following solutions to images or video 
+    * without a display (see ConvergenceRenderer.h), works with visualization off. 
+    * Solvers never create a renderer themselves, solvers running side by side must be given 
+    * renderers with their own outputs
+    * @param renderer_ renderer to use, nullptr to stop rendering
+    */
+    void SetRenderer (std::shared_ptr<ConvergenceRenderer> renderer_);
+
+   /**
+    * @brief Accessor method to retrieve the renderer of the solver (nullptr if not rendering)
+    */
+    std::shared_ptr<ConvergenceRenderer> GetRenderer ();
+
+   /**
+    * @brief Setter method to share a workspace (see SolverWorkspace.h) between solvers used one after 
+    * the other by the same thread, e.g. one workspace per batch worker
+    * @param workspace_ workspace holding the iteration clouds
+    */
+    void SetWorkspace (std::shared_ptr<SolverWorkspace> workspace_);
+
+   /**
+    * @brief Accessor method to retrieve the workspace holding the iteration clouds, its statistics 
+    * report the high-water marks and allocations of all solutions run with it
+    */
+    std::shared_ptr<SolverWorkspace> GetWorkspace ();
+
+   /**
+    * @brief Method to replace the camera model read from the solution parameters file 
+    * @param intrinsics_file_ absolute path to the camera configuration file
+    */
+    void SetCameraModel (std::string intrinsics_file_);
+
+   /**
+    * @brief Accessor method to retrieve the scale applied to the CAD cloud for the solution (structure unit/CAD pixel)
+    */
+    double GetCloudScale ();
+
    /**
     * @brief Accessor method to retrieve the inital pixel error in the projection before the solution was run 
     * error is calculated as the average euclidean distance (in pixels) between the projected points and their 
@@ -94,13 +172,22 @@ public:
     */
     double GetInitialPixelError ();
 
+   /**
+    * @brief Accessor method to retrieve the pixel error in the projection at the last convergence check 
+    * (same measure as the initial pixel error), only updated for the "pixel" convergence type
+    */
+    double GetFinalPixelError ();
+
    /**
     * @brief Accessor method to retrieve the number of iterations required for the overal solution to converge
     */
     int GetSolutionIterations ();
 
-private:
-    
+protected:
+
+    // the ceres stages of one solution iteration, tests and benchmarks time them on their own 
+    // through tests/include/solver_stages.h
+
    /**
     * @brief Method for building the Ceres problem by adding the residual blocks
     * @param problem Ceres problem object
@@ -127,6 +214,16 @@ private:
     */
     void SolveCeresProblem (const std::shared_ptr<ceres::Problem>& problem, bool output_results);
 
+private:
+    
+   /**
+    * @brief Method running the solution loop on a CAD cloud that is already scaled by the cloud scale
+    * @param CAD_cloud_scaled CAD cloud (centered in x and y, scaled)
+    * @param camera_cloud_ 3D point cloud generated from the camera image
+    */
+    bool SolveScaledOptimization (pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_scaled, 
+                                  pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_);
+
    /**
     * @brief Method to check the overall problem for convergence by checking the average error in pixels between 
     * the projected points and the image points
@@ -172,7 +269,7 @@ private:
     uint32_t max_solver_time_in_seconds_;
     double function_tolerance_, gradient_tolerance_, parameter_tolerance_, cloud_scale_, convergence_limit_;
 
-    double initial_projection_error_;
+    double initial_projection_error_, final_projection_error_;
 
     uint8_t solution_iterations_;
 
@@ -180,6 +277,12 @@ private:
 
     std::shared_ptr<beam_calibration::CameraModel> camera_model;
 
+    std::shared_ptr<SolveRecorder> recorder;
+
+    std::shared_ptr<ConvergenceRenderer> renderer;
+
+    std::shared_ptr<SolverWorkspace> workspace;
+
 };
 
 
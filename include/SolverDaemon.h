@@ -0,0 +1,142 @@
+#pragma once 
+
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <Eigen/Dense>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ImageBuffer.h"
+#include "Solver.h"
+#include "CADCache.h"
+#include "util.h"
+
+namespace cam_cad { 
+
+/**
+ * @brief Class for a long lived local solver process that keeps solvers (solution parameters 
+ * and camera models) and prepared CAD clouds resident between requests
+ * 
+ * Requests are newline delimited json objects sent over a unix domain socket, each request is 
+ * answered with one json line. Every response contains "ok" and, on failure, "error". 
+ * Supported request types: 
+ * - {"type": "ping"}
+ * - {"type": "estimate_pose", "config": solution parameters file, "camera_model": (optional), 
+ *    "camera_id": (optional, applies to this request only), "CAD_labels": CAD label file, "CAD_density": (optional, default 2), 
+ *    <camera points>, "camera_density": (optional), "T_CS": row major 4x4 initial transform 
+ *    or "initial_pose": pose file}
+ *    -> {"converged", "T_CS", "initial_pixel_error", "solution_iterations", "solve_ms"}
+ * - {"type": "transfer_defects", "config", "camera_model", "camera_id", "CAD_labels", "CAD_density", 
+ *    "T_CS": solved transform, <defect points>, "output_shm": (optional)}
+ *    -> {"num_points", "num_dropped_points", "points", "defects": [{"label", "id", "num_points", "points"}]} 
+ *    (points are omitted when written to output_shm, in that case the defects are stored one 
+ *    after the other in defect order). A "defect_labels" file transfers every shape it contains
+ * - {"type": "shutdown"}
+ * 
+ * Point sets (<camera points>, <defect points>) can be given as a label file ("camera_labels"), 
+ * an inline array ("camera_points": [[x, y], ...]) or a shared memory object 
+ * ("camera_shm": {"name": shm name, "num_points": N}) holding N float32 (x, y) pairs, which keeps 
+ * large arrays out of the socket. "output_shm" uses the same layout, "num_points" is its capacity. 
+ * "<prefix>_simplify" (e.g. "camera_simplify", "CAD_simplify") removes near-collinear points 
+ * within the given tolerance in pixels before densifying (optional, see ImageBuffer::simplifyPoints). 
+ * Requests are handled one at a time, so resident objects need no locking. A client that sends 
+ * nothing for the request timeout is disconnected (with an error response if it was in the middle 
+ * of a request), and a request longer than the size limit is answered with an error and its 
+ * connection closed (see SetRequestLimits), so one client can not stall the daemon.
+ */
+class SolverDaemon { 
+public: 
+
+  /**
+   * @brief Constructor
+   */
+    SolverDaemon (); 
+
+  /**
+   * @brief Destructor, closes the socket if it is still open
+   */
+    ~SolverDaemon ();
+
+  /**
+   * @brief Method to create the unix domain socket and start listening
+   * @param socket_path_ absolute path of the socket file (an existing file is replaced)
+   * @return success
+   */
+    bool Start (std::string socket_path_);
+
+  /**
+   * @brief Method to accept and answer requests until a shutdown request is received, or until 
+   * accepting a connection fails for any reason other than an interrupt or an aborted connection
+   */
+    void Serve ();
+
+  /**
+   * @brief Setter method for the limits that keep one client from stalling the daemon
+   * @param timeout_ms_ time a client may take to send a complete request (default 30 s), also the 
+   * time an idle connection is kept open
+   * @param max_request_size_ longest request line in bytes (default 64 MB, large point sets should 
+   * be passed in shared memory)
+   */
+    void SetRequestLimits (uint32_t timeout_ms_, size_t max_request_size_);
+
+  /**
+   * @brief Method to close the socket and remove the socket file
+   */
+    void Stop ();
+
+  /**
+   * @brief Method to answer a single request 
+   * @param request_ json request 
+   * @return json response
+   */
+    nlohmann::json HandleRequest (const nlohmann::json& request_);
+
+private: 
+
+    struct resident_solver { 
+        std::shared_ptr<Util> util;
+        std::shared_ptr<Visualizer> vis;
+        std::unique_ptr<Solver> solver;
+    };
+
+    // answers the requests of one connection until it closes, stalls or sends an oversized request
+    void ServeClient (int client_fd_);
+
+    // writes one response line, false if the client has gone
+    bool SendResponse (int client_fd_, const nlohmann::json& response_);
+
+    nlohmann::json EstimatePose (const nlohmann::json& request_);
+
+    nlohmann::json TransferDefects (const nlohmann::json& request_);
+
+    resident_solver* GetSolver (const nlohmann::json& request_);
+
+    // selects the "camera_id" of the request, or the default camera model when it has none
+    void SelectCamera (resident_solver* resident_, const nlohmann::json& request_);
+
+    std::shared_ptr<const PreparedCAD> GetCAD (const nlohmann::json& request_, double scale_);
+
+    bool ReadPoints (const nlohmann::json& request_, std::string prefix_, 
+                     uint8_t default_density_, std::vector<point>* points_);
+
+    bool ReadShm (const nlohmann::json& shm_, std::vector<point>* points_);
+
+    bool WriteShm (const nlohmann::json& shm_, std::vector<point>* points_);
+
+    bool ReadTransform (const nlohmann::json& T_json_, Eigen::Matrix4d& T_);
+
+    std::map<std::string, resident_solver> solvers; 
+    CADCache CAD_cache;
+
+    ImageBuffer image_buffer;
+
+    std::string socket_path;
+    int socket_fd;
+    bool shutdown_requested;
+    uint32_t request_timeout_ms;
+    size_t max_request_size;
+
+};
+
+}
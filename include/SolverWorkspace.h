@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/correspondence.h>
+#include <pcl/registration/correspondence_estimation.h>
+#include <stdio.h>
+
+namespace cam_cad {
+
+/**
+ * @brief Struct for the statistics used to offset a projected cloud onto the camera cloud
+ */
+struct CloudStats {
+    pcl::PointXYZ centroid;             // z = 0
+    pcl::PointXYZ center;               // center of the xy bounding box, z = 0
+};
+
+/**
+ * @brief Struct for the high-water marks of a solver workspace
+ */
+struct WorkspaceStats {
+    size_t max_CAD_points = 0;          // largest transformed / projected cloud
+    size_t max_camera_points = 0;       // largest camera cloud searched
+    size_t max_correspondences = 0;
+    size_t reserved_bytes = 0;          // memory currently held by the buffers
+    uint32_t num_problems = 0;          // BeginProblem calls
+    uint32_t num_allocations = 0;       // buffer (re)allocations, 0 growth once the workspace is warm
+};
+
+/**
+ * @brief Class holding the clouds and correspondences that every solver iteration writes, so they
+ * are allocated once per problem size instead of once per iteration
+ *
+ * The buffers are sized by BeginProblem and only ever grow: clearing a cloud keeps its capacity,
+ * so after the first solution of a given size, iterations and later solutions run without
+ * allocating. The nearest-neighbor search tree and the statistics of the camera cloud are also
+ * kept for the whole problem instead of being rebuilt for every correspondence estimation.
+ *
+ * Clouds handed out by the workspace are overwritten by the next iteration, consumers that keep
+ * them (visualizer, recorder, renderer) take copies. A workspace is used by one thread at a time.
+ */
+class SolverWorkspace {
+public:
+
+  /**
+   * @brief Constructor
+   */
+    SolverWorkspace ();
+
+  /**
+   * @brief Default destructor
+   */
+    ~SolverWorkspace () = default;
+
+  /**
+   * @brief Method to prepare the workspace for a new problem, reserves the buffers for the
+   * given sizes and forgets the camera cloud search tree
+   * @param num_CAD_points_ number of points in the CAD cloud
+   * @param num_camera_points_ number of points in the camera cloud
+   */
+    void BeginProblem (size_t num_CAD_points_, size_t num_camera_points_);
+
+  /**
+   * @brief Accessor method to retrieve the cloud holding the transformed CAD cloud
+   */
+    pcl::PointCloud<pcl::PointXYZ>::Ptr GetTransformedCloud ();
+
+  /**
+   * @brief Accessor method to retrieve the cloud holding the projected CAD cloud
+   */
+    pcl::PointCloud<pcl::PointXYZ>::Ptr GetProjectedCloud ();
+
+  /**
+   * @brief Accessor method to retrieve the scratch cloud holding the offset projection matched 
+   * by the correspondence estimation
+   */
+    pcl::PointCloud<pcl::PointXYZ>::Ptr GetScratchProjectedCloud ();
+
+  /**
+   * @brief Accessor method to retrieve the correspondences of the current iteration
+   */
+    pcl::CorrespondencesPtr GetCorrespondences ();
+
+  /**
+   * @brief Method to get the correspondence estimator with the camera cloud as target, the
+   * search tree is only built when the camera cloud differs from the previous call
+   * @param camera_cloud_ camera cloud to search
+   */
+    pcl::registration::CorrespondenceEstimation<pcl::PointXYZ, pcl::PointXYZ>&
+        GetCorrespondenceEstimation (pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_);
+
+  /**
+   * @brief Method to get the cached statistics of the camera cloud
+   * @param camera_cloud_ camera cloud of the problem
+   * @param stats_ receives the statistics
+   * @return false if no statistics were stored for this camera cloud in the current problem
+   */
+    bool GetCameraStats (pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_, CloudStats& stats_);
+
+  /**
+   * @brief Method to store the statistics of the camera cloud for the current problem
+   * @param camera_cloud_ camera cloud of the problem
+   * @param stats_ statistics of the camera cloud
+   */
+    void SetCameraStats (pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_, const CloudStats& stats_);
+
+  /**
+   * @brief Method to update the high-water marks, called after every iteration
+   */
+    void Update ();
+
+  /**
+   * @brief Accessor method to retrieve the high-water marks
+   */
+    WorkspaceStats GetStats ();
+
+  /**
+   * @brief Method to print the high-water marks
+   */
+    void PrintStats ();
+
+private:
+
+    // grows a buffer to at least size_ and counts the allocation
+    template <typename T>
+    void Reserve (T& buffer_, size_t size_);
+
+    // counts allocations done while a buffer was filled
+    template <typename T>
+    void Track (T& buffer_, size_t& capacity_);
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud, proj_cloud, scratch_proj_cloud;
+    pcl::CorrespondencesPtr corrs;
+
+    pcl::registration::CorrespondenceEstimation<pcl::PointXYZ, pcl::PointXYZ> corr_est;
+    const pcl::PointCloud<pcl::PointXYZ>* corr_est_target;
+
+    CloudStats camera_stats;
+    const pcl::PointCloud<pcl::PointXYZ>* camera_stats_cloud;
+
+    size_t capacities[4];   // buffer capacities at the last update
+    WorkspaceStats stats;
+
+};
+
+}
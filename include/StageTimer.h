@@ -0,0 +1,165 @@
+#pragma once 
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cam_cad { 
+
+/**
+ * @brief Struct for the aggregated timings of one stage 
+ */
+struct StageStats { 
+    uint64_t count = 0;
+    double total_ms = 0;
+    double min_ms = 0;
+    double max_ms = 0;
+    double mean_ms = 0;
+};
+
+/**
+ * @brief Process wide recorder for the stage timings of the solver, utilities and image I/O
+ * Recording is off by default and is switched on at runtime with Enable(). While disabled a 
+ * StageTimer costs a single atomic load. Timings can be exported as a Chrome trace 
+ * (chrome://tracing or ui.perfetto.dev) and as aggregated per-stage statistics. 
+ * The trace keeps the most recent stages only (see SetMaxEvents), the statistics cover every 
+ * stage recorded since the last Clear(). All methods can be called from any thread. 
+ */
+class TraceRecorder { 
+public: 
+
+  /**
+   * @brief Accessor method to retrieve the process wide recorder
+   */
+    static TraceRecorder& GetInstance ();
+
+  /**
+   * @brief Method to switch recording on or off
+   * @param enable_ true to record stage timings
+   */
+    void Enable (bool enable_);
+
+  /**
+   * @brief Method to check if recording is switched on
+   */
+    bool IsEnabled () const { return enabled.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Method to limit the number of stages kept for the trace, once the limit is reached the 
+   * oldest stage is overwritten by each new one. Drops the stages kept so far, the statistics are kept
+   * @param max_events_ maximum number of stages kept (default 1048576, about 24 MB)
+   */
+    void SetMaxEvents (size_t max_events_);
+
+  /**
+   * @brief Method to record one completed stage, normally called by StageTimer
+   * @param stage_ stage name
+   * @param start_ start time of the stage
+   * @param end_ end time of the stage
+   */
+    void Record (const char* stage_, std::chrono::steady_clock::time_point start_, 
+                 std::chrono::steady_clock::time_point end_);
+
+  /**
+   * @brief Method to get the statistics of every recorded stage
+   * @return map of stage name -> statistics
+   */
+    std::map<std::string, StageStats> GetStageStats ();
+
+  /**
+   * @brief Method to write all recorded stages as a Chrome trace json file
+   * @param file_name_ absolute path of the trace file to write
+   * @return true if the file was written
+   */
+    bool WriteTrace (std::string file_name_);
+
+  /**
+   * @brief Method to write the per-stage statistics as a json file
+   * @param file_name_ absolute path of the statistics file to write
+   * @return true if the file was written
+   */
+    bool WriteStats (std::string file_name_);
+
+  /**
+   * @brief Method to print the per-stage statistics to stdout
+   */
+    void PrintStats ();
+
+  /**
+   * @brief Method to drop all recorded stages
+   */
+    void Clear ();
+
+  /**
+   * @brief Accessor method to retrieve the number of stages kept for the trace
+   */
+    size_t GetNumEvents ();
+
+  /**
+   * @brief Accessor method to retrieve the number of stages overwritten since the last Clear()
+   */
+    uint64_t GetNumDropped ();
+
+private: 
+
+    struct trace_event {
+        const char* stage; // stage names are string literals
+        uint32_t thread;
+        int64_t start_us;
+        int64_t duration_us;
+    };
+
+    TraceRecorder ();
+
+    TraceRecorder (const TraceRecorder&) = delete;
+    TraceRecorder& operator= (const TraceRecorder&) = delete;
+
+    std::atomic<bool> enabled;
+    std::chrono::steady_clock::time_point epoch;
+    // ring buffer of the most recent stages, next_event is the oldest once it is full
+    std::vector<trace_event> events;
+    size_t next_event;
+    size_t max_events;
+    uint64_t num_dropped;
+    // running statistics by stage name pointer, merged by name in GetStageStats
+    std::map<const char*, StageStats> stage_stats;
+    std::map<std::thread::id, uint32_t> thread_ids;
+    std::mutex mtx;
+
+};
+
+/**
+ * @brief Scoped timer recording the time from construction to destruction as one stage
+ * usage: { StageTimer timer("ceres_solve"); ...stage... }
+ * the stage name must be a string literal (it is stored by pointer)
+ */
+class StageTimer { 
+public: 
+
+    explicit StageTimer (const char* stage_) : stage(stage_), 
+        enabled(TraceRecorder::GetInstance().IsEnabled()) {
+        if (enabled) start = std::chrono::steady_clock::now();
+    }
+
+    ~StageTimer () {
+        if (enabled) 
+            TraceRecorder::GetInstance().Record(stage, start, std::chrono::steady_clock::now());
+    }
+
+    StageTimer (const StageTimer&) = delete;
+    StageTimer& operator= (const StageTimer&) = delete;
+
+private: 
+
+    const char* stage;
+    bool enabled;
+    std::chrono::steady_clock::time_point start;
+
+};
+
+}
@@ -0,0 +1,161 @@
+#pragma once 
+
+#include <cstdint>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ImageBuffer.h"
+
+namespace cam_cad { 
+
+/**
+ * @brief Class for storing an annotated CAD drawing as fixed size tiles on disk 
+ * Note: to use: 
+ * 1. call create() once to split an unannotated drawing into tiles (or open() an existing store)
+ * 2. call any of addPoints(), addPolyline() or addPolygon() for each defect, only the tiles 
+ *    touched by the defect are read and re-written
+ * 3. call renderTile(), exportRegion() or exportImage() to get annotated output on demand
+ * 4. call flush() (or destroy the object) to write the tile index
+ * The tile index (index.json) in the store directory keeps the drawing dimensions, tile size 
+ * and a revision and defect count for every tile. Tiles are written as defects are added, the 
+ * index only by create(), flush() and the destructor.
+ */
+class TileMapStore { 
+public: 
+
+  /**
+   * @brief Empty constructor
+   */
+    TileMapStore (); 
+
+  /**
+   * @brief Destructor, writes the tile index if it changed
+   */
+    ~TileMapStore ();
+
+  /**
+   * @brief Method for splitting an unannotated drawing into tiles and creating the tile index
+   * @param src_file_name_ absolute path of the unannotated drawing
+   * @param store_dir_ absolute path of the (existing) directory to write tiles and index to 
+   * @param tile_size_ width and height of each tile in pixels (edge tiles may be smaller)
+   * @return create success
+   */
+    bool create (std::string src_file_name_, std::string store_dir_, uint16_t tile_size_ = 1024);
+
+  /**
+   * @brief Method for opening an existing store by reading its tile index
+   * @param store_dir_ absolute path of the directory containing the tiles and index
+   * @return read success
+   */
+    bool open (std::string store_dir_);
+
+  /**
+   * @brief Method for writing single pixels to the tiles they fall in 
+   * @param points_ 2D point set in drawing pixel coordinates
+   * @param color_ pixel color (default = "black", options = "red", "green", "blue")
+   * @return write success
+   */
+    bool addPoints (std::vector<point>* points_, std::string color_ = "black");
+
+  /**
+   * @brief Method for drawing a polyline across all tiles it touches
+   * @param points_ 2D point set (polyline vertices) in drawing pixel coordinates
+   * @param color_ line color (default = "black", options = "red", "green", "blue")
+   * @param thickness_ line thickness in pixels
+   * @param closed_ if set to true, the last point is connected back to the first
+   * @return write success
+   */
+    bool addPolyline (std::vector<point>* points_, std::string color_ = "black", 
+                      uint16_t thickness_ = 1, bool closed_ = false);
+
+  /**
+   * @brief Method for drawing a filled polygon across all tiles it touches
+   * @param points_ 2D point set (polygon vertices) in drawing pixel coordinates
+   * @param color_ fill color (default = "black", options = "red", "green", "blue")
+   * @return write success
+   */
+    bool addPolygon (std::vector<point>* points_, std::string color_ = "black");
+
+  /**
+   * @brief Method for writing the tile index if defects were added since it was last written
+   * @return write success
+   */
+    bool flush ();
+
+  /**
+   * @brief Method for reading a single annotated tile
+   * @param row_ tile row 
+   * @param col_ tile column
+   * @param tile_ image to receive the tile
+   * @return read success
+   */
+    bool renderTile (uint32_t row_, uint32_t col_, cv::Mat& tile_);
+
+  /**
+   * @brief Method for stitching the tiles covering a region of the drawing into one image
+   * only the tiles intersecting the region are read 
+   * @param x_ left edge of the region in drawing pixels
+   * @param y_ top edge of the region in drawing pixels 
+   * @param width_ region width in pixels, clipped to the drawing
+   * @param height_ region height in pixels, clipped to the drawing
+   * @param target_file_name_ absolute path of the image to create
+   * @return write success, false for an empty region or one starting outside of the drawing
+   */
+    bool exportRegion (uint32_t x_, uint32_t y_, uint32_t width_, uint32_t height_, 
+                       std::string target_file_name_);
+
+  /**
+   * @brief Method for stitching all tiles into the complete annotated drawing
+   * @param target_file_name_ absolute path of the image to create
+   * @return write success
+   */
+    bool exportImage (std::string target_file_name_);
+
+  /**
+   * @brief Accessor method to retrieve the number of tile writes done by this object since 
+   * create() or open() was called
+   */
+    uint32_t getNumTileWrites ();
+
+  /**
+   * @brief Accessor methods to retrieve the store layout
+   */
+    uint32_t getWidth ();
+    uint32_t getHeight ();
+    uint32_t getRows ();
+    uint32_t getCols ();
+
+private: 
+
+    struct tile_info { 
+        uint32_t revision; 
+        uint32_t num_defects;
+    };
+
+    // draws the given shape into the tiles its rasterised outline (or filled area) touches
+    bool drawShape (const std::vector<cv::Point>& pixels_, cv::Vec3b color_, 
+                    int thickness_, bool closed_, bool filled_);
+
+    bool readTile (uint32_t row_, uint32_t col_, cv::Mat& tile_);
+
+    bool writeTile (uint32_t row_, uint32_t col_, const cv::Mat& tile_);
+
+    bool writeIndex ();
+
+    std::string tileFileName (uint32_t row_, uint32_t col_);
+
+    std::string store_dir;
+    std::string source_file;
+    uint32_t width, height, rows, cols;
+    uint16_t tile_size;
+    std::vector<tile_info> tiles; // row major
+    uint32_t num_tile_writes;
+    bool store_open;
+    bool index_changed;
+
+};
+
+}
@@ -0,0 +1,97 @@
+#pragma once 
+
+#include <cstdint>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ImageBuffer.h"
+
+namespace cam_cad { 
+
+/**
+ * @brief Class for streaming transferred defect geometry to a vector overlay (SVG or DXF) 
+ * in CAD drawing coordinates
+ * Note: to use: 
+ * 1. call open() with the target file, the format is taken from the file extension (.svg or .dxf)
+ * 2. call addPolyline() for each defect, each defect is written to the file immediately 
+ * 3. call close() (or let the destructor close the file)
+ * Points are expected in drawing pixel coordinates, i.e. after Util::OffsetCloudxy has 
+ * restored the drawing offset, and are written without rounding. SVG keeps the drawing 
+ * convention (origin at the top left, y down). DXF is y up, so y is flipped about the 
+ * drawing height to keep the overlay aligned with the drawing.
+ */
+class VectorWriter { 
+public: 
+
+  /**
+   * @brief Empty constructor
+   */
+    VectorWriter (); 
+
+  /**
+   * @brief Destructor, closes the output file if it is still open
+   */
+    ~VectorWriter ();
+
+  /**
+   * @brief Method for opening the output file and writing the file header 
+   * @param target_file_name_ absolute path of the overlay to create (.svg or .dxf)
+   * @param width_ width of the CAD drawing in pixels
+   * @param height_ height of the CAD drawing in pixels
+   * @param layer_ name of the overlay layer (SVG group id / DXF layer name), e.g. a defect label. 
+   * Characters DXF does not allow in layer names (<>/\":;?*|=`) are replaced by '_' 
+   * @return open success
+   */
+    bool open (std::string target_file_name_, uint32_t width_, uint32_t height_, 
+               std::string layer_ = "defects");
+
+  /**
+   * @brief Method for writing a defect outline 
+   * @param cloud_ defect points in drawing pixel coordinates (z is ignored)
+   * @param closed_ if set to true, the outline is closed 
+   * @param color_ outline color (default = "red", options = "black", "green", "blue")
+   * @return write success
+   */
+    bool addPolyline (pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_, bool closed_ = false, 
+                      std::string color_ = "red");
+
+  /**
+   * @brief Method for writing a defect outline 
+   * @param points_ defect points in drawing pixel coordinates
+   * @param closed_ if set to true, the outline is closed 
+   * @param color_ outline color (default = "red", options = "black", "green", "blue")
+   * @return write success
+   */
+    bool addPolyline (std::vector<point>* points_, bool closed_ = false, 
+                      std::string color_ = "red");
+
+  /**
+   * @brief Method for writing the file footer and closing the output file
+   * @return write success
+   */
+    bool close ();
+
+  /**
+   * @brief Accessor method to retrieve the number of defects written to the current file
+   */
+    uint32_t getNumDefects ();
+
+private: 
+
+    void beginPolyline (bool closed_, std::string color_);
+
+    void addVertex (float x_, float y_);
+
+    void endPolyline ();
+
+    std::ofstream output_stream;
+    std::string format, layer;
+    uint32_t width, height;
+    uint32_t num_defects;
+    bool first_vertex;
+
+};
+
+}
@@ -16,11 +16,18 @@
 #include <beam_calibration/DoubleSphere.h>
 #include <beam_calibration/KannalaBrandt.h>
 #include <string>
+#include <cfloat>
+#include <cmath>
 #include <Eigen/Dense>
 #include <Eigen/Geometry>
 #include <stdio.h>
 #include <optional>
 #include <nlohmann/json.hpp>
+#include "CameraModelRegistry.h"
+#include "StageTimer.h"
+#include "SolverWorkspace.h"
+#include "ImageBuffer.h"
+#include "FloatProjector.h"
 
 namespace cam_cad { 
 
@@ -73,6 +80,40 @@ public:
                         pcl::CorrespondencesPtr corrs_,
                         std::string offset_type_);
 
+  /**
+   * @brief Method to get correspondences between a CAD cloud projection and an image cloud using 
+   * the buffers and camera cloud search tree of a workspace, does not allocate once the workspace 
+   * is sized (see SolverWorkspace.h)
+   * @param CAD_cloud_ CAD structure cloud (centered, at correct scale, untransformed)
+   * @param camera_cloud_ camera image label cloud
+   * @param T_ transformation matrix to apply to CAD cloud before projecting (usually T_CS)
+   * @param corrs_ nearest-neighbor correspondences between the CAD cloud projection and the camera image cloud
+   * @param offset_type_ type of offset to use for correspondence generation (options: "center", "centroid", "none") 
+   * @param workspace_ workspace prepared with BeginProblem for these clouds, its projected cloud 
+   * receives the projection of the CAD cloud (without the offset)
+   * @param trans_cloud_ receives the transformed CAD cloud if given
+   */
+    void CorrEst (pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_,
+                        pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_,
+                        Eigen::Matrix4d &T_,
+                        pcl::CorrespondencesPtr corrs_,
+                        std::string offset_type_, 
+                        SolverWorkspace& workspace_, 
+                        pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud_ = nullptr);
+
+  /**
+   * @brief Method to transform and project a point cloud and compute the statistics of the 
+   * projection in a single pass over the points
+   * @param cloud_ point cloud to transform and project
+   * @param T_ transformation matrix 
+   * @param proj_cloud_ receives the projected planar cloud in the xy plane (capacity is reused)
+   * @param stats_ receives the centroid and bounding box center of the projected cloud
+   * @param trans_cloud_ receives the transformed cloud if given (capacity is reused)
+   */
+    void TransformProjectCloud (pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_, Eigen::Matrix4d &T_, 
+                                pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud_, CloudStats& stats_,
+                                pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud_ = nullptr);
+
   /**
    * @brief Method to apply a transform to a point cloud
    * @param cloud_ original point cloud
@@ -81,6 +122,16 @@ public:
    */
     pcl::PointCloud<pcl::PointXYZ>::Ptr TransformCloud(pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_, Eigen::Matrix4d &T_);
 
+  /**
+   * @brief Method to apply a transform to a point cloud, writing into an existing cloud 
+   * (its capacity is reused)
+   * @param cloud_ original point cloud
+   * @param T_ transformation matrix 
+   * @param trans_cloud_ receives the transformed point cloud
+   */
+    void TransformCloud(pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_, Eigen::Matrix4d &T_, 
+                        pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud_);
+
   /**
    * @brief Method to apply a transform to a point cloud by updating the original cloud
    * @param cloud_ point cloud to transform
@@ -97,6 +148,15 @@ public:
    */
     pcl::PointCloud<pcl::PointXYZ>::Ptr ProjectCloud (pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_);
 
+  /**
+   * @brief Method to use camera model to project a point cloud into the xy plane, writing into an 
+   * existing cloud (its capacity is reused)
+   * @param cloud_ point cloud to project
+   * @param proj_cloud_ receives the projected planar cloud in the xy plane
+   */
+    void ProjectCloud (pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_, 
+                       pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud_);
+
   /**
    * @brief Method to convert a vector of quaternions and translations to a transformation matrix
    * @param pose_ vector of quaternions and translations (quaternions followed by translations)
@@ -117,18 +177,42 @@ public:
    */
     std::shared_ptr<beam_calibration::CameraModel> GetCameraModel();
 
+  /**
+   * @brief Accessor method to retrieve the configuration file the camera model was read from
+   */
+    std::string GetCameraModelFile();
+
   /**
    * @brief Method to read the camera model used by the utility object from a config file
+   * the model is shared through the CameraModelRegistry, so each file is only read once per process
    * @param intrinsics_file_path_ absolute path to the camera configuration file
    */
     void ReadCameraModel (std::string intrinsics_file_path_);
 
   /**
    * @brief Setter method to set the camera ID used by the camera model
-   * this is currently only applicable to the ladybug camera model 
+   * this is currently only applicable to the ladybug camera model. The camera ID belongs to 
+   * this object, the shared model is swapped for the registry's model of that camera instead of 
+   * being modified, so other objects using the same calibration are not affected. Each camera ID 
+   * is a separate model read from the file (see CameraModelRegistry)
    * @param cam_ID_ ID of the camera intrinsics set to use
    */
     void SetCameraID (uint8_t cam_ID_);
+
+  /**
+   * @brief Setter method to run the transform and projection kernels (TransformProjectCloud, 
+   * TransformCloud and with them CorrEst) in single precision, the pose optimization always runs 
+   * in double. Camera models without a validated float projection (see FloatProjector.h) keep 
+   * projecting in double
+   * @param enable_ use the float32 path
+   */
+    void SetFloatPrecision (bool enable_);
+
+  /**
+   * @brief Accessor method to check whether projections run in single precision, i.e. the float 
+   * path is enabled and the current camera model has a validated float projection
+   */
+    bool UsesFloatProjection ();
     
   /**
    * @brief Method to apply perturbations to a transform in radians
@@ -172,6 +256,22 @@ public:
    */
     void OffsetCloudxy (pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_);
 
+  /**
+   * @brief Accessor method to retrieve the offset removed by originCloudxy 
+   * @param offset_x_ x offset (pixels)
+   * @param offset_y_ y offset (pixels)
+   * @return false if originCloudxy has not been called by this utility
+   */
+    bool GetCloudOffsetxy (double& offset_x_, double& offset_y_);
+
+  /**
+   * @brief Setter method to set the offset restored by OffsetCloudxy, used when the 
+   * cloud was centered by a different utility object
+   * @param offset_x_ x offset (pixels)
+   * @param offset_y_ y offset (pixels)
+   */
+    void SetCloudOffsetxy (double offset_x_, double offset_y_);
+
   /**
    * @brief Method to rotate a point cloud counter clockwise about the z axis by 90 degrees
    * @param cloud_ cloud to be rotated
@@ -250,22 +350,76 @@ public:
     pcl::ModelCoefficients::Ptr GetCloudPlane(pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_);
 
   /**
-   * @brief Method to get the plane that best fits a cloud 
-   * @param cloud_ point cloud
+   * @brief Method to get the structure plane in the camera frame directly from the camera pose 
+   * the CAD cloud lies in the z = 0 plane of the structure frame, so the plane is exact 
+   * and does not depend on the cloud points or the cloud scale
+   * @param T_ structure -> camera transformation matrix (T_CS)
    * @return pcl model coefficients object, planar equation coefficients are given in form: 
    * [0] = a , [1] = b, [2] = c, [3] = d 
+   */
+    pcl::ModelCoefficients::Ptr GetStructurePlane(Eigen::Matrix4d &T_);
+
+  /**
+   * @brief Method to back project image points onto a plane fit to the transformed CAD cloud
+   * this is the fallback for structure clouds that are not planar, for planar structures 
+   * the overload taking the camera pose should be used 
+   * @param image_cloud_ image points to back project (pixels)
+   * @param cad_cloud_ CAD cloud transformed to the camera frame
+   * @param target_plane_ plane to back project onto (see GetCloudPlane)
+   * @return back projected points in the camera frame, in the order of image_cloud_. Pixels that can 
+   * not be back projected onto the plane (no ray, or a ray parallel to or pointing away from the 
+   * plane) are dropped, so fewer points than pixels are returned
    */
     pcl::PointCloud<pcl::PointXYZ>::Ptr BackProject(pcl::PointCloud<pcl::PointXYZ>::ConstPtr image_cloud_, 
                                                     pcl::PointCloud<pcl::PointXYZ>::ConstPtr cad_cloud_, 
                                                     pcl::ModelCoefficients::ConstPtr target_plane_);
 
+  /**
+   * @brief Method to back project image points onto the structure plane given by the camera pose 
+   * @param image_cloud_ image points to back project (pixels)
+   * @param T_ structure -> camera transformation matrix (T_CS)
+   * @return back projected points in the camera frame, pixels that can not be back projected are 
+   * dropped as for the overload above
+   */
+    pcl::PointCloud<pcl::PointXYZ>::Ptr BackProject(pcl::PointCloud<pcl::PointXYZ>::ConstPtr image_cloud_, 
+                                                    Eigen::Matrix4d &T_);
+
+  /**
+   * @brief Method to transfer labelled camera image shapes (e.g. every defect of an image) to the 
+   * CAD drawing together: the pixels of all shapes are back projected onto the structure plane as 
+   * one batch and mapped to CAD pixels (T_SC, inverse cloud scale and the offset restored by 
+   * OffsetCloudxy) by a single affine transform. This can only be used after having called 
+   * originCloudxy or SetCloudOffsetxy with the same utility object
+   * @param shapes_camera_ shapes in camera image pixels
+   * @param T_ structure -> camera transformation matrix (T_CS)
+   * @param cloud_scale_ scale applied to the CAD cloud for the solution
+   * @param shapes_CAD_ vector the shapes in CAD pixels are appended to, with the labels, IDs and 
+   * order of the input shapes
+   * @return false if the offset is unknown or a pixel could not be back projected onto the structure 
+   * plane (no ray, or a ray parallel to or pointing away from the plane), its point is dropped
+   */
+    bool TransferShapes(const std::vector<LabelledShape>& shapes_camera_, Eigen::Matrix4d &T_, 
+                        double cloud_scale_, std::vector<LabelledShape>* shapes_CAD_);
+
 private: 
 
     pcl::PointXYZ GetCloudCentroid(pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_); 
 
     pcl::PointXYZ GetCloudCenter(pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_);
 
-    void OffsetCloud(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_, Eigen::Vector3d offset_);
+    CloudStats GetCloudStats(pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_);
+
+    // kernel of TransformProjectCloud in the precision of Scalar, project_ maps a camera frame 
+    // point to a pixel and returns false if it is not visible
+    template <typename Scalar, typename Project>
+    void TransformProjectPoints(pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_, Eigen::Matrix4d &T_, 
+                                pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud_, CloudStats& stats_,
+                                pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud_, Project project_);
+
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr BackProjectToPlane(pcl::PointCloud<pcl::PointXYZ>::ConstPtr image_cloud_, 
+                                                           const Eigen::Vector3d& plane_normal_, 
+                                                           const Eigen::Vector3d& plane_point_);
 
     Eigen::Matrix3d LieAlgebraToR(const Eigen::Vector3d& eps);
 
@@ -274,10 +428,15 @@ private:
     double DegToRad(double d);
 
     std::shared_ptr<beam_calibration::CameraModel> camera_model;
+    std::string camera_model_file_;
 
     double image_offset_x_, image_offset_y_; 
     bool center_image_called_;
 
+    bool float_precision_;
+    FloatProjector float_projector;
+    const beam_calibration::CameraModel* float_projector_tried_; // last model Init was run for
+
 };
 
 
@@ -19,45 +19,117 @@
 #include <chrono>
 #include <boost/make_shared.hpp>
 #include <atomic>
+#include <memory>
+#include <set>
+#include <vector>
 
-namespace cam_cad { 
+namespace cam_cad {
+
+/**
+ * @brief Struct for one cloud of a visualizer scene
+ */
+struct VisCloud {
+    std::string id;
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud;
+    uint8_t point_size = 1;
+    double r = -1, g = -1, b = -1; // color in [0, 1], negative = default (white)
+};
+
+/**
+ * @brief Struct for correspondence lines between two clouds of a visualizer scene
+ */
+struct VisCorrespondences {
+    std::string id;
+    std::string source_id;          // cloud of index_query
+    std::string target_id;          // cloud of index_match
+    pcl::CorrespondencesConstPtr corrs;
+};
+
+/**
+ * @brief Struct for a complete visualizer scene: any number of clouds and correspondence sets
+ * Clouds and correspondences of a published scene are read by the render thread and must not be
+ * modified afterwards, the displayClouds methods take copies (snapshots) of their inputs.
+ */
+struct VisScene {
+    std::vector<VisCloud> clouds;
+    std::vector<VisCorrespondences> correspondences;
+
+  /**
+   * @brief Method to add a copy of a cloud to the scene
+   * @param cloud_ point cloud to display
+   * @param id_ unique cloud id for display
+   * @param point_size_ rendered point size
+   */
+    void addCloud (pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_, std::string id_,
+                   uint8_t point_size_ = 1);
+
+  /**
+   * @brief Method to add a copy of correspondences between two clouds of the scene
+   * @param corrs_ correspondences (index_query -> source cloud, index_match -> target cloud)
+   * @param source_id_ id of the source cloud
+   * @param target_id_ id of the target cloud
+   * @param id_ unique id of the correspondence set
+   */
+    void addCorrespondences (pcl::CorrespondencesConstPtr corrs_, std::string source_id_,
+                             std::string target_id_, std::string id_ = "correspondences");
+};
 
 /**
  * @brief Interactive visualizer class to display point clouds and correspondences
- * Note: to use: 
+ * Note: to use:
  * 1. create visualizer instance
  * 2. call startVis()
- * 3. call desired displayClouds() version
+ * 3. call displayScene() or the desired displayClouds() version
  * 4. call endVis()
+ *
+ * The display methods never block: each call publishes a complete scene snapshot through a
+ * lock-free triple buffer, and the render thread (which owns the PCL window) picks up the latest
+ * scene at its next frame. Scenes published faster than the frame rate replace each other, only
+ * the most recent one is shown. One thread at a time may publish scenes to a visualizer.
  */
 class Visualizer{
-public: 
+public:
 
     /**
-     * @brief Constructor 
+     * @brief Constructor
      * @param name_ display name
      */
-    Visualizer(const std::string name_); 
+    Visualizer(const std::string name_);
 
     /**
-     * @brief Empty destructor 
+     * @brief Destructor, ends the visualizer thread if it is still running
      */
-    ~Visualizer(); 
+    ~Visualizer();
 
     /**
-     * @brief Starts visualizer in a new thread 
-     * @param coord_size size of the coordinate axes to display 
+     * @brief Starts visualizer in a new thread
+     * @param coord_size size of the coordinate axes to display
+     * @param frame_ms maximum time between frames (and for a published scene to appear)
      */
-    void startVis(uint16_t coord_size = 100); 
+    void startVis(uint16_t coord_size = 100, uint16_t frame_ms = 16);
 
     /**
-     * @brief Ends visualizer thread
-     * @todo get display window to close when called, currently hangs until end of program 
+     * @brief Ends visualizer thread and closes the display window
      */
     void endVis();
 
     /**
-     * @brief Method to display one point cloud 
+     * @brief Method to publish a scene, replacing the displayed one. Clouds of the previous
+     * scene that are not part of the new one are removed
+     * @param scene_ scene to display
+     */
+    void displayScene(std::shared_ptr<const VisScene> scene_);
+
+    /**
+     * @brief Method to display any number of point clouds
+     * @param clouds_ point clouds to display
+     * @param ids_ unique cloud ids for display (one per cloud)
+     */
+    void displayClouds(const std::vector<pcl::PointCloud<pcl::PointXYZ>::ConstPtr>& clouds_,
+                       const std::vector<std::string>& ids_);
+
+    /**
+     * @brief Method to display one point cloud
      * @param cloud_ point cloud to display
      * @param id_ unique cloud id for display
      */
@@ -84,7 +156,7 @@ public:
      * @param id2_ unique cloud id for display
      * @param id3_ unique cloud id for display
      */
-    void displayClouds(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud1_, 
+    void displayClouds(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud1_,
                        pcl::PointCloud<pcl::PointXYZ>::Ptr cloud2_,
                        pcl::PointCloud<pcl::PointXYZ>::Ptr cloud3_,
                        std::string id1_,
@@ -102,7 +174,7 @@ public:
      * @param id3_ unique cloud id for display
      * @param id4_ unique cloud id for display
      */
-    void displayClouds(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud1_, 
+    void displayClouds(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud1_,
                        pcl::PointCloud<pcl::PointXYZ>::Ptr cloud2_,
                        pcl::PointCloud<pcl::PointXYZ>::Ptr cloud3_,
                        pcl::PointCloud<pcl::PointXYZ>::Ptr cloud4_,
@@ -112,7 +184,7 @@ public:
                        std::string id4_);
 
     /**
-     * @brief Method to display an image cloud, projected cloud and correspondences 
+     * @brief Method to display an image cloud, projected cloud and correspondences
      * @param image_cloud_ labelled image point cloud
      * @param projected_cloud_ projected CAD point cloud
      * @param corrs_ correspondences between projected point cloud and labelled image cloud
@@ -126,9 +198,9 @@ public:
                             std::string id_projected_);
 
     /**
-     * @brief Method to display an image cloud, CAD cloud, projected cloud and correspondences 
+     * @brief Method to display an image cloud, CAD cloud, projected cloud and correspondences
      * @param image_cloud_ labelled image point cloud
-     * @param CAD_cloud_ CAD cloud 
+     * @param CAD_cloud_ CAD cloud
      * @param projected_cloud_ projected CAD point cloud
      * @param corrs_ correspondences between projected point cloud and labelled image cloud
      * @param id_image_ unique cloud id for display
@@ -143,21 +215,44 @@ public:
                             std::string id_CAD_,
                             std::string id_projected_);
 
-private: 
+    /**
+     * @brief Accessor method to retrieve the number of scenes published so far
+     */
+    uint64_t getNumPublished();
+
+    /**
+     * @brief Accessor method to retrieve the number of scenes rendered so far, published scenes
+     * that were replaced before the next frame are not rendered
+     */
+    uint64_t getNumRendered();
+
+private:
     pcl::visualization::PCLVisualizer::Ptr point_cloud_display;
     std::thread vis_thread;
 
-    //mutex for the point_cloud_display object, held by the main thread when updating the visualization params
-    std::mutex mtx;
-
     std::string display_name;
+    uint16_t coord_size_, frame_ms_;
 
     std::atomic_flag continueFlag = ATOMIC_FLAG_INIT;
-    bool display1_called, display2_called, display3_called, display4_called, display5_called, display6_called;
+
+    // triple buffer: the publisher owns the back slot, the render thread the front slot,
+    // the middle slot is exchanged atomically (index in bits 0-1, bit 2 set when it holds a new scene)
+    static const uint8_t NEW_SCENE = 4;
+    std::shared_ptr<const VisScene> scenes[3];
+    uint8_t back_index, front_index;
+    std::atomic<uint8_t> middle_state;
+
+    std::atomic<uint64_t> num_published, num_rendered;
+
+    // render thread state: ids of the clouds and correspondence sets currently displayed
+    std::set<std::string> displayed_clouds, displayed_corrs;
 
     //vis thread method in which the visualizer spins
     void spin();
 
+    //applies the latest published scene, render thread only
+    void renderScene(const VisScene& scene_);
+
 };
 
 
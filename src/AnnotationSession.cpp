@@ -0,0 +1,158 @@
+#include "AnnotationSession.h"
+
+namespace cam_cad
+{
+
+    AnnotationSession::AnnotationSession() 
+    {
+        num_layers = 0;
+    }
+
+    bool AnnotationSession::open(std::string src_file_name_)
+    {
+        StageTimer timer("image_read");
+
+        image = cv::imread(src_file_name_, 1);
+        num_layers = 0;
+
+        if (image.empty())
+        {
+            std::cout << "failed to open image:" << src_file_name_ << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool AnnotationSession::addPoints(std::vector<point> *points_, std::string color_)
+    {
+        if (image.empty())
+            return false;
+
+        cv::Vec3b color = getColor(color_);
+
+        for (uint32_t i = 0; i < points_->size(); i++)
+        {
+            int u = points_->at(i).x;
+            int v = points_->at(i).y;
+
+            // skip points that were transferred outside of the drawing
+            if (u < 0 || v < 0 || u >= image.cols || v >= image.rows)
+                continue;
+
+            image.at<cv::Vec3b>(v, u) = color;
+        }
+
+        num_layers++;
+
+        return true;
+    }
+
+    bool AnnotationSession::addPolyline(std::vector<point> *points_, std::string color_, 
+                                        uint16_t thickness_, bool closed_)
+    {
+        if (image.empty())
+            return false;
+
+        cv::Vec3b color = getColor(color_);
+        std::vector<std::vector<cv::Point>> lines(1, toPixels(points_));
+
+        // opencv clips lines to the image bounds
+        cv::polylines(image, lines, closed_, cv::Scalar(color[0], color[1], color[2]), 
+                      thickness_, cv::LINE_8);
+
+        num_layers++;
+
+        return true;
+    }
+
+    bool AnnotationSession::addPolygon(std::vector<point> *points_, std::string color_)
+    {
+        if (image.empty())
+            return false;
+
+        cv::Vec3b color = getColor(color_);
+        std::vector<std::vector<cv::Point>> polygons(1, toPixels(points_));
+
+        cv::fillPoly(image, polygons, cv::Scalar(color[0], color[1], color[2]), cv::LINE_8);
+
+        num_layers++;
+
+        return true;
+    }
+
+    bool AnnotationSession::write(std::string target_file_name_)
+    {
+        StageTimer timer("image_write");
+
+        if (image.empty())
+        {
+            std::cout << "no image to write, open() must be called first" << std::endl;
+            return false;
+        }
+
+        return cv::imwrite(target_file_name_, image);
+    }
+
+    uint32_t AnnotationSession::getNumLayers()
+    {
+        return num_layers;
+    }
+
+    uint32_t AnnotationSession::getWidth()
+    {
+        return image.cols;
+    }
+
+    uint32_t AnnotationSession::getHeight()
+    {
+        return image.rows;
+    }
+
+    cv::Vec3b AnnotationSession::getColor(std::string color_)
+    {
+        cv::Vec3b color;
+
+        color[0] = 0;
+        color[1] = 0;
+        color[2] = 0;
+
+        if (color_ == "red")
+        {
+            color[0] = 255;
+            color[1] = 0;
+            color[2] = 0;
+        }
+
+        if (color_ == "green")
+        {
+            color[0] = 0;
+            color[1] = 255;
+            color[2] = 0;
+        }
+
+        if (color_ == "blue")
+        {
+            color[0] = 0;
+            color[1] = 0;
+            color[2] = 255;
+        }
+
+        return color;
+    }
+
+    std::vector<cv::Point> AnnotationSession::toPixels(std::vector<point> *points_)
+    {
+        std::vector<cv::Point> pixels;
+        pixels.reserve(points_->size());
+
+        for (uint32_t i = 0; i < points_->size(); i++)
+        {
+            pixels.push_back(cv::Point(std::round(points_->at(i).x), 
+                                       std::round(points_->at(i).y)));
+        }
+
+        return pixels;
+    }
+
+} // namespace cam_cad
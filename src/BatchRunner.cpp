@@ -0,0 +1,822 @@
+#include "BatchRunner.h"
+
+using json = nlohmann::json;
+
+namespace cam_cad {
+
+BatchRunner::BatchRunner() {
+    num_workers = 0;
+    camera_density = 10;
+    CAD_density = 2;
+    simplify_tolerance = 0;
+    joint_refinement = false;
+    joint_min_images = 2;
+    record_iterations = 32;
+    rendering_format = "png";
+    wall_time_ms = 0;
+    cache_parameters_read = false;
+    cache_parameters_hash = 0;
+    cache_cloud_scale = 0;
+}
+
+bool BatchRunner::ReadManifest (std::string manifest_file_name_) {
+    std::ifstream file(manifest_file_name_);
+
+    if (!file.is_open()) {
+        std::cout << "failed to open manifest:" << manifest_file_name_ << std::endl;
+        return false;
+    }
+
+    try {
+        file >> manifest;
+    }
+    catch (const nlohmann::json::exception& e) {
+        std::cout << "failed to parse manifest:" << manifest_file_name_ << " " << e.what() << std::endl;
+        return false;
+    }
+
+    size_t dir_end = manifest_file_name_.find_last_of('/');
+    manifest_dir = (dir_end == std::string::npos) ? "." : manifest_file_name_.substr(0, dir_end);
+
+    if (!manifest.is_object() || !manifest.contains("solution_parameters") || !manifest.contains("jobs") ||
+        !manifest["jobs"].is_array()) {
+        std::cout << "manifest must contain \"solution_parameters\" and a \"jobs\" array" << std::endl;
+        return false;
+    }
+
+    // a key of the wrong type fails the manifest instead of the run
+    try {
+        solution_parameters_file = ResolvePath(manifest["solution_parameters"]);
+        results_file = manifest.contains("results") ? ResolvePath(manifest["results"]) : "";
+        num_workers = manifest.value("workers", 0);
+        camera_density = manifest.value("camera_density", 10);
+        CAD_density = manifest.value("CAD_density", 2);
+        simplify_tolerance = manifest.value("simplify_tolerance", 0.0f);
+        recordings_dir = manifest.contains("recordings") ? ResolvePath(manifest["recordings"]) : "";
+        record_iterations = manifest.value("record_iterations", 32);
+        renderings_dir = manifest.contains("renderings") ? ResolvePath(manifest["renderings"]) : "";
+        rendering_format = manifest.value("rendering_format", "png");
+        edge_map_parameters = manifest.contains("edge_map") ? 
+            EdgeMapParameters(manifest["edge_map"]) : EdgeMapParameters();
+        joint_refinement = manifest.value("joint_refinement", false);
+        joint_min_images = manifest.value("joint_min_images", 2);
+        solution_cache_file = manifest.contains("solution_cache") ? ResolvePath(manifest["solution_cache"]) : "";
+        solution_cache.SetMaxEntries(manifest.value("solution_cache_size", 10000));
+    }
+    catch (const nlohmann::json::exception& e) {
+        std::cout << "invalid manifest:" << manifest_file_name_ << " " << e.what() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void BatchRunner::SetNumWorkers (uint16_t num_workers_) {
+    num_workers = num_workers_;
+}
+
+bool BatchRunner::Run () {
+    const json& jobs = manifest["jobs"];
+    size_t num_jobs = jobs.size();
+
+    results.assign(num_jobs, BatchJobResult());
+    joint_results.clear();
+
+    uint16_t workers = num_workers;
+    if (workers == 0) 
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    if (workers > num_jobs) 
+        workers = std::max<size_t>(1, num_jobs);
+
+    printf("running %zu jobs on %u workers \n", num_jobs, workers);
+
+    // an unreadable cache only costs this run its lookups, it is replaced when the run ends
+    if (!solution_cache_file.empty() && !solution_cache.Load(solution_cache_file)) 
+        printf("ignoring unreadable solution cache %s, every job is solved \n", solution_cache_file.c_str());
+
+    // without readable solution parameters every job is solved, and fails on them
+    cache_parameters_read = !solution_cache_file.empty() && ReadCacheParameters();
+
+    auto start = std::chrono::steady_clock::now();
+
+    // the solvers of a worker share its workspace, so iteration clouds are allocated once per worker
+    std::vector<std::shared_ptr<SolverWorkspace>> workspaces;
+    for (uint16_t i = 0; i < workers; i++) 
+        workspaces.push_back(std::make_shared<SolverWorkspace>());
+
+    // each worker takes the next job until none are left
+    auto run_workers = [&](std::function<void (size_t, std::shared_ptr<SolverWorkspace>)> task_) {
+        std::atomic<size_t> next_job(0);
+        std::vector<std::thread> worker_threads;
+
+        for (uint16_t i = 0; i < workers; i++) {
+            std::shared_ptr<SolverWorkspace> workspace = workspaces[i];
+
+            worker_threads.push_back(std::thread([&, workspace]() {
+                size_t job_index;
+                while ((job_index = next_job++) < num_jobs) {
+                    // a malformed job fails alone instead of terminating the batch
+                    try {
+                        task_(job_index, workspace);
+                    }
+                    catch (const std::exception& e) {
+                        const json& id = jobs[job_index].is_object() ? jobs[job_index].value("id", json()) : json();
+                        results[job_index].id = id.is_string() ? id.get<std::string>() : id.dump();
+                        results[job_index].success = false;
+                        results[job_index].error = e.what();
+                    }
+                }
+            }));
+        }
+
+        for (auto& worker : worker_threads) 
+            worker.join();
+    };
+
+    if (!joint_refinement) {
+        run_workers([&](size_t job_index_, std::shared_ptr<SolverWorkspace> workspace_) {
+            results[job_index_] = RunJob(jobs[job_index_], workspace_);
+        });
+    }
+    else {
+        // all poses are solved before any defect is transferred, so the transfer uses the 
+        // jointly refined poses and CAD scale
+        std::vector<BatchJobState> states(num_jobs);
+
+        run_workers([&](size_t job_index_, std::shared_ptr<SolverWorkspace> workspace_) {
+            results[job_index_] = SolveJob(jobs[job_index_], workspace_, &states[job_index_]);
+        });
+
+        try {
+            RefineJointly(states);
+        }
+        catch (const std::exception& e) {
+            printf("joint refinement failed - %s, keeping the independent solutions\n", e.what());
+        }
+
+        run_workers([&](size_t job_index_, std::shared_ptr<SolverWorkspace> workspace_) {
+            if (states[job_index_].solved) 
+                OutputJob(jobs[job_index_], states[job_index_], &results[job_index_]);
+        });
+    }
+
+    for (uint16_t i = 0; i < workers; i++) {
+        printf("worker %u ", i);
+        workspaces[i]->PrintStats();
+    }
+
+    // a cache that can not be written only costs the next run its lookups
+    if (!solution_cache_file.empty()) 
+        solution_cache.Save(solution_cache_file);
+
+    wall_time_ms = std::chrono::duration<double, std::milli>
+        (std::chrono::steady_clock::now() - start).count();
+
+    bool all_succeeded = true;
+    for (auto& result : results) 
+        all_succeeded &= result.success;
+
+    return all_succeeded;
+}
+
+BatchJobResult BatchRunner::RunJob (const json& job_, std::shared_ptr<SolverWorkspace> workspace_) {
+    BatchJobState state;
+    BatchJobResult result = SolveJob(job_, workspace_, &state);
+
+    if (state.solved) 
+        OutputJob(job_, state, &result);
+
+    return result;
+}
+
+BatchJobResult BatchRunner::SolveJob (const json& job_, std::shared_ptr<SolverWorkspace> workspace_, 
+                                      BatchJobState* state_) {
+    BatchJobResult result;
+    result.id = job_.value("id", "");
+
+    auto job_start = std::chrono::steady_clock::now();
+    auto stage_start = job_start;
+
+    // elapsed time since the previous stage in ms
+    auto lap = [&stage_start]() {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - stage_start).count();
+        stage_start = now;
+        return ms;
+    };
+
+    bool edge_input = job_.contains("camera_image");
+
+    if ((!job_.contains("camera_labels") && !edge_input) || !job_.contains("CAD_labels")) {
+        result.error = "job must contain \"camera_labels\" or \"camera_image\", and \"CAD_labels\"";
+        return result;
+    }
+
+    // the key only depends on the files and parameters of the job, so a cached solution is found 
+    // before any of them is read, recordings and renderings are outputs of the solve itself, so 
+    // their jobs are always solved
+    uint64_t solution_key = 0;
+    bool use_cache = cache_parameters_read && recordings_dir.empty() && renderings_dir.empty() && 
+        SolutionKey(job_, solution_key);
+
+    // only converged solutions are cached, older cache files may still hold others
+    CachedSolution cached;
+    bool cache_hit = use_cache && solution_cache.Get(solution_key, cached) && cached.converged;
+
+    auto use_cached = [&]() {
+        result.cached = true;
+        result.converged = cached.converged;
+        result.T_CS = cached.T_CS;
+        result.initial_pixel_error = cached.initial_pixel_error;
+        result.final_pixel_error = cached.final_pixel_error;
+        result.solution_iterations = cached.solution_iterations;
+    };
+
+    // the joint refinement continues from the camera clouds and measured poses, so without it 
+    // a cached job only needs the camera model and the CAD offset of its defect transfer
+    if (cache_hit && !joint_refinement) {
+        std::shared_ptr<Util> util (new Util);
+        util->ReadCameraModel(job_.contains("camera_model") ? 
+                              ResolvePath(job_["camera_model"]) : cache_camera_model);
+
+        if (job_.contains("camera_id")) 
+            util->SetCameraID(job_["camera_id"].get<uint8_t>());
+
+        std::shared_ptr<const PreparedCAD> CAD = 
+            CAD_cache.Get(ResolvePath(job_["CAD_labels"]), CAD_density, cache_cloud_scale, 
+                          simplify_tolerance);
+
+        if (CAD == nullptr) {
+            result.error = "failed to read CAD labels";
+            return result;
+        }
+
+        util->SetCloudOffsetxy(CAD->offset_x, CAD->offset_y);
+
+        result.read_ms = lap();
+        use_cached();
+        result.total_ms = std::chrono::duration<double, std::milli>
+            (std::chrono::steady_clock::now() - job_start).count();
+
+        state_->util = util;
+        state_->CAD = CAD;
+        state_->cloud_scale = cache_cloud_scale;
+        state_->solved = true;
+
+        return result;
+    }
+
+    //image and CAD data input block//
+
+    ImageBuffer image_buffer;
+
+    // camera clouds to solve in order, from the coarsest to the finest edge map level
+    std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr> camera_clouds;
+
+    if (edge_input) {
+        EdgeMapParameters params = edge_map_parameters;
+        if (job_.contains("roi")) 
+            params.roi = EdgeMapParameters(json{{"roi", job_["roi"]}}).roi;
+
+        EdgeMap edge_map(params);
+
+        if (!edge_map.Extract(ResolvePath(job_["camera_image"]))) {
+            result.error = "failed to read camera image";
+            return result;
+        }
+
+        for (int level = edge_map.GetNumLevels() - 1; level >= 0; level--) {
+            std::vector<point> edge_points;
+            edge_map.GetPoints(level, &edge_points);
+            if (edge_points.empty()) continue;
+
+            pcl::PointCloud<pcl::PointXYZ>::Ptr edge_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+            image_buffer.populateCloud(&edge_points, edge_cloud, 0);
+            camera_clouds.push_back(edge_cloud);
+        }
+
+        if (camera_clouds.empty()) {
+            result.error = "no edges found in camera image";
+            return result;
+        }
+    }
+    else {
+        std::vector<point> input_points_camera; 
+        pcl::PointCloud<pcl::PointXYZ>::Ptr input_cloud_camera 
+            (new pcl::PointCloud<pcl::PointXYZ>);
+
+        if (!image_buffer.readPoints(ResolvePath(job_["camera_labels"]), &input_points_camera)) {
+            result.error = "failed to read camera labels";
+            return result;
+        }
+
+        result.num_simplified_points = image_buffer.simplifyPoints(&input_points_camera, simplify_tolerance);
+        image_buffer.densifyPoints(&input_points_camera, camera_density);
+        image_buffer.populateCloud(&input_points_camera, input_cloud_camera, 0);
+        camera_clouds.push_back(input_cloud_camera);
+    }
+
+    std::shared_ptr<Util> util (new Util);
+    std::shared_ptr<Visualizer> vis (new Visualizer ("solution visualizer"));
+
+    Solver solver(vis, util, solution_parameters_file);
+    solver.SetWorkspace(workspace_);
+
+    // the CAD cloud is prepared once for all jobs of the same CAD face
+    std::shared_ptr<const PreparedCAD> CAD = 
+        CAD_cache.Get(ResolvePath(job_["CAD_labels"]), CAD_density, solver.GetCloudScale(), 
+                      simplify_tolerance);
+
+    if (CAD == nullptr) {
+        result.error = "failed to read CAD labels";
+        return result;
+    }
+
+    // restores the CAD offset of the transferred defects
+    util->SetCloudOffsetxy(CAD->offset_x, CAD->offset_y);
+
+    //Solver Block*******************//
+
+    // workers can not block on console input
+    solver.SetVisualization(false);
+
+    if (job_.contains("camera_model")) 
+        solver.SetCameraModel(ResolvePath(job_["camera_model"]));
+
+    if (job_.contains("camera_id")) 
+        util->SetCameraID(job_["camera_id"].get<uint8_t>());
+
+    if (!LoadPose(solver, job_)) {
+        result.error = "failed to load initial pose";
+        return result;
+    }
+
+    // the measured pose, before any solution, for the translation prior of the joint refinement
+    state_->T_CS_measured = solver.GetTransform();
+
+    // failed solutions are recorded for inspection after the run
+    if (!recordings_dir.empty()) 
+        solver.SetRecorder(std::make_shared<SolveRecorder>(record_iterations));
+
+    // jobs render to their own outputs
+    if (!renderings_dir.empty()) {
+        std::string output = renderings_dir + "/" + result.id;
+        if (rendering_format != "png") output += "." + rendering_format;
+        solver.SetRenderer(std::make_shared<ConvergenceRenderer>(output));
+    }
+
+    result.read_ms = lap();
+
+    if (cache_hit) {
+        use_cached();
+    }
+    else {
+        // every level continues from the pose the solver reached on the previous (coarser) one
+        for (size_t level = 0; level < camera_clouds.size(); level++) {
+            result.converged = solver.SolveOptimization(CAD, camera_clouds[level]);
+
+            if (level == 0) 
+                result.initial_pixel_error = solver.GetInitialPixelError();
+            result.solution_iterations += solver.GetSolutionIterations();
+        }
+
+        if (!result.converged && solver.GetRecorder() != nullptr && !recordings_dir.empty()) 
+            solver.GetRecorder()->Save(recordings_dir + "/" + result.id + ".rec");
+
+        // waits for the queued frames so the job's output is complete
+        if (solver.GetRenderer() != nullptr) 
+            solver.GetRenderer()->Close();
+
+        result.T_CS = solver.GetTransform();
+        result.final_pixel_error = solver.GetFinalPixelError();
+
+        // a solution that did not converge is solved again by the next run
+        if (use_cache && result.converged) {
+            cached.T_CS = result.T_CS;
+            cached.converged = result.converged;
+            cached.initial_pixel_error = result.initial_pixel_error;
+            cached.final_pixel_error = result.final_pixel_error;
+            cached.solution_iterations = result.solution_iterations;
+            solution_cache.Put(solution_key, cached);
+        }
+    }
+
+    result.solve_ms = lap();
+    result.total_ms = std::chrono::duration<double, std::milli>
+        (std::chrono::steady_clock::now() - job_start).count();
+
+    state_->util = util;
+    state_->CAD = CAD;
+    state_->camera_cloud = camera_clouds.back();
+    state_->cloud_scale = solver.GetCloudScale();
+    state_->solved = true;
+
+    return result;
+}
+
+void BatchRunner::OutputJob (const json& job_, const BatchJobState& state_, BatchJobResult* result_) {
+    BatchJobResult& result = *result_;
+    std::shared_ptr<Util> util = state_.util;
+    ImageBuffer image_buffer;
+
+    auto output_start = std::chrono::steady_clock::now();
+    auto stage_start = output_start;
+
+    // elapsed time since the previous stage in ms
+    auto lap = [&stage_start]() {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - stage_start).count();
+        stage_start = now;
+        return ms;
+    };
+
+    //Defect transfer block**********//
+
+    if (result.converged && job_.contains("defect_labels")) {
+        std::vector<LabelledShape> defects_camera, defects_CAD;
+
+        if (!image_buffer.readShapes(ResolvePath(job_["defect_labels"]), &defects_camera)) {
+            result.error = "failed to read defect labels";
+            return;
+        }
+
+        // every defect of the image is back projected onto the structure plane and returned 
+        // to the CAD frame in one pass, pixels that miss the structure plane are dropped and counted
+        bool transferred = util->TransferShapes(defects_camera, result.T_CS, state_.cloud_scale, &defects_CAD);
+
+        if (!transferred && defects_CAD.size() != defects_camera.size()) {
+            result.error = "failed to transfer defects";
+            return;
+        }
+
+        result.num_defects = defects_CAD.size();
+        for (size_t i = 0; i < defects_CAD.size(); i++) {
+            result.num_defect_points += defects_CAD[i].points.size();
+            result.num_dropped_points += defects_camera[i].points.size() - defects_CAD[i].points.size();
+        }
+
+        result.transfer_ms = lap();
+
+        uint32_t CAD_width = 0, CAD_height = 0;
+        AnnotationSession session;
+
+        // the vector overlay is sized to the CAD image, or to the image of the CAD labels
+        if (job_.contains("CAD_image") && (job_.contains("output_image") || job_.contains("output_vector"))) {
+            if (!session.open(ResolvePath(job_["CAD_image"]))) {
+                result.error = "failed to read CAD image";
+                return;
+            }
+
+            CAD_width = session.getWidth();
+            CAD_height = session.getHeight();
+        }
+        else if (job_.contains("output_vector") && 
+                 !ReadImageSize(ResolvePath(job_["CAD_labels"]), &CAD_width, &CAD_height)) {
+            result.error = "output_vector needs a CAD_image or CAD labels with imageWidth and imageHeight";
+            return;
+        }
+
+        if (job_.contains("CAD_image") && job_.contains("output_image")) {
+            for (auto& defect : defects_CAD) 
+                session.addPolyline(&defect.points, "red", 1, defect.closed);
+
+            if (!session.write(ResolvePath(job_["output_image"]))) {
+                result.error = "failed to write output image";
+                return;
+            }
+        }
+
+        if (job_.contains("output_vector")) {
+            VectorWriter vector_writer;
+            bool written = vector_writer.open(ResolvePath(job_["output_vector"]), CAD_width, CAD_height);
+
+            for (auto& defect : defects_CAD) 
+                written = written && vector_writer.addPolyline(&defect.points, defect.closed);
+
+            if (!vector_writer.close() || !written) {
+                result.error = "failed to write output vector overlay";
+                return;
+            }
+        }
+
+        if (job_.contains("output_defects")) {
+            json J;
+            J["defects"] = json::array();
+            for (auto& defect : defects_CAD) {
+                json points = json::array();
+                for (auto& p : defect.points) 
+                    points.push_back({p.x, p.y});
+                J["defects"].push_back({{"label", defect.label}, {"id", defect.id}, 
+                                        {"closed", defect.closed}, {"points", points}});
+            }
+
+            std::ofstream file(ResolvePath(job_["output_defects"]));
+
+            if (!file.is_open()) {
+                result.error = "failed to write output defects";
+                return;
+            }
+
+            file << J.dump(2);
+        }
+    }
+
+    if (job_.contains("output_pose")) {
+        json J;
+        J["converged"] = result.converged;
+        J["T_CS"] = json::array();
+        for (uint8_t row = 0; row < 4; row++)
+            for (uint8_t col = 0; col < 4; col++)
+                J["T_CS"].push_back(result.T_CS(row, col));
+
+        std::ofstream file(ResolvePath(job_["output_pose"]));
+
+        if (!file.is_open()) {
+            result.error = "failed to write output pose";
+            return;
+        }
+
+        file << J.dump(2);
+    }
+
+    result.write_ms = lap();
+    result.total_ms += std::chrono::duration<double, std::milli>
+        (std::chrono::steady_clock::now() - output_start).count();
+    result.success = true;
+}
+
+void BatchRunner::RefineJointly (std::vector<BatchJobState>& states_) {
+    const json& jobs = manifest["jobs"];
+
+    // jobs of the same CAD face share its prepared cloud, whose hash covers the label file and 
+    // its preparation
+    std::map<uint64_t, std::vector<size_t>> faces;
+    for (size_t i = 0; i < states_.size(); i++) {
+        if (states_[i].solved) 
+            faces[states_[i].CAD->hash].push_back(i);
+    }
+
+    for (auto& face : faces) {
+        const std::vector<size_t>& job_indices = face.second;
+        if (job_indices.size() < std::max<uint32_t>(joint_min_images, 1)) continue;
+
+        auto start = std::chrono::steady_clock::now();
+
+        JointSolver joint_solver(solution_parameters_file);
+        joint_solver.SetCloudScale(states_[job_indices[0]].cloud_scale);
+
+        // the defects are transferred with the camera model of each job, so poses refined 
+        // together with intrinsics that are never applied would not match the transfer
+        if (joint_solver.GetRefineIntrinsics()) {
+            printf("refine_intrinsics is not supported in batch mode, refining poses and scale only \n");
+            joint_solver.SetRefineIntrinsics(false);
+        }
+
+        // the independent solutions are the starting point
+        std::vector<JointImage> images;
+        for (size_t job_index : job_indices) {
+            JointImage image;
+            image.id = results[job_index].id;
+            image.util = states_[job_index].util;
+            image.camera_cloud = states_[job_index].camera_cloud;
+            image.T_CS = results[job_index].T_CS;
+            image.T_CS_measured = states_[job_index].T_CS_measured;
+            images.push_back(image);
+        }
+
+        BatchJointResult joint;
+        joint.CAD_labels = ResolvePath(jobs[job_indices[0]]["CAD_labels"]);
+        joint.num_images = images.size();
+        joint.converged = joint_solver.Solve(states_[job_indices[0]].CAD->cloud, &images);
+        joint.cloud_scale = joint_solver.GetCloudScale();
+        joint.initial_pixel_error = joint_solver.GetInitialPixelError();
+        joint.final_pixel_error = joint_solver.GetFinalPixelError();
+        joint.solution_iterations = joint_solver.GetSolutionIterations();
+        joint.solve_ms = std::chrono::duration<double, std::milli>
+            (std::chrono::steady_clock::now() - start).count();
+
+        for (size_t i = 0; i < job_indices.size(); i++) {
+            BatchJobResult& result = results[job_indices[i]];
+            result.T_CS = images[i].T_CS;
+            result.converged = images[i].converged;
+            result.joint_refined = true;
+            states_[job_indices[i]].cloud_scale = joint.cloud_scale;
+        }
+
+        joint_results.push_back(joint);
+    }
+}
+
+bool BatchRunner::WriteResults (std::string results_file_name_) {
+    if (results_file_name_.empty()) 
+        results_file_name_ = results_file;
+
+    if (results_file_name_.empty()) {
+        std::cout << "no results file given" << std::endl;
+        return false;
+    }
+
+    json J;
+    uint32_t num_converged = 0;
+
+    J["jobs"] = json::array();
+
+    for (auto& result : results) {
+        json job;
+        job["id"] = result.id;
+        job["success"] = result.success;
+        job["converged"] = result.converged;
+        job["error"] = result.error;
+        job["initial_pixel_error"] = result.initial_pixel_error;
+        job["final_pixel_error"] = result.final_pixel_error;
+        job["cached"] = result.cached;
+        job["solution_iterations"] = result.solution_iterations;
+        job["num_defects"] = result.num_defects;
+        job["num_defect_points"] = result.num_defect_points;
+        job["num_dropped_points"] = result.num_dropped_points;
+        job["num_simplified_points"] = result.num_simplified_points;
+        job["joint_refined"] = result.joint_refined;
+
+        job["T_CS"] = json::array();
+        for (uint8_t row = 0; row < 4; row++)
+            for (uint8_t col = 0; col < 4; col++)
+                job["T_CS"].push_back(result.T_CS(row, col));
+
+        job["timing_ms"] = {{"read", result.read_ms}, 
+                            {"solve", result.solve_ms}, 
+                            {"transfer", result.transfer_ms}, 
+                            {"write", result.write_ms}, 
+                            {"total", result.total_ms}};
+
+        if (result.converged) num_converged++;
+
+        J["jobs"].push_back(job);
+    }
+
+    J["num_jobs"] = results.size();
+    J["num_converged"] = num_converged;
+    J["wall_time_ms"] = wall_time_ms;
+
+    if (!solution_cache_file.empty()) {
+        J["solution_cache"] = {{"hits", solution_cache.GetNumHits()}, 
+                               {"misses", solution_cache.GetNumMisses()}, 
+                               {"evicted", solution_cache.GetNumEvicted()}, 
+                               {"size", solution_cache.GetSize()}};
+    }
+
+    if (joint_refinement) {
+        J["joint_refinement"] = json::array();
+        for (auto& joint : joint_results) {
+            J["joint_refinement"].push_back({{"CAD_labels", joint.CAD_labels}, 
+                                             {"num_images", joint.num_images}, 
+                                             {"converged", joint.converged}, 
+                                             {"cloud_scale", joint.cloud_scale}, 
+                                             {"initial_pixel_error", joint.initial_pixel_error}, 
+                                             {"final_pixel_error", joint.final_pixel_error}, 
+                                             {"solution_iterations", joint.solution_iterations}, 
+                                             {"solve_ms", joint.solve_ms}});
+        }
+    }
+
+    std::ofstream file(results_file_name_);
+
+    if (!file.is_open()) {
+        std::cout << "failed to open results file:" << results_file_name_ << std::endl;
+        return false;
+    }
+
+    file << J.dump(2);
+
+    return true;
+}
+
+const std::vector<BatchJobResult>& BatchRunner::GetResults () {
+    return results;
+}
+
+const std::vector<BatchJointResult>& BatchRunner::GetJointResults () {
+    return joint_results;
+}
+
+SolutionCache& BatchRunner::GetSolutionCache () {
+    return solution_cache;
+}
+
+std::string BatchRunner::ResolvePath (std::string path_) {
+    if (path_.empty() || path_[0] == '/') 
+        return path_;
+    return manifest_dir + "/" + path_;
+}
+
+bool BatchRunner::ReadImageSize (std::string labels_file_, uint32_t* width_, uint32_t* height_) {
+    std::ifstream file(labels_file_);
+    json J = json::parse(file, nullptr, false);
+
+    if (J.is_discarded() || !J.is_object() || !J.contains("imageWidth") || !J.contains("imageHeight") ||
+        !J["imageWidth"].is_number_unsigned() || !J["imageHeight"].is_number_unsigned()) 
+        return false;
+
+    *width_ = J["imageWidth"];
+    *height_ = J["imageHeight"];
+    return *width_ > 0 && *height_ > 0;
+}
+
+bool BatchRunner::LoadPose (Solver& solver_, const json& job_) {
+    if (job_.contains("T_CS")) {
+        if (job_["T_CS"].size() != 16) 
+            return false;
+
+        Eigen::Matrix4d T_CS;
+        for (uint8_t row = 0; row < 4; row++)
+            for (uint8_t col = 0; col < 4; col++)
+                T_CS(row, col) = job_["T_CS"][row * 4 + col];
+
+        solver_.LoadInitialPose(T_CS);
+    }
+    else if (job_.contains("robot_pose") && job_.contains("structure_pose")) {
+        solver_.LoadInitialPose(ResolvePath(job_["robot_pose"]), 
+                                ResolvePath(job_["structure_pose"]));
+    }
+    else if (job_.contains("initial_pose")) {
+        solver_.LoadInitialPose(ResolvePath(job_["initial_pose"]));
+    }
+
+    // otherwise the default initial pose of the solution parameters is used
+
+    if (job_.contains("camera_robot_pose")) 
+        solver_.TransformPose(ResolvePath(job_["camera_robot_pose"]));
+
+    return true;
+}
+
+bool BatchRunner::ReadCacheParameters () {
+    uint64_t hash = 0;
+    if (!SolutionCache::HashFile(solution_parameters_file, hash)) return false;
+
+    std::ifstream file(solution_parameters_file);
+    json J = json::parse(file, nullptr, false);
+
+    if (J.is_discarded() || !J.is_object() || !J.contains("camera_intrinsics") || 
+        !J["camera_intrinsics"].is_string() || !J.contains("cloud_scale") || !J["cloud_scale"].is_number()) {
+        std::cout << "solution cache disabled, failed to read solution parameters:" 
+                  << solution_parameters_file << std::endl;
+        return false;
+    }
+
+    cache_parameters_hash = hash;
+    cache_camera_model = J["camera_intrinsics"];
+    cache_cloud_scale = J["cloud_scale"];
+
+    return true;
+}
+
+bool BatchRunner::SolutionKey (const json& job_, uint64_t& key_) {
+    uint64_t hash = CADCache::Hash("solution");
+
+    // the camera input and its preprocessing
+    if (job_.contains("camera_image")) {
+        if (!SolutionCache::HashFile(ResolvePath(job_["camera_image"]), hash)) return false;
+        hash = CADCache::Hash((manifest.contains("edge_map") ? manifest["edge_map"].dump() : "") + "|" + 
+                              (job_.contains("roi") ? job_["roi"].dump() : ""), hash);
+    }
+    else {
+        if (!SolutionCache::HashFile(ResolvePath(job_["camera_labels"]), hash)) return false;
+        hash = CADCache::Hash(std::to_string(camera_density) + "|" + std::to_string(simplify_tolerance), hash);
+    }
+
+    // the CAD face and its preparation, the scale is part of the solution parameters
+    if (!SolutionCache::HashFile(ResolvePath(job_["CAD_labels"]), hash)) return false;
+    hash = CADCache::Hash("|" + std::to_string(CAD_density) + "|" + std::to_string(simplify_tolerance), hash);
+
+    std::string camera_model = job_.contains("camera_model") ? 
+        ResolvePath(job_["camera_model"]) : cache_camera_model;
+    if (!SolutionCache::HashFile(camera_model, hash)) return false;
+    hash = CADCache::Hash("|" + (job_.contains("camera_id") ? job_["camera_id"].dump() : ""), hash);
+
+    // the initial pose inputs in the order LoadPose applies them, without any the default pose 
+    // of the solution parameters is used
+    if (job_.contains("T_CS")) {
+        hash = CADCache::Hash("|T_CS" + job_["T_CS"].dump(), hash);
+    }
+    else if (job_.contains("robot_pose") && job_.contains("structure_pose")) {
+        hash = CADCache::Hash("|robot_pose", hash);
+        if (!SolutionCache::HashFile(ResolvePath(job_["robot_pose"]), hash)) return false;
+        if (!SolutionCache::HashFile(ResolvePath(job_["structure_pose"]), hash)) return false;
+    }
+    else if (job_.contains("initial_pose")) {
+        hash = CADCache::Hash("|initial_pose", hash);
+        if (!SolutionCache::HashFile(ResolvePath(job_["initial_pose"]), hash)) return false;
+    }
+
+    if (job_.contains("camera_robot_pose")) {
+        hash = CADCache::Hash("|camera_robot_pose", hash);
+        if (!SolutionCache::HashFile(ResolvePath(job_["camera_robot_pose"]), hash)) return false;
+    }
+
+    hash = CADCache::Hash("|" + std::to_string(cache_parameters_hash), hash);
+
+    key_ = hash;
+    return true;
+}
+
+} // namespace cam_cad
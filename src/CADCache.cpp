@@ -0,0 +1,130 @@
+#include "CADCache.h"
+#include <sstream>
+
+namespace cam_cad {
+
+CADCache::CADCache() {
+    num_prepared = 0;
+}
+
+std::shared_ptr<const PreparedCAD> CADCache::Get (std::string CAD_labels_file_, 
+                                                  uint8_t density_, double scale_, 
+                                                  float simplify_tolerance_) {
+    std::ifstream file(CAD_labels_file_, std::ios::binary);
+
+    if (!file.is_open()) {
+        std::cout << "failed to open file:" << CAD_labels_file_ << std::endl;
+        return nullptr;
+    }
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+
+    // key on the label contents and every parameter that changes the prepared cloud
+    uint64_t hash = Hash(contents.str());
+    hash = Hash(std::to_string(density_) + "|" + std::to_string(scale_) + "|" + 
+                std::to_string(simplify_tolerance_), hash);
+
+    std::promise<std::shared_ptr<const PreparedCAD>> promise;
+    std::shared_future<std::shared_ptr<const PreparedCAD>> prepared_future;
+    bool prepare_here = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        auto existing = cache.find(hash);
+        if (existing != cache.end()) {
+            prepared_future = existing->second;
+        }
+        else {
+            prepared_future = promise.get_future().share();
+            cache[hash] = prepared_future;
+            num_prepared++;
+            prepare_here = true;
+        }
+    }
+
+    // another thread has prepared (or is preparing) this cloud
+    if (!prepare_here) 
+        return prepared_future.get();
+
+    // prepare outside of the lock so other clouds can be looked up in the meantime, a 
+    // preparation that throws is passed to the waiting threads and not kept
+    std::shared_ptr<const PreparedCAD> prepared;
+    try {
+        prepared = Prepare(CAD_labels_file_, density_, scale_, simplify_tolerance_, hash);
+    }
+    catch (...) {
+        promise.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> lock(mtx);
+        cache.erase(hash);
+        throw;
+    }
+    promise.set_value(prepared);
+
+    // do not keep failed preparations, the file may be fixed later
+    if (prepared == nullptr) {
+        std::lock_guard<std::mutex> lock(mtx);
+        cache.erase(hash);
+    }
+
+    return prepared;
+}
+
+void CADCache::Clear () {
+    std::lock_guard<std::mutex> lock(mtx);
+    cache.clear();
+}
+
+size_t CADCache::GetSize () {
+    std::lock_guard<std::mutex> lock(mtx);
+    return cache.size();
+}
+
+uint64_t CADCache::GetNumPrepared () {
+    std::lock_guard<std::mutex> lock(mtx);
+    return num_prepared;
+}
+
+uint64_t CADCache::Hash (const std::string& data_, uint64_t seed_) {
+    uint64_t hash = seed_;
+    for (unsigned char c : data_) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::shared_ptr<const PreparedCAD> CADCache::Prepare (std::string CAD_labels_file_, 
+                                                      uint8_t density_, double scale_, 
+                                                      float simplify_tolerance_, uint64_t hash_) {
+    ImageBuffer image_buffer;
+    Util util;
+    std::vector<point> CAD_points;
+
+    if (!image_buffer.readPoints(CAD_labels_file_, &CAD_points)) 
+        return nullptr;
+
+    size_t num_simplified = image_buffer.simplifyPoints(&CAD_points, simplify_tolerance_);
+    image_buffer.densifyPoints(&CAD_points, density_);
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZ>);
+    image_buffer.populateCloud(&CAD_points, cloud, 0);
+
+    std::shared_ptr<PreparedCAD> prepared (new PreparedCAD);
+
+    util.originCloudxy(cloud);
+    util.GetCloudOffsetxy(prepared->offset_x, prepared->offset_y);
+
+    prepared->cloud = cloud;
+    prepared->scaled_cloud = util.ScaleCloud(pcl::PointCloud<pcl::PointXYZ>::ConstPtr(cloud), scale_);
+    prepared->scale = scale_;
+    prepared->density = density_;
+    prepared->simplify_tolerance = simplify_tolerance_;
+    prepared->num_simplified = num_simplified;
+    prepared->hash = hash_;
+
+    return prepared;
+}
+
+} // namespace cam_cad
@@ -0,0 +1,81 @@
+#include "CameraModelRegistry.h"
+
+namespace cam_cad {
+
+CameraModelRegistry::CameraModelRegistry() {
+    num_loaded = 0;
+}
+
+CameraModelRegistry& CameraModelRegistry::GetInstance () {
+    static CameraModelRegistry registry;
+    return registry;
+}
+
+std::shared_ptr<beam_calibration::CameraModel> CameraModelRegistry::Get 
+    (std::string intrinsics_file_path_, int16_t cam_ID_) {
+
+    std::string key = intrinsics_file_path_ + "|" + std::to_string(cam_ID_);
+
+    std::promise<std::shared_ptr<beam_calibration::CameraModel>> promise;
+    std::shared_future<std::shared_ptr<beam_calibration::CameraModel>> model_future;
+    bool load_here = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        auto existing = models.find(key);
+        if (existing != models.end()) {
+            model_future = existing->second;
+        }
+        else {
+            model_future = promise.get_future().share();
+            models[key] = model_future;
+            num_loaded++;
+            load_here = true;
+        }
+    }
+
+    // another thread has loaded (or is loading) this model
+    if (!load_here) 
+        return model_future.get();
+
+    // read outside of the lock, large calibrations (e.g. ladybug) take a while to parse, a 
+    // read that throws is passed to the waiting threads and not kept
+    std::shared_ptr<beam_calibration::CameraModel> model;
+    try {
+        model = beam_calibration::CameraModel::Create(intrinsics_file_path_);
+
+        // the camera is selected once here, the shared model is never modified afterwards
+        if (model != nullptr && cam_ID_ >= 0) 
+            model->SetCameraID(cam_ID_);
+    }
+    catch (...) {
+        promise.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> lock(mtx);
+        models.erase(key);
+        num_loaded--;
+        throw;
+    }
+
+    promise.set_value(model);
+
+    if (model == nullptr) {
+        std::lock_guard<std::mutex> lock(mtx);
+        models.erase(key);
+        num_loaded--;
+    }
+
+    return model;
+}
+
+void CameraModelRegistry::Clear () {
+    std::lock_guard<std::mutex> lock(mtx);
+    models.clear();
+}
+
+uint32_t CameraModelRegistry::GetNumLoaded () {
+    std::lock_guard<std::mutex> lock(mtx);
+    return num_loaded;
+}
+
+} // namespace cam_cad
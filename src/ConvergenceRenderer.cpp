@@ -0,0 +1,216 @@
+#include "ConvergenceRenderer.h"
+#include <sys/stat.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+namespace cam_cad {
+
+ConvergenceRenderer::ConvergenceRenderer (std::string output_, uint16_t max_size_,
+                                          uint32_t queue_size_, double fps_)
+    : num_written(0), num_dropped(0) {
+    output = output_;
+    max_size = std::max<uint16_t>(max_size_, 16);
+    queue_size = std::max<uint32_t>(queue_size_, 1);
+    fps = fps_;
+    session = 0;
+    geometry = {0, 0, 1};
+    closing = false;
+
+    auto endsWith = [&](std::string suffix) {
+        return output.size() >= suffix.size() &&
+               output.compare(output.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    video_output = endsWith(".avi") || endsWith(".mp4");
+
+    if (!video_output)
+        mkdir(output.c_str(), 0755);
+
+    encoder = std::thread(&ConvergenceRenderer::Encode, this);
+}
+
+ConvergenceRenderer::~ConvergenceRenderer () {
+    Close();
+}
+
+void ConvergenceRenderer::BeginSession (pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_,
+                                        uint32_t image_width_, uint32_t image_height_) {
+    session++;
+
+    std::shared_ptr<std::vector<cv::Point2f>> points =
+        std::make_shared<std::vector<cv::Point2f>>();
+    points->reserve(camera_cloud_->size());
+    for (auto& p : *camera_cloud_)
+        points->push_back(cv::Point2f(p.x, p.y));
+    camera_points = points;
+
+    uint32_t longest = std::max(std::max(image_width_, image_height_), 1u);
+    geometry.scale = std::min(1.0, double(max_size) / longest);
+    geometry.width = std::max(1u, uint32_t(std::round(image_width_ * geometry.scale)));
+    geometry.height = std::max(1u, uint32_t(std::round(image_height_ * geometry.scale)));
+}
+
+bool ConvergenceRenderer::Render (uint32_t iteration_, double pixel_error_,
+                                  pcl::PointCloud<pcl::PointXYZ>::ConstPtr proj_cloud_,
+                                  pcl::CorrespondencesConstPtr corrs_) {
+    if (camera_points == nullptr) {
+        printf("ConvergenceRenderer: BeginSession must be called before Render\n");
+        return false;
+    }
+
+    RenderFrame frame;
+    frame.session = session;
+    frame.iteration = iteration_;
+    frame.pixel_error = pixel_error_;
+    frame.camera_points = camera_points;
+
+    frame.proj_points.reserve(proj_cloud_->size());
+    for (auto& p : *proj_cloud_)
+        frame.proj_points.push_back(cv::Point2f(p.x, p.y));
+
+    frame.corrs.reserve(corrs_->size());
+    for (auto& c : *corrs_)
+        frame.corrs.push_back(std::make_pair(uint32_t(c.index_query), uint32_t(c.index_match)));
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (closing || queue.size() >= queue_size) {
+            num_dropped++;
+            return false;
+        }
+        queue.push_back(std::make_pair(geometry, std::move(frame)));
+    }
+    cv_queue.notify_one();
+
+    return true;
+}
+
+void ConvergenceRenderer::Close () {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        closing = true;
+    }
+    cv_queue.notify_one();
+
+    if (encoder.joinable())
+        encoder.join();
+}
+
+uint32_t ConvergenceRenderer::GetNumWritten () {
+    return num_written;
+}
+
+uint32_t ConvergenceRenderer::GetNumDropped () {
+    return num_dropped;
+}
+
+void ConvergenceRenderer::Encode () {
+    cv::Mat image;
+    std::shared_ptr<const std::vector<cv::Point2f>> session_points, scaled_points;
+
+    while (true) {
+        std::pair<Geometry, RenderFrame> item;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv_queue.wait(lock, [&] { return closing || !queue.empty(); });
+
+            // the queue is drained before the thread ends
+            if (queue.empty()) break;
+
+            item = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        image = cv::Mat(item.first.height, item.first.width, CV_8UC3, cv::Scalar(0, 0, 0));
+
+        // scale the frame into the geometry it was queued with, the camera points only
+        // change between sessions
+        RenderFrame& frame = item.second;
+        double scale = item.first.scale;
+        for (auto& p : frame.proj_points) { p.x *= scale; p.y *= scale; }
+
+        if (frame.camera_points != session_points) {
+            session_points = frame.camera_points;
+            std::shared_ptr<std::vector<cv::Point2f>> camera =
+                std::make_shared<std::vector<cv::Point2f>>(*session_points);
+            for (auto& p : *camera) { p.x *= scale; p.y *= scale; }
+            scaled_points = camera;
+        }
+        frame.camera_points = scaled_points;
+
+        Draw(frame, image);
+
+        if (Write(frame, image)) num_written++;
+        else num_dropped++;
+    }
+
+    if (writer.isOpened())
+        writer.release();
+}
+
+void ConvergenceRenderer::Draw (const RenderFrame& frame_, cv::Mat& image_) {
+    const std::vector<cv::Point2f>& camera = *frame_.camera_points;
+    int width = image_.cols, height = image_.rows;
+
+    auto toPixel = [](const cv::Point2f& p) {
+        return cv::Point(int(std::round(p.x)), int(std::round(p.y)));
+    };
+    auto inImage = [&](const cv::Point& p) {
+        return p.x >= 0 && p.y >= 0 && p.x < width && p.y < height;
+    };
+
+    for (auto& p : camera) {
+        cv::Point u = toPixel(p);
+        if (inImage(u)) image_.at<cv::Vec3b>(u.y, u.x) = cv::Vec3b(255, 255, 255);
+    }
+
+    for (auto& c : frame_.corrs) {
+        if (c.first >= frame_.proj_points.size() || c.second >= camera.size()) continue;
+        cv::line(image_, toPixel(frame_.proj_points[c.first]), toPixel(camera[c.second]),
+                 cv::Scalar(0, 160, 0), 1, cv::LINE_8);
+    }
+
+    for (auto& p : frame_.proj_points) {
+        cv::Point u = toPixel(p);
+        if (inImage(u)) cv::circle(image_, u, 1, cv::Scalar(0, 0, 255), cv::FILLED, cv::LINE_8);
+    }
+
+    char caption[96];
+    snprintf(caption, sizeof(caption), "solution %u  iteration %u  error %.2f px",
+             frame_.session, frame_.iteration, frame_.pixel_error);
+    cv::putText(image_, caption, cv::Point(8, 20), cv::FONT_HERSHEY_SIMPLEX, 0.5,
+                cv::Scalar(255, 255, 255), 1, cv::LINE_AA);
+}
+
+bool ConvergenceRenderer::Write (const RenderFrame& frame_, const cv::Mat& image_) {
+    if (!video_output) {
+        char file_name[64];
+        snprintf(file_name, sizeof(file_name), "/%04u_%03u.png", frame_.session, frame_.iteration);
+        return cv::imwrite(output + file_name, image_);
+    }
+
+    // the video size is fixed by the first frame, later sessions are resized to it
+    if (!writer.isOpened()) {
+        int codec = (output.substr(output.size() - 4) == ".mp4") ?
+                      cv::VideoWriter::fourcc('m', 'p', '4', 'v') :
+                      cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+        video_size = image_.size();
+        if (!writer.open(output, codec, fps, video_size, true)) {
+            std::cout << "failed to open video:" << output << std::endl;
+            return false;
+        }
+    }
+
+    if (image_.size().width != video_size.width || image_.size().height != video_size.height) {
+        cv::Mat resized;
+        cv::resize(image_, resized, video_size, 0, 0, cv::INTER_AREA);
+        writer.write(resized);
+    }
+    else
+        writer.write(image_);
+
+    return true;
+}
+
+}
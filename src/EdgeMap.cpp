@@ -0,0 +1,151 @@
+#include "EdgeMap.h"
+#include <algorithm>
+#include <cmath>
+
+namespace cam_cad {
+
+EdgeMapParameters::EdgeMapParameters (const nlohmann::json& J_) {
+    canny_low = J_.value("canny_low", canny_low);
+    canny_high = J_.value("canny_high", canny_high);
+    blur_sigma = J_.value("blur_sigma", blur_sigma);
+    max_points = J_.value("max_points", max_points);
+    num_levels = J_.value("levels", num_levels);
+
+    if (J_.contains("roi") && J_["roi"].size() == 4)
+        roi = cv::Rect(J_["roi"][0], J_["roi"][1], J_["roi"][2], J_["roi"][3]);
+}
+
+EdgeMap::EdgeMap (EdgeMapParameters params_) {
+    params = params_;
+    params.num_levels = std::max<uint8_t>(params.num_levels, 1);
+    params.max_points = std::max<uint32_t>(params.max_points, 1);
+}
+
+bool EdgeMap::Extract (std::string image_file_name_) {
+    StageTimer timer("read_edges");
+
+    cv::Mat image = cv::imread(image_file_name_, cv::IMREAD_GRAYSCALE);
+
+    if (image.empty()) {
+        std::cout << "failed to read image:" << image_file_name_ << std::endl;
+        return false;
+    }
+
+    return Extract(image);
+}
+
+bool EdgeMap::Extract (const cv::Mat& image_) {
+    levels.clear();
+    num_edge_pixels.clear();
+
+    if (image_.empty()) return false;
+
+    cv::Mat gray;
+    if (image_.channels() == 3) cv::cvtColor(image_, gray, cv::COLOR_BGR2GRAY);
+    else gray = image_;
+
+    // the region of interest is clipped to the image
+    cv::Rect roi(0, 0, gray.cols, gray.rows);
+    if (!params.roi.empty()) roi = params.roi & roi;
+
+    if (roi.empty()) {
+        std::cout << "region of interest is outside of the image" << std::endl;
+        return false;
+    }
+
+    cv::Mat level_image = gray(roi);
+    cv::Mat blurred, edges;
+    std::vector<cv::Point> edge_pixels;
+
+    for (uint8_t level = 0; level < params.num_levels; level++) {
+        if (level > 0) {
+            cv::Size half((level_image.cols + 1) / 2, (level_image.rows + 1) / 2);
+            if (half.width < 16 || half.height < 16) break;
+
+            cv::Mat reduced;
+            cv::resize(level_image, reduced, half, 0, 0, cv::INTER_AREA);
+            level_image = reduced;
+        }
+
+        if (params.blur_sigma > 0)
+            cv::GaussianBlur(level_image, blurred, cv::Size(0, 0), params.blur_sigma);
+        else
+            blurred = level_image;
+
+        cv::Canny(blurred, edges, params.canny_low, params.canny_high);
+
+        edge_pixels.clear();
+        cv::findNonZero(edges, edge_pixels);
+        num_edge_pixels.push_back(edge_pixels.size());
+
+        // pixel centers of the level in full resolution pixels
+        double scale = double(roi.width) / level_image.cols;
+
+        std::vector<point> points;
+        Subsample(edge_pixels, level_image.cols, level_image.rows, scale, points);
+
+        for (point& p : points) {
+            p.x += roi.x;
+            p.y += roi.y;
+        }
+
+        levels.push_back(std::move(points));
+    }
+
+    return true;
+}
+
+uint8_t EdgeMap::GetNumLevels () {
+    return levels.size();
+}
+
+void EdgeMap::GetPoints (uint8_t level_, std::vector<point>* points_) {
+    if (level_ >= levels.size()) {
+        printf("edge map has no level %u \n", level_);
+        return;
+    }
+
+    points_->insert(points_->end(), levels[level_].begin(), levels[level_].end());
+}
+
+size_t EdgeMap::GetNumEdgePixels (uint8_t level_) {
+    return (level_ < num_edge_pixels.size()) ? num_edge_pixels[level_] : 0;
+}
+
+void EdgeMap::Subsample (const std::vector<cv::Point>& edges_, int width_, int height_,
+                         double scale_, std::vector<point>& points_) {
+
+    auto toImage = [scale_](const cv::Point& p) {
+        return point((p.x + 0.5) * scale_ - 0.5, (p.y + 0.5) * scale_ - 0.5);
+    };
+
+    if (edges_.size() <= params.max_points) {
+        points_.reserve(edges_.size());
+        for (auto& p : edges_) points_.push_back(toImage(p));
+        return;
+    }
+
+    // edges are curves, so a cell of c pixels holds about c edge pixels, start from that
+    // estimate and grow the cells while cluttered regions still leave too many points
+    double cell = double(edges_.size()) / params.max_points;
+    std::vector<uint8_t> occupied;
+
+    while (true) {
+        int c = std::max(1, int(std::ceil(cell)));
+        size_t cols = width_ / c + 1, rows = height_ / c + 1;
+        occupied.assign(cols * rows, 0);
+        points_.clear();
+
+        for (auto& p : edges_) {
+            uint8_t& cell_used = occupied[(p.y / c) * cols + p.x / c];
+            if (cell_used) continue;
+            cell_used = 1;
+            points_.push_back(toImage(p));
+        }
+
+        if (points_.size() <= params.max_points) break;
+        cell *= 1.25 * std::sqrt(double(points_.size()) / params.max_points);
+    }
+}
+
+}
@@ -0,0 +1,113 @@
+#include "FloatProjector.h"
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+
+namespace cam_cad {
+
+FloatProjector::FloatProjector () {
+    fx = fy = 1;
+    cx = cy = k1 = k2 = p1 = p2 = 0;
+    max_u = max_v = 0;
+    check_bounds = true;
+    model = nullptr;
+    validation_error = -1;
+}
+
+bool FloatProjector::Init (std::shared_ptr<beam_calibration::CameraModel> camera_model_,
+                           std::string camera_model_file_, float max_error_) {
+    model = nullptr;
+    validation_error = -1;
+
+    if (camera_model_ == nullptr) return false;
+
+    // the camera type is only stored in the configuration file (ladybug .conf files are not json)
+    std::ifstream file(camera_model_file_);
+    nlohmann::json J = nlohmann::json::parse(file, nullptr, false);
+
+    if (J.is_discarded() || J.value("camera_type", "") != "RADTAN") return false;
+
+    const Eigen::VectorXd& intrinsics = camera_model_->GetIntrinsics();
+    if (intrinsics.size() != 8) return false;
+
+    fx = intrinsics[0];
+    fy = intrinsics[1];
+    cx = intrinsics[2];
+    cy = intrinsics[3];
+    k1 = intrinsics[4];
+    k2 = intrinsics[5];
+    p1 = intrinsics[6];
+    p2 = intrinsics[7];
+    max_u = float(camera_model_->GetWidth()) - 1;
+    max_v = float(camera_model_->GetHeight()) - 1;
+
+    validation_error = Validate(camera_model_);
+
+    if (validation_error < 0 || validation_error > max_error_) {
+        printf("float projection does not match the camera model (error %f px), using double \n",
+               validation_error);
+        return false;
+    }
+
+    model = camera_model_.get();
+    return true;
+}
+
+bool FloatProjector::IsValidFor (const beam_calibration::CameraModel* camera_model_) const {
+    return model != nullptr && model == camera_model_;
+}
+
+float FloatProjector::GetValidationError () const {
+    return validation_error;
+}
+
+float FloatProjector::Validate (std::shared_ptr<beam_calibration::CameraModel> camera_model_) {
+    // normalized image coordinates from a quarter image beyond every border, at three depths
+    // and behind the camera
+    const int num_steps = 17;
+    const float depths[] = {0.5, 5, 50, -5};
+    float x_min = -(cx + 0.25f * max_u) / fx, x_max = (1.25f * max_u - cx) / fx;
+    float y_min = -(cy + 0.25f * max_v) / fy, y_max = (1.25f * max_v - cy) / fy;
+
+    // pixels this close to the image border may be visible in one projection only
+    const float border = 1.5;
+    auto nearBorder = [&](const Eigen::Vector2f& u) {
+        return std::abs(u[0]) < border || std::abs(u[1]) < border ||
+               std::abs(u[0] - max_u) < border || std::abs(u[1] - max_v) < border;
+    };
+
+    // a point far left of the image tells whether the camera model checks the image bounds
+    Eigen::Vector3d outside(x_min, (y_min + y_max) / 2, 1);
+    check_bounds = !camera_model_->ProjectPointPrecise(outside).has_value();
+
+    float max_error = 0;
+
+    for (int i = 0; i < num_steps; i++) {
+        for (int j = 0; j < num_steps; j++) {
+            float x = x_min + (x_max - x_min) * i / (num_steps - 1);
+            float y = y_min + (y_max - y_min) * j / (num_steps - 1);
+
+            for (float depth : depths) {
+                Eigen::Vector3f point(x * std::abs(depth), y * std::abs(depth), depth);
+
+                std::optional<Eigen::Vector2d> pixel_double =
+                    camera_model_->ProjectPointPrecise(point.cast<double>());
+                Eigen::Vector2f pixel_float, pixel_unchecked;
+                bool visible_float = Project(point, pixel_float);
+
+                if (pixel_double.has_value() && visible_float) {
+                    max_error = std::max(max_error,
+                                         float((pixel_double.value().cast<float>() - pixel_float).norm()));
+                }
+                else if (pixel_double.has_value() != visible_float) {
+                    if (ProjectUnchecked(point, pixel_unchecked) && nearBorder(pixel_unchecked)) continue;
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return max_error;
+}
+
+}
@@ -1,4 +1,7 @@
 #include "ImageBuffer.h"
+#include "AnnotationSession.h"
+#include <algorithm>
+#include <utility>
 
 using json = nlohmann::json;
 
@@ -10,6 +13,8 @@ namespace cam_cad
     bool ImageBuffer::readPoints(std::string filename_, 
                                  std::vector<point> *points_)
     {
+        StageTimer timer("read_labels");
+
         std::ifstream input_stream;
         input_stream.open(filename_);
         json input;
@@ -30,16 +35,21 @@ namespace cam_cad
         // parse input string for points
 
         // jump to start of points section of JSON
-        uint16_t read_index = input_string.find("points");
+        size_t read_index = input_string.find("points");
+        if (read_index == std::string::npos)
+        {
+            std::cout << "no points in file:" << filename_ << std::endl;
+            return false;
+        }
         input_string = input_string.substr(read_index);
 
         // add all points to point vector
-        uint16_t num_points = 0;
+        size_t num_points = 0;
         point current_point;
         current_point.x = 0;
         current_point.y = 0;
         read_index = 0;
-        uint16_t index_ticker = 0;
+        uint8_t index_ticker = 0;
 
         while (input_string.at(read_index) != '}')
         {
@@ -74,23 +84,174 @@ namespace cam_cad
         return true;
     }
 
-    void ImageBuffer::scalePoints(std::vector<point> *points_, float scale_)
+    bool ImageBuffer::readShapes(std::string filename_, 
+                                 std::vector<LabelledShape> *shapes_)
     {
-        // scale points based on image scale (for CAD images)
-        uint16_t num_points = points_->size();
+        StageTimer timer("read_labels");
+
+        std::ifstream input_stream(filename_);
+
+        if (!input_stream.is_open())
+        {
+            std::cout << "failed to open file:" << filename_ << std::endl;
+            return false;
+        }
+
+        json input = json::parse(input_stream, nullptr, false);
 
-        // pop each point out of the vector, update value and 
-        //push to back to retain order of the vector
-        for (uint16_t point_index = 0; point_index < num_points; point_index++)
+        if (input.is_discarded() || !input.contains("shapes") || !input["shapes"].is_array())
         {
-            point current_point = points_->at(0);
+            std::cout << "no shapes in file:" << filename_ << std::endl;
+            return false;
+        }
+
+        const json& shapes = input["shapes"];
+        shapes_->reserve(shapes_->size() + shapes.size());
+
+        for (size_t shape_index = 0; shape_index < shapes.size(); shape_index++)
+        {
+            const json& J = shapes[shape_index];
+            LabelledShape shape;
+
+            if (J.contains("label") && J["label"].is_string())
+                shape.label = J["label"];
+
+            if (J.contains("group_id") && J["group_id"].is_number_integer())
+                shape.id = J["group_id"];
+            else
+                shape.id = shape_index;
+
+            std::string shape_type = J.value("shape_type", "polygon");
+            shape.closed = (shape_type != "linestrip" && shape_type != "line");
+
+            if (J.contains("points"))
+            {
+                shape.points.reserve(J["points"].size());
+                for (auto& p : J["points"])
+                    shape.points.push_back(point(p[0].get<float>(), p[1].get<float>()));
+            }
 
-            points_->erase(points_->begin());
+            shapes_->push_back(std::move(shape));
+        }
+
+        return true;
+    }
+
+    void ImageBuffer::scalePoints(std::vector<point> *points_, float scale_)
+    {
+        // scale points based on image scale (for CAD images), in place to retain the order
+        for (point& current_point : *points_)
+        {
             current_point.x *= scale_;
             current_point.y *= scale_;
+        }
+    }
+
+    // distance of a point to the segment between two points
+    static float segmentDistance(const point& p_, const point& a_, const point& b_)
+    {
+        float dx = b_.x - a_.x, dy = b_.y - a_.y;
+        float length2 = dx * dx + dy * dy;
+        float t = 0;
 
-            points_->push_back(current_point);
+        if (length2 > 0)
+            t = std::min(1.0f, std::max(0.0f, ((p_.x - a_.x) * dx + (p_.y - a_.y) * dy) / length2));
+
+        return std::hypot(p_.x - (a_.x + t * dx), p_.y - (a_.y + t * dy));
+    }
+
+    size_t ImageBuffer::simplifyPoints(std::vector<point> *points_, float max_deviation_, 
+                                       bool closed_, float *deviation_)
+    {
+        if (deviation_ != nullptr) *deviation_ = 0;
+
+        size_t num_points = points_->size();
+        if (max_deviation_ <= 0 || num_points < 3) return 0;
+
+        StageTimer timer("simplify_labels");
+
+        std::vector<uint8_t> keep(num_points, 0);
+        std::vector<std::pair<size_t, size_t>> ranges;
+
+        // the last point of a range may be num_points, the first point again for closed outlines
+        auto at = [&](size_t index) -> const point& { return points_->at(index % num_points); };
+
+        keep[0] = 1;
+
+        if (closed_)
+        {
+            // a polygon is split at the point farthest from the first one, both halves are then
+            // simplified as open polylines
+            size_t farthest = 1;
+            float farthest_distance = -1;
+            for (size_t i = 1; i < num_points; i++)
+            {
+                float distance = std::hypot(at(i).x - at(0).x, at(i).y - at(0).y);
+                if (distance > farthest_distance)
+                {
+                    farthest_distance = distance;
+                    farthest = i;
+                }
+            }
+
+            keep[farthest] = 1;
+            ranges.push_back({0, farthest});
+            ranges.push_back({farthest, num_points});
+        }
+        else
+        {
+            keep[num_points - 1] = 1;
+            ranges.push_back({0, num_points - 1});
+        }
+
+        float max_deviation = 0;
+
+        // iterative Douglas-Peucker, a range is dropped when all of its points are within the
+        // tolerance of its end points and split at its farthest point otherwise
+        while (!ranges.empty())
+        {
+            size_t first = ranges.back().first, last = ranges.back().second;
+            ranges.pop_back();
+
+            if (last - first < 2) continue;
+
+            size_t farthest = first + 1;
+            float farthest_distance = -1;
+            for (size_t i = first + 1; i < last; i++)
+            {
+                float distance = segmentDistance(at(i), at(first), at(last));
+                if (distance > farthest_distance)
+                {
+                    farthest_distance = distance;
+                    farthest = i;
+                }
+            }
+
+            if (farthest_distance > max_deviation_)
+            {
+                keep[farthest] = 1;
+                ranges.push_back({first, farthest});
+                ranges.push_back({farthest, last});
+            }
+            else
+            {
+                max_deviation = std::max(max_deviation, farthest_distance);
+            }
+        }
+
+        size_t num_kept = 0;
+        for (size_t i = 0; i < num_points; i++)
+        {
+            if (keep[i]) (*points_)[num_kept++] = (*points_)[i];
         }
+        points_->resize(num_kept);
+
+        if (deviation_ != nullptr) *deviation_ = max_deviation;
+
+        std::cout << "simplified outline: removed " << num_points - num_kept << " of " << num_points 
+                  << " points (max deviation " << max_deviation << " px)" << std::endl;
+
+        return num_points - num_kept;
     }
 
     void ImageBuffer::densifyPoints(std::vector<point> *points_, 
@@ -98,14 +259,17 @@ namespace cam_cad
     {
         // add additional point between existing points according to scale
         // will help to converge solution
-        uint16_t init_length = points_->size();
+        size_t init_length = points_->size();
 
-        for (uint16_t point_index = 0; point_index < init_length; point_index++)
-        {
-            point current_start_point = points_->at(0);
-            point current_end_point = points_->at(1);
+        // the densified points are streamed into a new vector in one pass, each point is 
+        // followed by the points interpolated toward the next one (the last toward the first)
+        std::vector<point> densified;
+        densified.reserve(init_length * (density_index_ + 2));
 
-            points_->erase(points_->begin());
+        for (size_t point_index = 0; point_index < init_length; point_index++)
+        {
+            point current_start_point = points_->at(point_index);
+            point current_end_point = points_->at((point_index + 1) % init_length);
 
             // determine angle between points
             float slope, theta;
@@ -168,7 +332,7 @@ namespace cam_cad
             }
 
             // push the start point first to conserve the order of the vector
-            points_->push_back(current_start_point);
+            densified.push_back(current_start_point);
 
             // push the rest of the interpolated points, trending toward the current end point
             float current_x_coord = current_start_point.x + dx;
@@ -180,7 +344,7 @@ namespace cam_cad
             while (current_dist < dist)
             {
                 point current_inter_point(current_x_coord, current_y_coord);
-                points_->push_back(current_inter_point);
+                densified.push_back(current_inter_point);
 
                 current_x_coord += dx;
                 current_y_coord += dy;
@@ -189,6 +353,8 @@ namespace cam_cad
                         std::pow(std::abs(current_y_coord - current_start_point.y), 2));
             }
         }
+
+        points_->swap(densified);
     }
 
     void ImageBuffer::populateCloud(std::vector<point> *points_, 
@@ -196,9 +362,10 @@ namespace cam_cad
                                     uint16_t init_z_pos_)
     {
 
-        uint16_t num_points = points_->size();
+        size_t num_points = points_->size();
+        cloud_->reserve(cloud_->size() + num_points);
 
-        for (uint16_t point_index = 0; point_index < num_points; point_index++)
+        for (size_t point_index = 0; point_index < num_points; point_index++)
         {
             pcl::PointXYZ current_3D_point(points_->at(point_index).x, 
                                            points_->at(point_index).y, init_z_pos_);
@@ -210,7 +377,9 @@ namespace cam_cad
                                    std::vector<point> *points_)
     {
 
-        for (uint32_t i = 0; i < cloud_->size(); i++)
+        points_->reserve(points_->size() + cloud_->size());
+
+        for (size_t i = 0; i < cloud_->size(); i++)
         {
             point to_add(cloud_->at(i).x, cloud_->at(i).y);
             points_->push_back(to_add);
@@ -220,51 +389,15 @@ namespace cam_cad
     bool ImageBuffer::writeToImage(std::vector<point> *points_, std::string src_file_name_, 
                                    std::string target_file_name_, std::string color_)
     {
+        // single layer session: one decode, one encode
+        AnnotationSession session;
 
-        cv::Vec3b color;
-
-        if (color_ == "black")
-        {
-            color[0] = 0;
-            color[1] = 0;
-            color[2] = 0;
-        }
-
-        if (color_ == "red")
-        {
-            color[0] = 255;
-            color[1] = 0;
-            color[2] = 0;
-        }
-
-        if (color_ == "green")
-        {
-            color[0] = 0;
-            color[1] = 255;
-            color[2] = 0;
-        }
-
-        if (color_ == "blue")
-        {
-            color[0] = 0;
-            color[1] = 0;
-            color[2] = 255;
-        }
-
-        cv::Mat image;
-        image = cv::imread(src_file_name_, 1);
-
-        for (uint32_t i = 0; i < points_->size(); i++)
-        {
-
-            image.at<cv::Vec3b>(points_->at(i).y, points_->at(i).x) = color;
-        }
+        if (!session.open(src_file_name_))
+            return false;
 
-        bool write_success = cv::imwrite(target_file_name_, image);
+        session.addPoints(points_, color_);
 
-        if (write_success)
-            return true;
-        return false;
+        return session.write(target_file_name_);
     }
 
 } // namespace cam_cad
\ No newline at end of file
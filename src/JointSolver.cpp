@@ -0,0 +1,426 @@
+#include "JointSolver.h"
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <stdio.h>
+
+namespace cam_cad {
+
+namespace {
+
+// scales a CAD point and transforms it to the camera frame with the pose (quaternion, translation)
+template <typename T>
+void TransformScaledPoint (const T* const T_CS_, const T* const scale_, const Eigen::Vector3d& P_CAD_,
+                           T* P_CAMERA_) {
+    T P_STRUCT[3] = {scale_[0] * T(P_CAD_[0]), scale_[0] * T(P_CAD_[1]), scale_[0] * T(P_CAD_[2])};
+    ceres::QuaternionRotatePoint(T_CS_, P_STRUCT, P_CAMERA_);
+    P_CAMERA_[0] += T_CS_[4];
+    P_CAMERA_[1] += T_CS_[5];
+    P_CAMERA_[2] += T_CS_[6];
+}
+
+// projection of any camera model, differentiated numerically
+struct CameraProjectionFunctor {
+    CameraProjectionFunctor (std::shared_ptr<beam_calibration::CameraModel> camera_model_) {
+        camera_model = camera_model_;
+    }
+
+    bool operator() (const double* P_, double* pixel_) const {
+        std::optional<Eigen::Vector2d> pixel =
+            camera_model->ProjectPointPrecise(Eigen::Vector3d(P_[0], P_[1], P_[2]));
+        if (!pixel.has_value()) return false;
+
+        pixel_[0] = pixel.value()[0];
+        pixel_[1] = pixel.value()[1];
+        return true;
+    }
+
+    std::shared_ptr<beam_calibration::CameraModel> camera_model;
+};
+
+// reprojection error of a CAD point with the pose of its image and the shared scale
+struct JointReprojectionCost {
+    JointReprojectionCost (const Eigen::Vector2d& pixel_, const Eigen::Vector3d& P_CAD_,
+                           std::shared_ptr<beam_calibration::CameraModel> camera_model_) {
+        pixel_detected = pixel_;
+        P_CAD = P_CAD_;
+        compute_projection.reset(new ceres::CostFunctionToFunctor<2, 3>(
+            new ceres::NumericDiffCostFunction<CameraProjectionFunctor, ceres::CENTRAL, 2, 3>(
+                new CameraProjectionFunctor(camera_model_))));
+    }
+
+    template <typename T>
+    bool operator() (const T* const T_CS_, const T* const scale_, T* residuals_) const {
+        T P_CAMERA[3];
+        TransformScaledPoint(T_CS_, scale_, P_CAD, P_CAMERA);
+
+        const T* P_CAMERA_const = &(P_CAMERA[0]);
+        T pixel_projected[2];
+        if (!(*compute_projection)(P_CAMERA_const, &(pixel_projected[0]))) return false;
+
+        residuals_[0] = T(pixel_detected[0]) - pixel_projected[0];
+        residuals_[1] = T(pixel_detected[1]) - pixel_projected[1];
+        return true;
+    }
+
+    static ceres::CostFunction* Create (const Eigen::Vector2d& pixel_, const Eigen::Vector3d& P_CAD_,
+                                        std::shared_ptr<beam_calibration::CameraModel> camera_model_) {
+        return new ceres::AutoDiffCostFunction<JointReprojectionCost, 2, 7, 1>(
+            new JointReprojectionCost(pixel_, P_CAD_, camera_model_));
+    }
+
+    Eigen::Vector2d pixel_detected;
+    Eigen::Vector3d P_CAD;
+    std::unique_ptr<ceres::CostFunctionToFunctor<2, 3>> compute_projection;
+};
+
+// reprojection error with the shared RADTAN intrinsics (fx, fy, cx, cy, k1, k2, p1, p2) as a
+// parameter block, the projection is the one of FloatProjector
+struct JointRadtanReprojectionCost {
+    JointRadtanReprojectionCost (const Eigen::Vector2d& pixel_, const Eigen::Vector3d& P_CAD_) {
+        pixel_detected = pixel_;
+        P_CAD = P_CAD_;
+    }
+
+    template <typename T>
+    bool operator() (const T* const T_CS_, const T* const scale_, const T* const intrinsics_,
+                     T* residuals_) const {
+        T P_CAMERA[3];
+        TransformScaledPoint(T_CS_, scale_, P_CAD, P_CAMERA);
+
+        if (P_CAMERA[2] <= T(0)) return false;
+
+        T x = P_CAMERA[0] / P_CAMERA[2], y = P_CAMERA[1] / P_CAMERA[2];
+        T x2 = x * x, y2 = y * y, xy = x * y, r2 = x2 + y2;
+        T radial = intrinsics_[4] * r2 + intrinsics_[5] * r2 * r2;
+
+        T x_d = x + x * radial + T(2) * intrinsics_[6] * xy + intrinsics_[7] * (r2 + T(2) * x2);
+        T y_d = y + y * radial + T(2) * intrinsics_[7] * xy + intrinsics_[6] * (r2 + T(2) * y2);
+
+        residuals_[0] = T(pixel_detected[0]) - (intrinsics_[0] * x_d + intrinsics_[2]);
+        residuals_[1] = T(pixel_detected[1]) - (intrinsics_[1] * y_d + intrinsics_[3]);
+        return true;
+    }
+
+    static ceres::CostFunction* Create (const Eigen::Vector2d& pixel_, const Eigen::Vector3d& P_CAD_) {
+        return new ceres::AutoDiffCostFunction<JointRadtanReprojectionCost, 2, 7, 1, 8>(
+            new JointRadtanReprojectionCost(pixel_, P_CAD_));
+    }
+
+    Eigen::Vector2d pixel_detected;
+    Eigen::Vector3d P_CAD;
+};
+
+// pulls the camera translation of an image toward its measured translation
+struct TranslationPriorCost {
+    TranslationPriorCost (const Eigen::Vector3d& t_measured_, double sigma_) {
+        t_measured = t_measured_;
+        sigma = sigma_;
+    }
+
+    template <typename T>
+    bool operator() (const T* const T_CS_, T* residuals_) const {
+        for (int i = 0; i < 3; i++)
+            residuals_[i] = (T_CS_[4 + i] - T(t_measured[i])) / T(sigma);
+        return true;
+    }
+
+    static ceres::CostFunction* Create (const Eigen::Vector3d& t_measured_, double sigma_) {
+        return new ceres::AutoDiffCostFunction<TranslationPriorCost, 3, 7>(
+            new TranslationPriorCost(t_measured_, sigma_));
+    }
+
+    Eigen::Vector3d t_measured;
+    double sigma;
+};
+
+}
+
+JointSolver::JointSolver (std::string config_file_name_) {
+    refine_scale_ = true;
+    refine_intrinsics_ = false;
+    translation_prior_sigma_ = 0;
+    huber_threshold_ = 0;
+
+    ReadSolutionParams(config_file_name_);
+
+    initial_projection_error_ = 0;
+    final_projection_error_ = 0;
+    solution_iterations_ = 0;
+    scale = cloud_scale_;
+
+    se3_parameterization_ = std::unique_ptr<ceres::LocalParameterization>(
+        new ceres::ProductParameterization(new ceres::QuaternionParameterization(),
+                                           new ceres::IdentityParameterization(3)));
+}
+
+bool JointSolver::Solve (pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_,
+                         std::vector<JointImage>* images_) {
+
+    StageTimer timer("joint_solve");
+
+    std::vector<JointImage>& images = *images_;
+    solution_iterations_ = 0;
+
+    if (images.empty() || CAD_cloud_->empty()) {
+        printf("joint refinement needs a CAD cloud and at least one image \n");
+        return false;
+    }
+
+    scale = cloud_scale_;
+    poses.clear();
+    workspaces.clear();
+
+    for (auto& image : images) {
+        poses.push_back(image.util->TransformMatrixToQuaternionAndTranslation(image.T_CS));
+        workspaces.push_back(std::make_shared<SolverWorkspace>());
+        workspaces.back()->BeginProblem(CAD_cloud_->size(), image.camera_cloud->size());
+    }
+
+    // scaling the structure and the camera translations together does not change the projection
+    bool refine_scale = refine_scale_ && translation_prior_sigma_ > 0;
+    if (refine_scale_ && !refine_scale)
+        printf("no translation prior set, the CAD scale is held fixed \n");
+
+    bool refine_intrinsics = false;
+    intrinsics.resize(0);
+
+    if (refine_intrinsics_) {
+        std::shared_ptr<beam_calibration::CameraModel> camera_model = images[0].util->GetCameraModel();
+        bool shared_model = true;
+        for (auto& image : images)
+            shared_model &= image.util->GetCameraModel() == camera_model;
+
+        FloatProjector radtan_projector;
+
+        if (shared_model && radtan_projector.Init(camera_model, images[0].util->GetCameraModelFile())) {
+            intrinsics = camera_model->GetIntrinsics();
+            refine_intrinsics = true;
+        }
+        else {
+            printf("intrinsics can only be refined for a RADTAN camera model shared by all images \n");
+        }
+    }
+
+    if (huber_threshold_ > 0)
+        loss_function_.reset(new ceres::HuberLoss(huber_threshold_));
+    else
+        loss_function_.reset();
+
+    initial_projection_error_ = EstimateCorrespondences(CAD_cloud_, images);
+    final_projection_error_ = initial_projection_error_;
+
+    bool has_converged = true;
+    for (auto& image : images) {
+        image.initial_pixel_error = image.final_pixel_error;
+        has_converged &= image.converged;
+    }
+
+    printf("joint refinement of %zu images, initial pixel error %f \n", images.size(),
+           initial_projection_error_);
+
+    // the shared quantities are refined at least once, even if every image has already converged
+    while (solution_iterations_ < (int)max_solution_iterations_ &&
+           (!has_converged || solution_iterations_ == 0)) {
+
+        solution_iterations_++;
+
+        ceres::Problem::Options problem_options;
+        problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+        problem_options.local_parameterization_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+        ceres::Problem problem(problem_options);
+
+        BuildCeresProblem(problem, CAD_cloud_, images, refine_scale, refine_intrinsics);
+
+        ceres::Solver::Options options;
+        options.minimizer_progress_to_stdout = minimizer_progress_to_stdout_;
+        options.max_num_iterations = max_ceres_iterations_;
+        options.max_solver_time_in_seconds = max_solver_time_in_seconds_;
+        options.function_tolerance = function_tolerance_;
+        options.gradient_tolerance = gradient_tolerance_;
+        options.parameter_tolerance = parameter_tolerance_;
+        options.linear_solver_type = ceres::SPARSE_SCHUR;
+        options.preconditioner_type = ceres::SCHUR_JACOBI;
+
+        // the pose blocks only share the scale and intrinsics, they are eliminated first so the
+        // reduced camera system only has the shared blocks
+        std::shared_ptr<ceres::ParameterBlockOrdering> ordering (new ceres::ParameterBlockOrdering);
+        for (auto& pose : poses)
+            ordering->AddElementToGroup(pose.data(), 0);
+        ordering->AddElementToGroup(&scale, 1);
+        if (refine_intrinsics)
+            ordering->AddElementToGroup(intrinsics.data(), 1);
+        options.linear_solver_ordering = ordering;
+
+        {
+            StageTimer ceres_timer("ceres_solve");
+            ceres::Solver::Summary summary;
+            ceres::Solve(options, &problem, &summary);
+            if (minimizer_progress_to_stdout_)
+                std::cout << summary.BriefReport() << "\n";
+        }
+
+        for (size_t i = 0; i < images.size(); i++)
+            images[i].T_CS = images[i].util->QuaternionAndTranslationToTransformMatrix(poses[i]);
+
+        final_projection_error_ = EstimateCorrespondences(CAD_cloud_, images);
+
+        has_converged = true;
+        for (auto& image : images)
+            has_converged &= image.converged;
+
+        printf("Joint iteration %d: pixel error %f, CAD scale %f \n", solution_iterations_,
+               final_projection_error_, scale);
+    }
+
+    return has_converged;
+}
+
+double JointSolver::EstimateCorrespondences (pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_,
+                                             std::vector<JointImage>& images_) {
+
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_scaled =
+        images_[0].util->ScaleCloud(CAD_cloud_, scale);
+
+    double error_sum = 0;
+
+    for (size_t i = 0; i < images_.size(); i++) {
+        JointImage& image = images_[i];
+        pcl::CorrespondencesPtr corrs = workspaces[i]->GetCorrespondences();
+
+        image.util->CorrEst(CAD_cloud_scaled, image.camera_cloud, image.T_CS, corrs, offset_type_,
+                            *workspaces[i]);
+
+        pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud = workspaces[i]->GetProjectedCloud();
+
+        double pixel_error = 0;
+        for (auto& corr : *corrs) {
+            const pcl::PointXYZ& p = proj_cloud->at(corr.index_query);
+            const pcl::PointXYZ& c = image.camera_cloud->at(corr.index_match);
+            pixel_error += std::hypot(p.x - c.x, p.y - c.y);
+        }
+
+        // an image without correspondences has left the view
+        image.final_pixel_error = corrs->empty() ? HUGE_VAL : pixel_error / corrs->size();
+        image.converged = image.final_pixel_error <= convergence_limit_;
+        error_sum += image.final_pixel_error;
+
+        workspaces[i]->Update();
+    }
+
+    return error_sum / images_.size();
+}
+
+void JointSolver::BuildCeresProblem (ceres::Problem& problem_,
+                                     pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_,
+                                     std::vector<JointImage>& images_, bool free_scale_,
+                                     bool free_intrinsics_) {
+
+    StageTimer timer("problem_build");
+
+    problem_.AddParameterBlock(&scale, 1);
+    problem_.SetParameterLowerBound(&scale, 0, 1e-3 * cloud_scale_);
+    if (!free_scale_)
+        problem_.SetParameterBlockConstant(&scale);
+
+    if (free_intrinsics_)
+        problem_.AddParameterBlock(intrinsics.data(), 8);
+
+    for (size_t i = 0; i < images_.size(); i++) {
+        problem_.AddParameterBlock(poses[i].data(), 7, se3_parameterization_.get());
+
+        std::shared_ptr<beam_calibration::CameraModel> camera_model = images_[i].util->GetCameraModel();
+        pcl::CorrespondencesPtr corrs = workspaces[i]->GetCorrespondences();
+
+        for (auto& corr : *corrs) {
+            const pcl::PointXYZ& c = images_[i].camera_cloud->at(corr.index_match);
+            const pcl::PointXYZ& P = CAD_cloud_->at(corr.index_query);
+
+            Eigen::Vector2d pixel (c.x, c.y);
+            Eigen::Vector3d P_CAD (P.x, P.y, P.z);
+
+            if (free_intrinsics_) {
+                problem_.AddResidualBlock(JointRadtanReprojectionCost::Create(pixel, P_CAD),
+                                          loss_function_.get(), poses[i].data(), &scale,
+                                          intrinsics.data());
+            }
+            else {
+                problem_.AddResidualBlock(JointReprojectionCost::Create(pixel, P_CAD, camera_model),
+                                          loss_function_.get(), poses[i].data(), &scale);
+            }
+        }
+
+        if (translation_prior_sigma_ > 0) {
+            Eigen::Vector3d t_measured = images_[i].T_CS_measured.block(0, 3, 3, 1);
+            problem_.AddResidualBlock(TranslationPriorCost::Create(t_measured, translation_prior_sigma_),
+                                      nullptr, poses[i].data());
+        }
+    }
+}
+
+void JointSolver::SetCloudScale (double scale_) {
+    cloud_scale_ = scale_;
+}
+
+void JointSolver::SetRefineScale (bool enable_) {
+    refine_scale_ = enable_;
+}
+
+void JointSolver::SetRefineIntrinsics (bool enable_) {
+    refine_intrinsics_ = enable_;
+}
+
+void JointSolver::SetTranslationPriorSigma (double sigma_) {
+    translation_prior_sigma_ = sigma_;
+}
+
+double JointSolver::GetCloudScale () {
+    return scale;
+}
+
+bool JointSolver::GetRefineIntrinsics () {
+    return refine_intrinsics_;
+}
+
+const Eigen::VectorXd& JointSolver::GetIntrinsics () {
+    return intrinsics;
+}
+
+double JointSolver::GetInitialPixelError () {
+    return initial_projection_error_;
+}
+
+double JointSolver::GetFinalPixelError () {
+    return final_projection_error_;
+}
+
+int JointSolver::GetSolutionIterations () {
+    return solution_iterations_;
+}
+
+void JointSolver::ReadSolutionParams (std::string file_name_) {
+    nlohmann::json J;
+    std::ifstream file(file_name_);
+    file >> J;
+
+    max_solution_iterations_ = J["max_solution_iterations"];
+    max_ceres_iterations_ = J["max_ceres_iterations"];
+    convergence_limit_ = J["convergence_limit"];
+    cloud_scale_ = J["cloud_scale"];
+    minimizer_progress_to_stdout_ = J["minimizer_progress_to_stdout"];
+    max_solver_time_in_seconds_ = J["max_solver_time_in_seconds"];
+    function_tolerance_ = J["function_tolerance"];
+    gradient_tolerance_ = J["gradient_tolerance"];
+    parameter_tolerance_ = J["parameter_tolerance"];
+    offset_type_ = J["offset_type"];
+
+    if (J.contains("joint_refinement")) {
+        const nlohmann::json& joint = J["joint_refinement"];
+        refine_scale_ = joint.value("refine_scale", refine_scale_);
+        refine_intrinsics_ = joint.value("refine_intrinsics", refine_intrinsics_);
+        translation_prior_sigma_ = joint.value("translation_prior_sigma", translation_prior_sigma_);
+        huber_threshold_ = joint.value("huber_threshold", huber_threshold_);
+    }
+}
+
+}
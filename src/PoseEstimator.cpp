@@ -0,0 +1,112 @@
+#include "PoseEstimator.h"
+
+namespace cam_cad {
+
+PoseEstimator::PoseEstimator(std::string config_file_name_, std::string camera_model_file_, int camera_id_) :
+    util(new Util),
+    workspace(new SolverWorkspace),
+    solver(std::make_shared<Visualizer>("solution visualizer"), util, config_file_name_) {
+
+    // callers have no console to step through the solution
+    solver.SetVisualization(false);
+    solver.SetWorkspace(workspace);
+
+    if (!camera_model_file_.empty())
+        solver.SetCameraModel(camera_model_file_);
+
+    if (camera_id_ >= 0)
+        util->SetCameraID(uint8_t(camera_id_));
+}
+
+bool PoseEstimator::SetCAD (const float* points_, size_t num_points_, uint8_t density_, float simplify_tolerance_) {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    if (num_points_ == 0) {
+        printf("FAILED to set CAD - no points\n");
+        return false;
+    }
+
+    std::vector<point> CAD_points;
+    ReadPoints(points_, num_points_, &CAD_points);
+
+    image_buffer.simplifyPoints(&CAD_points, simplify_tolerance_);
+    image_buffer.densifyPoints(&CAD_points, density_);
+
+    CAD_cloud.reset(new pcl::PointCloud<pcl::PointXYZ>);
+    image_buffer.populateCloud(&CAD_points, CAD_cloud, 0);
+
+    // also keeps the offset of the transferred shapes
+    util->originCloudxy(CAD_cloud);
+
+    return true;
+}
+
+bool PoseEstimator::Solve (const float* points_, size_t num_points_, const Eigen::Matrix4d& T_CS_initial_,
+                           PoseSolution* solution_, uint8_t density_, float simplify_tolerance_) {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    if (CAD_cloud == nullptr || num_points_ == 0) {
+        printf("FAILED to solve - %s\n", CAD_cloud == nullptr ? "CAD not set" : "no camera points");
+        return false;
+    }
+
+    std::vector<point> camera_points;
+    ReadPoints(points_, num_points_, &camera_points);
+
+    image_buffer.simplifyPoints(&camera_points, simplify_tolerance_);
+    image_buffer.densifyPoints(&camera_points, density_);
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr camera_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+    image_buffer.populateCloud(&camera_points, camera_cloud, 0);
+
+    Eigen::Matrix4d T_CS = T_CS_initial_;
+    solver.LoadInitialPose(T_CS);
+
+    solution_->converged = solver.SolveOptimization(CAD_cloud, camera_cloud);
+    solution_->T_CS = solver.GetTransform();
+    solution_->initial_pixel_error = solver.GetInitialPixelError();
+    solution_->final_pixel_error = solver.GetFinalPixelError();
+    solution_->solution_iterations = solver.GetSolutionIterations();
+
+    return true;
+}
+
+pcl::PointCloud<pcl::PointXYZ>::Ptr PoseEstimator::BackProject (const float* pixels_, size_t num_pixels_,
+                                                                const Eigen::Matrix4d& T_CS_) {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr image_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+    image_cloud->resize(num_pixels_);
+    for (size_t i = 0; i < num_pixels_; i++)
+        image_cloud->at(i) = pcl::PointXYZ(pixels_[2 * i], pixels_[2 * i + 1], 0);
+
+    Eigen::Matrix4d T_CS = T_CS_;
+    return util->BackProject(image_cloud, T_CS);
+}
+
+bool PoseEstimator::TransferShapes (const std::vector<LabelledShape>& shapes_camera_, const Eigen::Matrix4d& T_CS_,
+                                    std::vector<LabelledShape>* shapes_CAD_, double cloud_scale_) {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    if (CAD_cloud == nullptr) {
+        printf("FAILED to transfer shapes - CAD not set\n");
+        return false;
+    }
+
+    Eigen::Matrix4d T_CS = T_CS_;
+    return util->TransferShapes(shapes_camera_, T_CS, cloud_scale_ > 0 ? cloud_scale_ : solver.GetCloudScale(),
+                                shapes_CAD_);
+}
+
+double PoseEstimator::GetCloudScale () {
+    std::lock_guard<std::mutex> lock(mtx);
+    return solver.GetCloudScale();
+}
+
+void PoseEstimator::ReadPoints (const float* points_, size_t num_points_, std::vector<point>* output_) {
+    output_->resize(num_points_);
+    for (size_t i = 0; i < num_points_; i++)
+        (*output_)[i] = point(points_[2 * i], points_[2 * i + 1]);
+}
+
+} // namespace cam_cad
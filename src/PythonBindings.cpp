@@ -0,0 +1,153 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/eigen.h>
+#include <pybind11/stl.h>
+#include "PoseEstimator.h"
+
+namespace py = pybind11;
+
+namespace cam_cad {
+
+namespace {
+
+// float32 C contiguous arrays are used in place, other arrays are converted once
+typedef py::array_t<float, py::array::c_style | py::array::forcecast> PointArray;
+
+void CheckPoints (const PointArray& points_, const std::string& name_) {
+    if (points_.ndim() != 2 || points_.shape(1) != 2)
+        throw py::value_error(name_ + " must be an (N, 2) array of x, y pixels");
+}
+
+// hands the points to NumPy without copying them, the array owns the vector
+py::array_t<float> PointsToArray (std::vector<point>&& points_) {
+    std::vector<point>* points = new std::vector<point>(std::move(points_));
+    py::capsule owner(points, [](void* p_) { delete static_cast<std::vector<point>*>(p_); });
+
+    return py::array_t<float>(std::vector<py::ssize_t>{py::ssize_t(points->size()), 2},
+                              std::vector<py::ssize_t>{sizeof(point), sizeof(float)},
+                              points->empty() ? nullptr : &points->front().x, owner);
+}
+
+// views the x, y, z of the cloud points as an (N, 3) array, the array keeps the cloud alive
+py::array_t<float> CloudToArray (pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_) {
+    auto* cloud = new pcl::PointCloud<pcl::PointXYZ>::Ptr(cloud_);
+    py::capsule owner(cloud, [](void* p_) { delete static_cast<pcl::PointCloud<pcl::PointXYZ>::Ptr*>(p_); });
+
+    return py::array_t<float>(std::vector<py::ssize_t>{py::ssize_t(cloud_->size()), 3},
+                              std::vector<py::ssize_t>{sizeof(pcl::PointXYZ), sizeof(float)},
+                              cloud_->empty() ? nullptr : &cloud_->points.front().x, owner);
+}
+
+}
+
+}
+
+using namespace cam_cad;
+
+PYBIND11_MODULE(cam_cad, m) {
+    m.doc() = "Camera to CAD pose estimation, back projection and defect transfer on NumPy arrays. "
+              "Points are (N, 2) arrays of x, y pixels, float32 C contiguous arrays are read without "
+              "copying, and returned arrays share the memory of the results. The GIL is released "
+              "while an estimator works, so estimators (one per thread) run in parallel.";
+
+    py::class_<PoseSolution>(m, "PoseSolution")
+        .def_readonly("T_CS", &PoseSolution::T_CS)
+        .def_readonly("converged", &PoseSolution::converged)
+        .def_readonly("initial_pixel_error", &PoseSolution::initial_pixel_error)
+        .def_readonly("final_pixel_error", &PoseSolution::final_pixel_error)
+        .def_readonly("solution_iterations", &PoseSolution::solution_iterations)
+        .def("__repr__", [](const PoseSolution& solution_) {
+            return "<PoseSolution converged=" + std::string(solution_.converged ? "True" : "False") +
+                   " final_pixel_error=" + std::to_string(solution_.final_pixel_error) + ">";
+        });
+
+    py::class_<PoseEstimator>(m, "PoseEstimator")
+        .def(py::init<std::string, std::string, int>(),
+             py::arg("config_file"), py::arg("camera_model") = "", py::arg("camera_id") = -1,
+             "config_file: solution parameters json, camera_model: camera model file (default from "
+             "the solution parameters), camera_id: ladybug camera ID")
+
+        .def("set_cad", [](PoseEstimator& estimator_, PointArray points_, uint8_t density_, float simplify_tolerance_) {
+            CheckPoints(points_, "points");
+            const float* data = points_.data();
+            size_t num_points = points_.shape(0);
+            bool set;
+            {
+                py::gil_scoped_release release;
+                set = estimator_.SetCAD(data, num_points, density_, simplify_tolerance_);
+            }
+            if (!set) throw py::value_error("CAD outline has no points");
+        }, py::arg("points"), py::arg("density") = 2, py::arg("simplify_tolerance") = 0.0f,
+           "sets the CAD outline (CAD pixels) the images are solved against")
+
+        .def("solve", [](PoseEstimator& estimator_, PointArray points_, const Eigen::Matrix4d& T_CS_initial_,
+                         uint8_t density_, float simplify_tolerance_) {
+            CheckPoints(points_, "points");
+            const float* data = points_.data();
+            size_t num_points = points_.shape(0);
+            PoseSolution solution;
+            bool solved;
+            {
+                py::gil_scoped_release release;
+                solved = estimator_.Solve(data, num_points, T_CS_initial_, &solution, density_, simplify_tolerance_);
+            }
+            if (!solved) throw py::value_error("set_cad must be called and the camera outline must have points");
+            return solution;
+        }, py::arg("points"), py::arg("T_CS_initial"), py::arg("density") = 10, py::arg("simplify_tolerance") = 0.0f,
+           "solves the pose of the camera outline (image pixels) from the 4x4 initial T_CS")
+
+        .def("back_project", [](PoseEstimator& estimator_, PointArray pixels_, const Eigen::Matrix4d& T_CS_) {
+            CheckPoints(pixels_, "pixels");
+            const float* data = pixels_.data();
+            size_t num_pixels = pixels_.shape(0);
+            pcl::PointCloud<pcl::PointXYZ>::Ptr points;
+            {
+                py::gil_scoped_release release;
+                points = estimator_.BackProject(data, num_pixels, T_CS_);
+            }
+            // pixels without a ray, or whose ray misses the plane, are dropped by the back projection, 
+            // the returned rows must match the pixels
+            if (points->size() != num_pixels) 
+                throw py::value_error(std::to_string(num_pixels - points->size()) + " of " + 
+                                      std::to_string(num_pixels) + " pixels could not be back projected "
+                                      "onto the structure plane");
+            return CloudToArray(points);
+        }, py::arg("pixels"), py::arg("T_CS"),
+           "back projects image pixels onto the structure plane, returns (N, 3) camera frame points, "
+           "raises ValueError if a pixel has no ray or its ray misses the plane")
+
+        .def("transfer", [](PoseEstimator& estimator_, std::vector<PointArray> shapes_, const Eigen::Matrix4d& T_CS_,
+                            double cloud_scale_) {
+            std::vector<LabelledShape> shapes_camera(shapes_.size()), shapes_CAD;
+            std::vector<std::pair<const float*, size_t>> shape_points;
+            for (size_t i = 0; i < shapes_.size(); i++) {
+                CheckPoints(shapes_[i], "shapes[" + std::to_string(i) + "]");
+                shapes_camera[i].id = int32_t(i);
+                shape_points.push_back(std::make_pair(shapes_[i].data(), size_t(shapes_[i].shape(0))));
+            }
+            {
+                py::gil_scoped_release release;
+                for (size_t i = 0; i < shape_points.size(); i++) {
+                    const float* data = shape_points[i].first;
+                    shapes_camera[i].points.reserve(shape_points[i].second);
+                    for (size_t j = 0; j < shape_points[i].second; j++)
+                        shapes_camera[i].points.push_back(point(data[2 * j], data[2 * j + 1]));
+                }
+
+                // a dropped pixel also returns false, the shapes are still transferred
+                estimator_.TransferShapes(shapes_camera, T_CS_, &shapes_CAD, cloud_scale_);
+            }
+            if (shapes_CAD.size() != shapes_camera.size())
+                throw py::value_error("set_cad must be called before transferring shapes");
+
+            py::list shapes;
+            for (auto& shape : shapes_CAD)
+                shapes.append(PointsToArray(std::move(shape.points)));
+            return shapes;
+        }, py::arg("shapes"), py::arg("T_CS"), py::arg("cloud_scale") = 0.0,
+           "transfers a list of (N, 2) image pixel shapes (e.g. the defects of an image) to CAD pixels, "
+           "pixels that can not be back projected are dropped")
+
+        .def_property_readonly("cloud_scale", &PoseEstimator::GetCloudScale,
+                               "CAD scale of the solution parameters (structure unit/CAD pixel)");
+}
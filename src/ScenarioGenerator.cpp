@@ -0,0 +1,477 @@
+#include "ScenarioGenerator.h"
+
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <thread>
+
+using json = nlohmann::json;
+
+namespace cam_cad {
+
+ScenarioGenerator::ScenarioGenerator() {
+    image_width = 0;
+    image_height = 0;
+}
+
+bool ScenarioGenerator::ReadConfig (std::string config_file_name_) {
+    std::ifstream file(config_file_name_);
+
+    if (!file.is_open()) {
+        printf("failed to open scenario configuration: %s\n", config_file_name_.c_str());
+        return false;
+    }
+
+    json J;
+    file >> J;
+
+    config.num_images = J.value("num_images", config.num_images);
+    config.num_CAD = J.value("num_CAD", config.num_CAD);
+    config.seed = J.value("seed", config.seed);
+    config.camera_model = J.value("camera_model", config.camera_model);
+    config.solution_parameters = J.value("solution_parameters", config.solution_parameters);
+    config.cloud_scale = J.value("cloud_scale", config.cloud_scale);
+    config.CAD_size = J.value("CAD_size", config.CAD_size);
+    config.outline_vertices = J.value("outline_vertices", config.outline_vertices);
+    config.outline_roughness = J.value("outline_roughness", config.outline_roughness);
+    config.num_openings = J.value("num_openings", config.num_openings);
+    config.opening_vertices = J.value("opening_vertices", config.opening_vertices);
+    config.min_distance = J.value("min_distance", config.min_distance);
+    config.max_distance = J.value("max_distance", config.max_distance);
+    config.max_offset = J.value("max_offset", config.max_offset);
+    config.max_rotation = J.value("max_rotation", config.max_rotation);
+    config.pixel_noise = J.value("pixel_noise", config.pixel_noise);
+    config.outlier_rate = J.value("outlier_rate", config.outlier_rate);
+    config.outlier_distance = J.value("outlier_distance", config.outlier_distance);
+    config.num_defects = J.value("num_defects", config.num_defects);
+    config.defect_vertices = J.value("defect_vertices", config.defect_vertices);
+    config.initial_rotation_error = J.value("initial_rotation_error", config.initial_rotation_error);
+    config.initial_translation_error =
+        J.value("initial_translation_error", config.initial_translation_error);
+
+    // paths in the configuration are relative to the configuration file
+    size_t separator = config_file_name_.find_last_of('/');
+    std::string config_dir = separator == std::string::npos ?
+        "" : config_file_name_.substr(0, separator + 1);
+
+    if (!config.camera_model.empty() && config.camera_model[0] != '/')
+        config.camera_model = config_dir + config.camera_model;
+    if (!config.solution_parameters.empty() && config.solution_parameters[0] != '/')
+        config.solution_parameters = config_dir + config.solution_parameters;
+
+    return true;
+}
+
+void ScenarioGenerator::SetConfig (const ScenarioConfig& config_) {
+    config = config_;
+}
+
+const ScenarioConfig& ScenarioGenerator::GetConfig () {
+    return config;
+}
+
+bool ScenarioGenerator::Generate (std::string output_dir_, uint16_t num_workers_) {
+
+    if (config.camera_model.empty()) {
+        printf("a camera model is required to render the scenario\n");
+        return false;
+    }
+
+    if (config.CAD_size >= 2048 || config.num_CAD == 0) {
+        printf("CAD_size must be below 2048 pixels and num_CAD at least 1\n");
+        return false;
+    }
+
+    // image size of the rendering camera
+    std::shared_ptr<beam_calibration::CameraModel> camera_model =
+        CameraModelRegistry::GetInstance().Get(config.camera_model);
+
+    if (camera_model == nullptr) {
+        printf("failed to read camera model: %s\n", config.camera_model.c_str());
+        return false;
+    }
+
+    image_width = camera_model->GetWidth();
+    image_height = camera_model->GetHeight();
+
+    for (std::string dir : {"", "/CAD", "/images", "/defects", "/truth"})
+        mkdir((output_dir_ + dir).c_str(), 0755);
+
+    // CAD faces
+    std::vector<std::vector<point>> CAD_outlines (config.num_CAD);
+
+    for (uint32_t face = 0; face < config.num_CAD; face++) {
+        GenerateCAD(face, &CAD_outlines[face]);
+
+        std::string file_name = "CAD/CAD_" + std::to_string(face) + ".json";
+        if (!WriteLabels(output_dir_ + "/" + file_name, "CAD_" + std::to_string(face) + ".jpg",
+                         {"CAD outline"}, {CAD_outlines[face]}, true)) return false;
+    }
+
+    // images, each generated independently
+    std::vector<json> jobs (config.num_images);
+    std::atomic<uint32_t> next_image {0};
+    std::atomic<uint32_t> num_failed {0};
+
+    auto worker = [&]() {
+        Util util;
+        util.ReadCameraModel(config.camera_model);
+
+        for (uint32_t i = next_image++; i < config.num_images; i = next_image++) {
+            uint32_t face = i % config.num_CAD;
+            std::string name = "image_" + std::to_string(i);
+
+            Eigen::Matrix4d T_CS;
+            std::vector<point> camera_labels;
+            std::vector<std::vector<point>> defects_CAD, defects_camera;
+
+            if (!GenerateImage(i, CAD_outlines[face], util, T_CS, &camera_labels,
+                               &defects_CAD, &defects_camera)) {
+                printf("no valid pose found for %s\n", name.c_str());
+                num_failed++;
+                continue;
+            }
+
+            std::vector<std::string> defect_labels;
+            for (size_t d = 0; d < defects_camera.size(); d++)
+                defect_labels.push_back("defect_" + std::to_string(d));
+
+            bool written =
+                WriteLabels(output_dir_ + "/images/" + name + ".json", name + ".jpg",
+                            {"struct_outline"}, {camera_labels}, true) &&
+                WriteLabels(output_dir_ + "/defects/" + name + ".json", name + ".jpg",
+                            defect_labels, defects_camera, false) &&
+                WriteLabels(output_dir_ + "/truth/" + name + ".json",
+                            "CAD_" + std::to_string(face) + ".jpg",
+                            defect_labels, defects_CAD, false);
+
+            if (!written) {
+                num_failed++;
+                continue;
+            }
+
+            // initial pose: ground truth with a fixed size error of random sign on every axis
+            std::seed_seq seq {config.seed, 2u, i};
+            std::mt19937 gen(seq);
+            std::bernoulli_distribution sign;
+            Eigen::VectorXd perturbation(6, 1);
+            for (uint8_t axis = 0; axis < 6; axis++) {
+                double error = axis < 3 ? config.initial_rotation_error :
+                                          config.initial_translation_error;
+                perturbation(axis) = sign(gen) ? error : -error;
+            }
+            Eigen::Matrix4d T_initial = util.PerturbTransformDegM(T_CS, perturbation);
+
+            json job;
+            job["id"] = name;
+            job["camera_labels"] = "images/" + name + ".json";
+            job["CAD_labels"] = "CAD/CAD_" + std::to_string(face) + ".json";
+            job["camera_model"] = config.camera_model;
+            job["defect_labels"] = "defects/" + name + ".json";
+            job["truth_defects"] = "truth/" + name + ".json";
+            job["T_CS"] = json::array();
+            job["truth_T_CS"] = json::array();
+            for (uint8_t row = 0; row < 4; row++) {
+                for (uint8_t col = 0; col < 4; col++) {
+                    job["T_CS"].push_back(T_initial(row, col));
+                    job["truth_T_CS"].push_back(T_CS(row, col));
+                }
+            }
+
+            jobs[i] = job;
+        }
+    };
+
+    if (num_workers_ == 0)
+        num_workers_ = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<std::thread> workers;
+    for (uint16_t w = 0; w < num_workers_; w++)
+        workers.emplace_back(worker);
+    for (auto& thread : workers)
+        thread.join();
+
+    // batch manifest of all generated images
+    json manifest;
+    if (!config.solution_parameters.empty())
+        manifest["solution_parameters"] = config.solution_parameters;
+    manifest["seed"] = config.seed;
+    manifest["jobs"] = json::array();
+    for (auto& job : jobs)
+        if (!job.is_null()) manifest["jobs"].push_back(job);
+
+    std::ofstream fout(output_dir_ + "/manifest.json");
+    if (!fout.is_open()) {
+        printf("failed to write %s/manifest.json\n", output_dir_.c_str());
+        return false;
+    }
+    fout << manifest.dump(2) << std::endl;
+
+    printf("generated %u of %u images in %s\n",
+           config.num_images - num_failed.load(), config.num_images, output_dir_.c_str());
+
+    return num_failed == 0;
+}
+
+void ScenarioGenerator::GenerateCAD (uint32_t index_, std::vector<point>* outline_) {
+    std::seed_seq seq {config.seed, 0u, index_};
+    std::mt19937 gen(seq);
+    std::uniform_real_distribution<double> unif(0, 1);
+
+    double center = config.CAD_size / 2.0;
+    double radius = 0.48 * config.CAD_size;
+
+    // the outline never comes closer to the center than this
+    double inner_radius = radius * (1 - config.outline_roughness);
+
+    std::vector<point> outline = RadialPolygon(gen, center, center, radius,
+                                               config.outline_vertices, false);
+
+    // openings evenly spaced around the center, small enough not to touch each other or the outline
+    std::vector<std::vector<point>> openings;
+    std::vector<double> opening_angles;
+    double phase = 2 * M_PI * unif(gen);
+
+    for (uint16_t j = 0; j < config.num_openings; j++) {
+        double angle = phase + 2 * M_PI * j / config.num_openings;
+        double distance = config.num_openings == 1 ? 0 : 0.45 * inner_radius;
+        double opening_radius = config.num_openings == 1 ? 0.5 * inner_radius :
+            std::min(0.35 * inner_radius, 0.8 * distance * std::sin(M_PI / config.num_openings));
+
+        openings.push_back(RadialPolygon(gen, center + distance * std::cos(angle),
+                                         center + distance * std::sin(angle),
+                                         opening_radius, config.opening_vertices, true));
+        opening_angles.push_back(std::fmod(angle, 2 * M_PI));
+    }
+
+    // keyhole polygon: each opening is entered and left through a bridge from the
+    // outline vertex closest to its direction
+    outline_->clear();
+    size_t n = outline.size();
+
+    for (size_t i = 0; i < n; i++) {
+        outline_->push_back(outline[i]);
+
+        for (size_t j = 0; j < openings.size(); j++) {
+            size_t bridge = size_t(std::round(opening_angles[j] * n / (2 * M_PI))) % n;
+            if (bridge != i) continue;
+
+            // opening vertices are clockwise from angle 0, start at the one facing the outline
+            size_t m = openings[j].size();
+            size_t start = (m - size_t(std::round(opening_angles[j] * m / (2 * M_PI))) % m) % m;
+
+            for (size_t k = 0; k <= m; k++)
+                outline_->push_back(openings[j][(start + k) % m]);
+
+            outline_->push_back(outline[i]);
+        }
+    }
+
+    // close the outline
+    outline_->push_back(outline[0]);
+}
+
+bool ScenarioGenerator::GenerateImage (uint32_t index_, const std::vector<point>& CAD_outline_,
+                                       Util& util_, Eigen::Matrix4d& T_CS_,
+                                       std::vector<point>* camera_labels_,
+                                       std::vector<std::vector<point>>* defects_CAD_,
+                                       std::vector<std::vector<point>>* defects_camera_) {
+
+    std::seed_seq seq {config.seed, 1u, index_};
+    std::mt19937 gen(seq);
+    std::uniform_real_distribution<double> unif(-1, 1);
+    std::uniform_real_distribution<double> distance(config.min_distance, config.max_distance);
+    std::normal_distribution<double> noise(0, config.pixel_noise);
+    std::bernoulli_distribution outlier(config.outlier_rate);
+
+    // CAD offset, computed the same way the solver input is centered
+    pcl::PointCloud<pcl::PointXYZ>::Ptr outline_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+    for (auto& vertex : CAD_outline_)
+        outline_cloud->push_back(pcl::PointXYZ(vertex.x, vertex.y, 0));
+    util_.originCloudxy(outline_cloud);
+
+    double offset_x, offset_y;
+    util_.GetCloudOffsetxy(offset_x, offset_y);
+
+    // draw poses until the whole face is in front of the camera and inside the image
+    std::vector<point> image_outline;
+    bool valid_pose = false;
+
+    for (uint16_t attempt = 0; attempt < 100 && !valid_pose; attempt++) {
+        Eigen::VectorXd pose(6, 1);
+        pose << config.max_rotation * unif(gen), config.max_rotation * unif(gen),
+                config.max_rotation * unif(gen), config.max_offset * unif(gen),
+                config.max_offset * unif(gen), distance(gen);
+
+        T_CS_ = util_.PerturbTransformDegM(Eigen::Matrix4d::Identity(), pose);
+
+        valid_pose = Render(CAD_outline_, offset_x, offset_y, T_CS_, util_, &image_outline);
+    }
+
+    if (!valid_pose) return false;
+
+    // camera labels are integer pixels with noise and outliers
+    auto label = [&](const point& p_, bool allow_outlier_) {
+        double x = p_.x + noise(gen);
+        double y = p_.y + noise(gen);
+
+        if (allow_outlier_ && outlier(gen)) {
+            x += config.outlier_distance * unif(gen);
+            y += config.outlier_distance * unif(gen);
+        }
+
+        x = std::min(std::max(std::round(x), 0.0), double(image_width - 1));
+        y = std::min(std::max(std::round(y), 0.0), double(image_height - 1));
+
+        return point(x, y);
+    };
+
+    camera_labels_->clear();
+    for (auto& vertex : image_outline)
+        camera_labels_->push_back(label(vertex, true));
+
+    // defects: smooth random walks on the structure, away from the outline
+    double center = config.CAD_size / 2.0;
+    double max_radius = 0.45 * config.CAD_size * (1 - config.outline_roughness);
+    double step = 0.01 * config.CAD_size;
+    std::normal_distribution<double> turn(0, 0.3);
+
+    defects_CAD_->clear();
+    defects_camera_->clear();
+
+    for (uint16_t d = 0; d < config.num_defects; d++) {
+        double r = max_radius * std::sqrt(0.5 * (unif(gen) + 1));
+        double angle = M_PI * unif(gen);
+        double x = center + 0.8 * r * std::cos(angle);
+        double y = center + 0.8 * r * std::sin(angle);
+        double heading = M_PI * unif(gen);
+
+        std::vector<point> defect;
+
+        for (uint32_t v = 0; v < config.defect_vertices; v++) {
+            defect.push_back(point(std::round(x), std::round(y)));
+
+            heading += turn(gen);
+            double next_x = x + step * std::cos(heading);
+            double next_y = y + step * std::sin(heading);
+
+            // turn back at the edge of the defect area
+            if (std::hypot(next_x - center, next_y - center) > max_radius) {
+                heading += M_PI;
+                next_x = x + step * std::cos(heading);
+                next_y = y + step * std::sin(heading);
+            }
+
+            x = next_x;
+            y = next_y;
+        }
+
+        std::vector<point> image_defect;
+        if (!Render(defect, offset_x, offset_y, T_CS_, util_, &image_defect)) continue;
+
+        std::vector<point> camera_defect;
+        for (auto& vertex : image_defect)
+            camera_defect.push_back(label(vertex, false));
+
+        defects_CAD_->push_back(defect);
+        defects_camera_->push_back(camera_defect);
+    }
+
+    return true;
+}
+
+std::vector<point> ScenarioGenerator::RadialPolygon (std::mt19937& gen_, double center_x_,
+                                                     double center_y_, double radius_,
+                                                     uint32_t num_vertices_, bool clockwise_) {
+    std::uniform_real_distribution<double> unif(0, 1);
+    std::vector<point> polygon;
+
+    num_vertices_ = std::max(num_vertices_, 3u);
+
+    for (uint32_t i = 0; i < num_vertices_; i++) {
+        // one vertex per angular sector keeps the polygon simple (star shaped)
+        double angle = 2 * M_PI * (i + 0.8 * unif(gen_)) / num_vertices_;
+        double radius = radius_ * (1 - config.outline_roughness * unif(gen_));
+
+        if (clockwise_) angle = -angle;
+
+        polygon.push_back(point(std::round(center_x_ + radius * std::cos(angle)),
+                                std::round(center_y_ + radius * std::sin(angle))));
+    }
+
+    return polygon;
+}
+
+bool ScenarioGenerator::Render (const std::vector<point>& CAD_points_, double offset_x_,
+                                double offset_y_, Eigen::Matrix4d& T_CS_, Util& util_,
+                                std::vector<point>* image_points_) {
+
+    // CAD pixels -> centered, scaled structure cloud (as prepared for the solver)
+    pcl::PointCloud<pcl::PointXYZ>::Ptr CAD_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+    for (auto& vertex : CAD_points_) {
+        CAD_cloud->push_back(pcl::PointXYZ((vertex.x - (int)offset_x_) * config.cloud_scale,
+                                           (vertex.y - (int)offset_y_) * config.cloud_scale, 0));
+    }
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud = util_.TransformCloud(CAD_cloud, T_CS_);
+
+    for (auto& p : *trans_cloud)
+        if (p.z <= 0) return false;
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud = util_.ProjectCloud(trans_cloud);
+
+    // every point must project, and into the image
+    if (proj_cloud->size() != CAD_cloud->size()) return false;
+
+    image_points_->clear();
+    for (auto& p : *proj_cloud) {
+        if (p.x < 0 || p.y < 0 || p.x >= image_width || p.y >= image_height) return false;
+        image_points_->push_back(point(p.x, p.y));
+    }
+
+    return true;
+}
+
+bool ScenarioGenerator::WriteLabels (std::string file_name_, std::string image_path_,
+                                     const std::vector<std::string>& labels_,
+                                     const std::vector<std::vector<point>>& shapes_, bool closed_) {
+    json J;
+    J["flags"] = json::object();
+    J["shapes"] = json::array();
+
+    for (size_t s = 0; s < shapes_.size(); s++) {
+        json points = json::array();
+        for (auto& vertex : shapes_[s])
+            points.push_back({int(vertex.x), int(vertex.y)});
+
+        J["shapes"].push_back({{"label", labels_[s]},
+                               {"line_color", nullptr},
+                               {"fill_color", nullptr},
+                               {"points", points},
+                               {"shape_type", closed_ ? "polygon" : "linestrip"}});
+    }
+
+    J["lineColor"] = {0, 255, 0, 128};
+    J["fillColor"] = {255, 0, 0, 128};
+    J["imagePath"] = image_path_;
+    J["imageData"] = nullptr;
+    J["imageWidth"] = image_width;
+    J["imageHeight"] = image_height;
+
+    std::ofstream fout(file_name_);
+
+    if (!fout.is_open()) {
+        printf("failed to write %s\n", file_name_.c_str());
+        return false;
+    }
+
+    fout << J.dump(2) << std::endl;
+
+    return true;
+}
+
+} // namespace cam_cad
@@ -0,0 +1,243 @@
+#include "SolutionCache.h"
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+using json = nlohmann::json;
+
+namespace cam_cad {
+
+SolutionCache::SolutionCache(size_t max_entries_) {
+    max_entries = max_entries_;
+    num_hits = 0;
+    num_misses = 0;
+    num_evicted = 0;
+}
+
+bool SolutionCache::Load (std::string file_name_) {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    entries.clear();
+    index.clear();
+
+    std::ifstream file(file_name_);
+
+    // nothing has been cached yet
+    if (!file.is_open())
+        return true;
+
+    json J;
+
+    try {
+        file >> J;
+    }
+    catch (json::exception& e) {
+        std::cout << "failed to parse solution cache:" << file_name_ << " " << e.what() << std::endl;
+        return false;
+    }
+
+    if (!J.is_object() || !J.contains("solutions") || !J["solutions"].is_array()) {
+        std::cout << "solution cache must contain \"solutions\":" << file_name_ << std::endl;
+        return false;
+    }
+
+    size_t num_skipped = 0;
+
+    for (auto& entry : J["solutions"]) {
+        // a damaged entry only costs its own lookup
+        uint64_t key;
+        CachedSolution solution;
+
+        try {
+            if (!entry.is_object() || !entry.contains("key") || !entry.contains("T_CS") || 
+                !entry["T_CS"].is_array() || entry["T_CS"].size() != 16) {
+                num_skipped++;
+                continue;
+            }
+
+            std::string key_string = entry["key"].get<std::string>();
+            size_t key_end = 0;
+            key = std::stoull(key_string, &key_end, 16);
+            if (key_end != key_string.size()) {
+                num_skipped++;
+                continue;
+            }
+
+            for (uint8_t row = 0; row < 4; row++)
+                for (uint8_t col = 0; col < 4; col++)
+                    solution.T_CS(row, col) = entry["T_CS"][row * 4 + col].get<double>();
+            solution.converged = entry.value("converged", false);
+            solution.initial_pixel_error = entry.value("initial_pixel_error", 0.0);
+            solution.final_pixel_error = entry.value("final_pixel_error", 0.0);
+            solution.solution_iterations = entry.value("solution_iterations", 0);
+        }
+        catch (const std::exception&) {
+            num_skipped++;
+            continue;
+        }
+
+        // the file is in least recently used order, a repeated key keeps its last entry
+        auto existing = index.find(key);
+        if (existing != index.end())
+            entries.erase(existing->second);
+
+        entries.push_back(std::make_pair(key, solution));
+        index[key] = std::prev(entries.end());
+    }
+
+    if (num_skipped > 0)
+        std::cout << "skipped " << num_skipped << " invalid entries of solution cache:" << file_name_ << std::endl;
+
+    Evict();
+
+    return true;
+}
+
+bool SolutionCache::Save (std::string file_name_) {
+    json J;
+    J["solutions"] = json::array();
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        for (auto& entry : entries) {
+            std::stringstream key;
+            key << std::hex << std::setw(16) << std::setfill('0') << entry.first;
+
+            const CachedSolution& solution = entry.second;
+            json cached;
+            cached["key"] = key.str();
+            cached["converged"] = solution.converged;
+            cached["initial_pixel_error"] = solution.initial_pixel_error;
+            cached["final_pixel_error"] = solution.final_pixel_error;
+            cached["solution_iterations"] = solution.solution_iterations;
+
+            cached["T_CS"] = json::array();
+            for (uint8_t row = 0; row < 4; row++)
+                for (uint8_t col = 0; col < 4; col++)
+                    cached["T_CS"].push_back(solution.T_CS(row, col));
+
+            J["solutions"].push_back(cached);
+        }
+    }
+
+    // written next to the cache and renamed over it, so an interrupted run (or two runs sharing 
+    // the cache) never leaves a half written file behind
+    std::string temp_file_name = file_name_ + ".tmp";
+    std::ofstream file(temp_file_name);
+
+    if (!file.is_open()) {
+        std::cout << "failed to open solution cache:" << temp_file_name << std::endl;
+        return false;
+    }
+
+    // doubles are written with round trip precision, so cached poses read back exactly
+    file << J.dump(2);
+    file.close();
+
+    if (file.fail() || std::rename(temp_file_name.c_str(), file_name_.c_str()) != 0) {
+        std::cout << "failed to write solution cache:" << file_name_ << std::endl;
+        std::remove(temp_file_name.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool SolutionCache::Get (uint64_t key_, CachedSolution& solution_) {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    auto existing = index.find(key_);
+    if (existing == index.end()) {
+        num_misses++;
+        return false;
+    }
+
+    // moves the solution to the most recently used end
+    entries.splice(entries.end(), entries, existing->second);
+    solution_ = existing->second->second;
+    num_hits++;
+
+    return true;
+}
+
+void SolutionCache::Put (uint64_t key_, const CachedSolution& solution_) {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    auto existing = index.find(key_);
+    if (existing != index.end())
+        entries.erase(existing->second);
+
+    entries.push_back(std::make_pair(key_, solution_));
+    index[key_] = std::prev(entries.end());
+
+    Evict();
+}
+
+void SolutionCache::SetMaxEntries (size_t max_entries_) {
+    std::lock_guard<std::mutex> lock(mtx);
+    max_entries = max_entries_;
+    Evict();
+}
+
+void SolutionCache::Clear () {
+    std::lock_guard<std::mutex> lock(mtx);
+    entries.clear();
+    index.clear();
+}
+
+size_t SolutionCache::GetSize () {
+    std::lock_guard<std::mutex> lock(mtx);
+    return entries.size();
+}
+
+uint64_t SolutionCache::GetNumHits () {
+    std::lock_guard<std::mutex> lock(mtx);
+    return num_hits;
+}
+
+uint64_t SolutionCache::GetNumMisses () {
+    std::lock_guard<std::mutex> lock(mtx);
+    return num_misses;
+}
+
+uint64_t SolutionCache::GetNumEvicted () {
+    std::lock_guard<std::mutex> lock(mtx);
+    return num_evicted;
+}
+
+bool SolutionCache::HashFile (std::string file_name_, uint64_t& hash_) {
+    std::ifstream file(file_name_, std::ios::binary);
+
+    if (!file.is_open()) {
+        std::cout << "failed to open file:" << file_name_ << std::endl;
+        return false;
+    }
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+    hash_ = CADCache::Hash(contents.str(), hash_);
+
+    return true;
+}
+
+uint64_t SolutionCache::HashTransform (const Eigen::Matrix4d& T_, uint64_t seed_) {
+    // the exact bits, any change of the initial pose can change the solution
+    std::string data(sizeof(double) * 16, '\0');
+    for (uint8_t i = 0; i < 16; i++) {
+        double value = T_(i);
+        std::memcpy(&data[i * sizeof(double)], &value, sizeof(double));
+    }
+    return CADCache::Hash(data, seed_);
+}
+
+void SolutionCache::Evict () {
+    while (entries.size() > max_entries) {
+        index.erase(entries.front().first);
+        entries.pop_front();
+        num_evicted++;
+    }
+}
+
+} // namespace cam_cad
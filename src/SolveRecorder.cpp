@@ -0,0 +1,268 @@
+#include "SolveRecorder.h"
+
+#include <iostream>
+#include <stdio.h>
+
+namespace cam_cad {
+
+// file layout: magic, header (num frames, num dropped, camera points), camera cloud, frames
+static const char RECORDING_MAGIC[8] = {'C', 'C', 'A', 'D', 'R', 'E', 'C', '1'};
+
+SolveRecorder::SolveRecorder(uint32_t capacity_) : num_dropped(0) {
+    capacity = capacity_ > 0 ? capacity_ : 1;
+    frames.resize(capacity);
+    head = 0;
+    num_frames = 0;
+}
+
+void SolveRecorder::BeginSession (pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_) {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    head = 0;
+    num_frames = 0;
+    num_dropped = 0;
+
+    camera_cloud.clear();
+    camera_cloud.reserve(2 * camera_cloud_->size());
+    for (auto& point : *camera_cloud_) {
+        camera_cloud.push_back(point.x);
+        camera_cloud.push_back(point.y);
+    }
+}
+
+bool SolveRecorder::Record (uint32_t iteration_, double pixel_error_, const Eigen::Matrix4d& T_CS_, 
+                            pcl::PointCloud<pcl::PointXYZ>::ConstPtr trans_cloud_, 
+                            pcl::PointCloud<pcl::PointXYZ>::ConstPtr proj_cloud_, 
+                            pcl::CorrespondencesConstPtr corrs_) {
+
+    // the solver never waits for a save in progress
+    std::unique_lock<std::mutex> lock(mtx, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        num_dropped++;
+        return false;
+    }
+
+    // slots keep their allocations, so steady state recording does not allocate
+    RecordedFrame& frame = frames[head];
+    frame.iteration = iteration_;
+    frame.pixel_error = pixel_error_;
+    frame.T_CS = T_CS_;
+
+    frame.trans_cloud.clear();
+    for (auto& point : *trans_cloud_) {
+        frame.trans_cloud.push_back(point.x);
+        frame.trans_cloud.push_back(point.y);
+        frame.trans_cloud.push_back(point.z);
+    }
+
+    frame.proj_cloud.clear();
+    for (auto& point : *proj_cloud_) {
+        frame.proj_cloud.push_back(point.x);
+        frame.proj_cloud.push_back(point.y);
+    }
+
+    frame.corrs.clear();
+    for (auto& corr : *corrs_) {
+        frame.corrs.push_back(corr.index_query);
+        frame.corrs.push_back(corr.index_match);
+    }
+
+    head = (head + 1) % capacity;
+    if (num_frames < capacity) num_frames++;
+
+    return true;
+}
+
+bool SolveRecorder::Save (std::string file_name_) {
+    std::ofstream fout(file_name_, std::ios::binary);
+
+    if (!fout.is_open()) {
+        printf("failed to open recording file: %s\n", file_name_.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+
+    auto write_u32 = [&fout](uint32_t value_) {
+        fout.write(reinterpret_cast<const char*>(&value_), sizeof(value_));
+    };
+
+    fout.write(RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+    write_u32(num_frames);
+    write_u32(num_dropped);
+    write_u32(camera_cloud.size() / 2);
+    fout.write(reinterpret_cast<const char*>(camera_cloud.data()), 
+               camera_cloud.size() * sizeof(float));
+
+    // oldest frame first
+    uint32_t oldest = (head + capacity - num_frames) % capacity;
+
+    for (uint32_t i = 0; i < num_frames; i++) {
+        const RecordedFrame& frame = frames[(oldest + i) % capacity];
+
+        write_u32(frame.iteration);
+        fout.write(reinterpret_cast<const char*>(&frame.pixel_error), sizeof(double));
+        fout.write(reinterpret_cast<const char*>(frame.T_CS.data()), 16 * sizeof(double));
+
+        write_u32(frame.trans_cloud.size() / 3);
+        fout.write(reinterpret_cast<const char*>(frame.trans_cloud.data()), 
+                   frame.trans_cloud.size() * sizeof(float));
+
+        write_u32(frame.proj_cloud.size() / 2);
+        fout.write(reinterpret_cast<const char*>(frame.proj_cloud.data()), 
+                   frame.proj_cloud.size() * sizeof(float));
+
+        write_u32(frame.corrs.size() / 2);
+        fout.write(reinterpret_cast<const char*>(frame.corrs.data()), 
+                   frame.corrs.size() * sizeof(uint32_t));
+    }
+
+    return fout.good();
+}
+
+bool SolveRecorder::Load (std::string file_name_) {
+    std::ifstream fin(file_name_, std::ios::binary);
+
+    if (!fin.is_open()) {
+        printf("failed to open recording file: %s\n", file_name_.c_str());
+        return false;
+    }
+
+    char magic[sizeof(RECORDING_MAGIC)];
+    fin.read(magic, sizeof(magic));
+
+    if (!fin || !std::equal(magic, magic + sizeof(magic), RECORDING_MAGIC)) {
+        printf("not a solver recording: %s\n", file_name_.c_str());
+        return false;
+    }
+
+    // every size read from the file is checked against the bytes left in it before anything is 
+    // allocated, so a damaged header fails instead of requesting gigabytes
+    std::streampos data_start = fin.tellg();
+    fin.seekg(0, std::ios::end);
+    uint64_t file_size = fin.tellg();
+    fin.seekg(data_start);
+
+    auto read_u32 = [&fin]() {
+        uint32_t value = 0;
+        fin.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    };
+
+    auto fits = [&fin, file_size](uint64_t count_, uint64_t element_size_) {
+        if (!fin) return false;
+        uint64_t position = fin.tellg();
+        return position <= file_size && count_ <= (file_size - position) / element_size_;
+    };
+
+    // iteration, pixel error, T_CS and the three array sizes
+    const uint64_t frame_header_size = 4 + sizeof(double) + 16 * sizeof(double) + 3 * 4;
+
+    std::lock_guard<std::mutex> lock(mtx);
+
+    head = 0;
+    num_frames = 0;
+
+    uint32_t num_saved = read_u32();
+    num_dropped = read_u32();
+    uint64_t num_camera_values = 2 * uint64_t(read_u32());
+
+    bool valid = fits(num_camera_values, sizeof(float));
+    if (valid) {
+        camera_cloud.resize(num_camera_values);
+        fin.read(reinterpret_cast<char*>(camera_cloud.data()), camera_cloud.size() * sizeof(float));
+        valid = fits(num_saved, frame_header_size);
+    }
+
+    if (valid) {
+        capacity = num_saved > 0 ? num_saved : 1;
+        frames.assign(capacity, RecordedFrame());
+    }
+
+    for (uint32_t i = 0; i < num_saved && valid; i++) {
+        RecordedFrame& frame = frames[i];
+
+        frame.iteration = read_u32();
+        fin.read(reinterpret_cast<char*>(&frame.pixel_error), sizeof(double));
+        fin.read(reinterpret_cast<char*>(frame.T_CS.data()), 16 * sizeof(double));
+
+        uint64_t num_trans_values = 3 * uint64_t(read_u32());
+        valid = fits(num_trans_values, sizeof(float));
+        if (!valid) break;
+        frame.trans_cloud.resize(num_trans_values);
+        fin.read(reinterpret_cast<char*>(frame.trans_cloud.data()), 
+                 frame.trans_cloud.size() * sizeof(float));
+
+        uint64_t num_proj_values = 2 * uint64_t(read_u32());
+        valid = fits(num_proj_values, sizeof(float));
+        if (!valid) break;
+        frame.proj_cloud.resize(num_proj_values);
+        fin.read(reinterpret_cast<char*>(frame.proj_cloud.data()), 
+                 frame.proj_cloud.size() * sizeof(float));
+
+        uint64_t num_corr_values = 2 * uint64_t(read_u32());
+        valid = fits(num_corr_values, sizeof(uint32_t));
+        if (!valid) break;
+        frame.corrs.resize(num_corr_values);
+        fin.read(reinterpret_cast<char*>(frame.corrs.data()), 
+                 frame.corrs.size() * sizeof(uint32_t));
+    }
+
+    if (!valid || !fin) {
+        printf("truncated or damaged solver recording: %s\n", file_name_.c_str());
+        return false;
+    }
+
+    num_frames = num_saved;
+
+    return true;
+}
+
+uint32_t SolveRecorder::GetNumFrames () {
+    std::lock_guard<std::mutex> lock(mtx);
+    return num_frames;
+}
+
+uint32_t SolveRecorder::GetNumDropped () {
+    return num_dropped;
+}
+
+bool SolveRecorder::GetFrame (uint32_t index_, RecordedFrame& frame_, 
+                              pcl::PointCloud<pcl::PointXYZ>::Ptr camera_cloud_, 
+                              pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud_, 
+                              pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud_, 
+                              pcl::CorrespondencesPtr corrs_) {
+
+    std::lock_guard<std::mutex> lock(mtx);
+
+    if (index_ >= num_frames) return false;
+
+    uint32_t oldest = (head + capacity - num_frames) % capacity;
+    frame_ = frames[(oldest + index_) % capacity];
+
+    camera_cloud_->clear();
+    for (size_t i = 0; i + 1 < camera_cloud.size(); i += 2)
+        camera_cloud_->push_back(pcl::PointXYZ(camera_cloud[i], camera_cloud[i + 1], 0));
+
+    trans_cloud_->clear();
+    for (size_t i = 0; i + 2 < frame_.trans_cloud.size(); i += 3) {
+        trans_cloud_->push_back(pcl::PointXYZ(frame_.trans_cloud[i], frame_.trans_cloud[i + 1], 
+                                              frame_.trans_cloud[i + 2]));
+    }
+
+    proj_cloud_->clear();
+    for (size_t i = 0; i + 1 < frame_.proj_cloud.size(); i += 2)
+        proj_cloud_->push_back(pcl::PointXYZ(frame_.proj_cloud[i], frame_.proj_cloud[i + 1], 0));
+
+    corrs_->clear();
+    for (size_t i = 0; i + 1 < frame_.corrs.size(); i += 2) {
+        pcl::Correspondence corr;
+        corr.index_query = frame_.corrs[i];
+        corr.index_match = frame_.corrs[i + 1];
+        corrs_->push_back(corr);
+    }
+
+    return true;
+}
+
+} // namespace cam_cad
@@ -12,45 +12,81 @@ Solver::Solver(std::shared_ptr<Visualizer> vis_, std::shared_ptr<Util> util_,
     util->ReadCameraModel(cam_intrinsics_file_);
     camera_model = util->GetCameraModel();
 
+    workspace = std::make_shared<SolverWorkspace>();
+
     solution_iterations_ = 0;
 }; 
 
 bool Solver::SolveOptimization (pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_, 
                                 pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_) {
 
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_scaled = 
+        util->ScaleCloud(CAD_cloud_, cloud_scale_);
+
+    return SolveScaledOptimization(CAD_cloud_scaled, camera_cloud_);
+}
+
+bool Solver::SolveOptimization (std::shared_ptr<const PreparedCAD> CAD_, 
+                                pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_) {
+
+    // the prepared cloud can be used directly if it was scaled for this solver
+    if (CAD_->scale == cloud_scale_) 
+        return SolveScaledOptimization(CAD_->scaled_cloud, camera_cloud_);
+
+    return SolveOptimization(CAD_->cloud, camera_cloud_);
+}
+
+bool Solver::SolveScaledOptimization (pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_scaled, 
+                                      pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_) {
+
+    StageTimer timer("solve_optimization");
+
     bool has_converged = false;
+
+    // a solver can be reused for several solutions, so the count restarts for each one
+    solution_iterations_ = 0;
+
+    // the utility object may have switched cameras (ladybug) since the last solution
+    camera_model = util->GetCameraModel();
     
-    pcl::PointCloud<pcl::PointXYZ>::Ptr CAD_cloud_scaled 
-        (new pcl::PointCloud<pcl::PointXYZ>);
-    pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud 
-        (new pcl::PointCloud<pcl::PointXYZ>);
-    pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud 
-        (new pcl::PointCloud<pcl::PointXYZ>);
+    // the iteration clouds are reused across iterations and solutions
+    workspace->BeginProblem(CAD_cloud_scaled->size(), camera_cloud_->size());
 
-    // correspondence object tells the cost function which points to compare
-    pcl::CorrespondencesPtr proj_corrs (new pcl::Correspondences); 
+    pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud = workspace->GetTransformedCloud();
+    pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud = workspace->GetProjectedCloud();
 
-    CAD_cloud_scaled = util->ScaleCloud(CAD_cloud_, cloud_scale_);
+    // correspondence object tells the cost function which points to compare
+    pcl::CorrespondencesPtr proj_corrs = workspace->GetCorrespondences(); 
 
     if (visualize_)
         vis->startVis();
 
-    // transform, project, and get correspondences
-    util->CorrEst(CAD_cloud_scaled, camera_cloud_, T_CS, proj_corrs, offset_type_);
-
-    // transformed cloud is only for the visualizer, 
+    // transformed cloud is only for the visualizer and recorder, 
     //the actual ceres solution takes just the original 
     //CAD cloud and the iterative results 
-    trans_cloud = util->TransformCloud(CAD_cloud_scaled, T_CS);
+    bool keep_transformed = visualize_ || recorder != nullptr;
 
-    // project cloud for visualizer
-    proj_cloud = util->ProjectCloud(trans_cloud);
+    // transform, project, and get correspondences, the projection is left in proj_cloud
+    util->CorrEst(CAD_cloud_scaled, camera_cloud_, T_CS, proj_corrs, offset_type_, *workspace, 
+                  keep_transformed ? trans_cloud : nullptr);
 
     // blow up the transformed cloud for visualization
-    util->ScaleCloud(trans_cloud,(1/cloud_scale_));
+    if (keep_transformed) 
+        util->ScaleCloud(trans_cloud,(1/cloud_scale_));
 
     // set initial error before optimizing
     SetInitialPixelError(proj_cloud, camera_cloud_, proj_corrs);
+    final_projection_error_ = initial_projection_error_;
+
+    if (recorder != nullptr) {
+        recorder->BeginSession(camera_cloud_);
+        recorder->Record(0, initial_projection_error_, T_CS, trans_cloud, proj_cloud, proj_corrs);
+    }
+
+    if (renderer != nullptr) {
+        renderer->BeginSession(camera_cloud_, camera_model->GetWidth(), camera_model->GetHeight());
+        renderer->Render(0, initial_projection_error_, proj_cloud, proj_corrs);
+    }
 
     // loop problem until it has converged 
     while (!has_converged && solution_iterations_ < max_solution_iterations_) {
@@ -73,7 +109,11 @@ bool Solver::SolveOptimization (pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_clo
                 cin >> end; 
             }
 
-            if (end == 'r') return false;
+            // stop the visualizer thread before leaving, a second solve would start a new one
+            if (end == 'r') {
+                vis->endVis();
+                return false;
+            }
         }
 
         BuildCeresProblem(problem, proj_corrs, camera_model, 
@@ -88,23 +128,29 @@ bool Solver::SolveOptimization (pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_clo
             std::cout << T_CS << sep;
         }
 
-        // transform, project, and get correspondences
-        util->CorrEst(CAD_cloud_scaled, camera_cloud_, T_CS, proj_corrs, offset_type_);
-
-        // update the position of the transformed cloud based on 
-        //the upated transformation matrix for visualization
-        trans_cloud = util->TransformCloud(CAD_cloud_scaled, T_CS);
-
-        // project cloud for visualizer
-        proj_cloud = util->ProjectCloud(trans_cloud);
+        // transform, project, and get correspondences, also updates the position of the 
+        //transformed cloud based on the upated transformation matrix for visualization
+        util->CorrEst(CAD_cloud_scaled, camera_cloud_, T_CS, proj_corrs, offset_type_, *workspace, 
+                      keep_transformed ? trans_cloud : nullptr);
 
         // blow up the transformed CAD cloud for visualization
-        util->ScaleCloud(trans_cloud,(1/cloud_scale_));
+        if (keep_transformed) 
+            util->ScaleCloud(trans_cloud,(1/cloud_scale_));
 
         if (convergence_type_ == "pixel")
             has_converged = CheckPixelConvergence(proj_cloud, camera_cloud_, 
                                                     proj_corrs, convergence_limit_);
 
+        workspace->Update();
+
+        if (recorder != nullptr) {
+            recorder->Record(solution_iterations_, final_projection_error_, T_CS, 
+                             trans_cloud, proj_cloud, proj_corrs);
+        }
+
+        if (renderer != nullptr) 
+            renderer->Render(solution_iterations_, final_projection_error_, proj_cloud, proj_corrs);
+
     }
 
     if (visualize_)
@@ -246,10 +292,56 @@ void Solver::SetMaxMinimizerIterations (uint16_t max_iter_) {
     max_ceres_iterations_ = max_iter_;
 }
 
+void Solver::SetVisualization (bool enable_) {
+    visualize_ = enable_;
+}
+
+void Solver::SetFloatPrecision (bool enable_) {
+    util->SetFloatPrecision(enable_);
+}
+
+void Solver::SetRecorder (std::shared_ptr<SolveRecorder> recorder_) {
+    recorder = recorder_;
+}
+
+std::shared_ptr<SolveRecorder> Solver::GetRecorder () {
+    return recorder;
+}
+
+void Solver::SetRenderer (std::shared_ptr<ConvergenceRenderer> renderer_) {
+    renderer = renderer_;
+}
+
+std::shared_ptr<ConvergenceRenderer> Solver::GetRenderer () {
+    return renderer;
+}
+
+void Solver::SetWorkspace (std::shared_ptr<SolverWorkspace> workspace_) {
+    workspace = workspace_;
+}
+
+std::shared_ptr<SolverWorkspace> Solver::GetWorkspace () {
+    return workspace;
+}
+
+void Solver::SetCameraModel (std::string intrinsics_file_) {
+    cam_intrinsics_file_ = intrinsics_file_;
+    util->ReadCameraModel(cam_intrinsics_file_);
+    camera_model = util->GetCameraModel();
+}
+
+double Solver::GetCloudScale () {
+    return cloud_scale_;
+}
+
 double Solver::GetInitialPixelError () {
     return initial_projection_error_;
 }
 
+double Solver::GetFinalPixelError () {
+    return final_projection_error_;
+}
+
 int Solver::GetSolutionIterations () {
     return solution_iterations_;
 }
@@ -260,10 +352,12 @@ void Solver::BuildCeresProblem(std::shared_ptr<ceres::Problem>& problem,
                           pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_,
                           pcl::PointCloud<pcl::PointXYZ>::ConstPtr cad_cloud_) {
 
+    StageTimer timer("problem_build");
+
     problem->AddParameterBlock(&(results[0]), 7,
                                 se3_parameterization_.get());
 
-    for (int i = 0; i < corrs_->size(); i++) {
+    for (size_t i = 0; i < corrs_->size(); i++) {
         Eigen::Vector2d pixel (camera_cloud_->at(corrs_->at(i).index_match).x,
                                 camera_cloud_->at(corrs_->at(i).index_match).y);
 
@@ -284,6 +378,7 @@ void Solver::BuildCeresProblem(std::shared_ptr<ceres::Problem>& problem,
 
 void Solver::SolveCeresProblem(const std::shared_ptr<ceres::Problem>& problem, 
                                 bool output_results) {
+    StageTimer timer("ceres_solve");
     ceres::Solver::Summary ceres_summary;
     ceres::Solve(ceres_solver_options_, problem.get(), &ceres_summary);
     if (output_results) {
@@ -297,13 +392,15 @@ void Solver::SolveCeresProblem(const std::shared_ptr<ceres::Problem>& problem,
 bool Solver::CheckPixelConvergence(pcl::PointCloud<pcl::PointXYZ>::ConstPtr query_cloud_, 
                                     pcl::PointCloud<pcl::PointXYZ>::ConstPtr match_cloud_, 
                                     pcl::CorrespondencesPtr corrs_, uint16_t pixel_threshold_) {
+  StageTimer timer("convergence_check");
 
-  float pixel_error = 0;
+  // accumulated in double, large clouds would lose the per-point contributions in float
+  double pixel_error = 0;
     
-  for (uint16_t i = 0; i < corrs_->size(); i++) {
+  for (size_t i = 0; i < corrs_->size(); i++) {
 
-    uint16_t proj_point_index = corrs_->at(i).index_query;
-    uint16_t cam_point_index = corrs_->at(i).index_match;
+    size_t proj_point_index = corrs_->at(i).index_query;
+    size_t cam_point_index = corrs_->at(i).index_match;
 
     float error_x = query_cloud_->at(proj_point_index).x - match_cloud_->at(cam_point_index).x;
     float error_y = query_cloud_->at(proj_point_index).y - match_cloud_->at(cam_point_index).y;
@@ -315,6 +412,8 @@ bool Solver::CheckPixelConvergence(pcl::PointCloud<pcl::PointXYZ>::ConstPtr quer
   // average pixel error
   pixel_error /= corrs_->size();
 
+  final_projection_error_ = pixel_error;
+
   if (pixel_error <= pixel_threshold_)
     return true;
 
@@ -349,6 +448,10 @@ void Solver::ReadSolutionParams(std::string file_name_) {
   parameter_tolerance_ = J["parameter_tolerance"];
   cam_intrinsics_file_ = J["camera_intrinsics"];
   visualize_ = J["visualize"];
+
+  // optional: transform and project in single precision, the pose optimization stays double
+  util->SetFloatPrecision(J.value("float_precision", false));
+
   convergence_type_ = J["convergence_type"];
   offset_type_ = J["offset_type"];
 
@@ -375,10 +478,10 @@ void Solver::SetInitialPixelError(pcl::PointCloud<pcl::PointXYZ>::ConstPtr query
                                 pcl::CorrespondencesPtr corrs_) {
     double pixel_error = 0;
     
-    for (uint16_t i = 0; i < corrs_->size(); i++) {
+    for (size_t i = 0; i < corrs_->size(); i++) {
 
-        uint16_t proj_point_index = corrs_->at(i).index_query;
-        uint16_t cam_point_index = corrs_->at(i).index_match;
+        size_t proj_point_index = corrs_->at(i).index_query;
+        size_t cam_point_index = corrs_->at(i).index_match;
 
         double error_x = query_cloud_->at(proj_point_index).x - 
                             match_cloud_->at(cam_point_index).x;
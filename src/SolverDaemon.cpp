@@ -0,0 +1,519 @@
+#include "SolverDaemon.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+
+using json = nlohmann::json;
+
+namespace cam_cad {
+
+SolverDaemon::SolverDaemon() {
+    socket_fd = -1;
+    shutdown_requested = false;
+    request_timeout_ms = 30000;
+    max_request_size = 64 << 20;
+}
+
+SolverDaemon::~SolverDaemon() {
+    Stop();
+}
+
+bool SolverDaemon::Start (std::string socket_path_) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+
+    if (socket_path_.size() >= sizeof(address.sun_path)) {
+        std::cout << "socket path too long:" << socket_path_ << std::endl;
+        return false;
+    }
+
+    socket_path_.copy(address.sun_path, socket_path_.size());
+
+    socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_fd < 0) {
+        perror("failed to create socket");
+        return false;
+    }
+
+    // replace a socket file left behind by a previous daemon
+    unlink(socket_path_.c_str());
+
+    if (bind(socket_fd, (sockaddr*)&address, sizeof(address)) < 0 || listen(socket_fd, 8) < 0) {
+        perror("failed to bind socket");
+        close(socket_fd);
+        socket_fd = -1;
+        return false;
+    }
+
+    socket_path = socket_path_;
+    shutdown_requested = false;
+
+    printf("solver daemon listening on %s \n", socket_path.c_str());
+
+    return true;
+}
+
+void SolverDaemon::Serve () {
+    while (!shutdown_requested && socket_fd >= 0) {
+        int client_fd = accept(socket_fd, nullptr, nullptr);
+        if (client_fd < 0) {
+            // a signal, or a client that gave up before it was accepted, anything else (e.g. out 
+            // of file descriptors) fails again on every call
+            if (errno == EINTR || errno == ECONNABORTED) 
+                continue;
+            perror("failed to accept connection");
+            break;
+        }
+
+        ServeClient(client_fd);
+        close(client_fd);
+    }
+
+    Stop();
+}
+
+void SolverDaemon::SetRequestLimits (uint32_t timeout_ms_, size_t max_request_size_) {
+    request_timeout_ms = timeout_ms_;
+    max_request_size = max_request_size_;
+}
+
+void SolverDaemon::ServeClient (int client_fd_) {
+    // read newline delimited requests until the client disconnects, clients are served one at a 
+    // time, so a client that stalls (or never sends a newline) is dropped after the timeout 
+    // instead of blocking every other client
+    std::string buffer;
+    char chunk[4096];
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(request_timeout_ms);
+
+    while (!shutdown_requested) {
+        size_t line_end;
+        while ((line_end = buffer.find('\n')) != std::string::npos) {
+            std::string line = buffer.substr(0, line_end);
+            buffer.erase(0, line_end + 1);
+
+            if (line.empty()) 
+                continue;
+
+            json response;
+            try {
+                response = HandleRequest(json::parse(line));
+            }
+            catch (const std::exception& e) {
+                response = {{"ok", false}, {"error", e.what()}};
+            }
+
+            if (!SendResponse(client_fd_, response) || shutdown_requested) 
+                return;
+
+            deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(request_timeout_ms);
+        }
+
+        // the rest of the buffer is one incomplete request, the connection can not be resynced 
+        // once it is dropped
+        if (buffer.size() > max_request_size) {
+            SendResponse(client_fd_, {{"ok", false}, {"error", "request exceeds " + 
+                                      std::to_string(max_request_size) + " bytes"}});
+            return;
+        }
+
+        int64_t remaining_ms = std::chrono::duration_cast<std::chrono::milliseconds>
+            (deadline - std::chrono::steady_clock::now()).count();
+
+        pollfd client = {client_fd_, POLLIN, 0};
+        int num_ready = remaining_ms > 0 ? poll(&client, 1, (int)remaining_ms) : 0;
+        if (num_ready < 0 && errno == EINTR) 
+            continue;
+
+        // an idle client is closed quietly, a client in the middle of a request is told why
+        if (num_ready == 0) {
+            if (!buffer.empty()) 
+                SendResponse(client_fd_, {{"ok", false}, {"error", "request timed out"}});
+            return;
+        }
+
+        if (num_ready < 0) 
+            return;
+
+        ssize_t num_read = read(client_fd_, chunk, sizeof(chunk));
+        if (num_read < 0 && errno == EINTR) 
+            continue;
+        if (num_read <= 0) 
+            return;
+
+        buffer.append(chunk, num_read);
+    }
+}
+
+bool SolverDaemon::SendResponse (int client_fd_, const json& response_) {
+    // a client that disconnected before its response (EPIPE) must not raise SIGPIPE, which 
+    // would end the daemon, its remaining requests are dropped
+    std::string output = response_.dump() + "\n";
+    size_t num_written = 0;
+    while (num_written < output.size()) {
+        ssize_t n = send(client_fd_, output.data() + num_written, 
+                         output.size() - num_written, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        num_written += n;
+    }
+
+    return true;
+}
+
+void SolverDaemon::Stop () {
+    if (socket_fd < 0) 
+        return;
+
+    close(socket_fd);
+    unlink(socket_path.c_str());
+    socket_fd = -1;
+}
+
+json SolverDaemon::HandleRequest (const json& request_) {
+    std::string type = request_.value("type", "");
+
+    if (type == "ping") 
+        return {{"ok", true}};
+
+    if (type == "estimate_pose") 
+        return EstimatePose(request_);
+
+    if (type == "transfer_defects") 
+        return TransferDefects(request_);
+
+    if (type == "shutdown") {
+        shutdown_requested = true;
+        return {{"ok", true}};
+    }
+
+    return {{"ok", false}, {"error", "unknown request type: " + type}};
+}
+
+json SolverDaemon::EstimatePose (const json& request_) {
+    resident_solver* resident = GetSolver(request_);
+    if (resident == nullptr) 
+        return {{"ok", false}, {"error", "failed to load solver"}};
+
+    std::shared_ptr<const PreparedCAD> CAD = GetCAD(request_, resident->solver->GetCloudScale());
+    if (CAD == nullptr) 
+        return {{"ok", false}, {"error", "failed to prepare CAD cloud"}};
+
+    std::vector<point> camera_points;
+    if (!ReadPoints(request_, "camera", 10, &camera_points)) 
+        return {{"ok", false}, {"error", "failed to read camera points"}};
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr camera_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+    image_buffer.populateCloud(&camera_points, camera_cloud, 0);
+
+    SelectCamera(resident, request_);
+
+    // the resident solver still holds the previous solution, so a pose is required
+    if (request_.contains("T_CS")) {
+        Eigen::Matrix4d T_CS;
+        if (!ReadTransform(request_["T_CS"], T_CS)) 
+            return {{"ok", false}, {"error", "T_CS must have 16 values"}};
+        resident->solver->LoadInitialPose(T_CS);
+    }
+    else if (request_.contains("initial_pose")) {
+        resident->solver->LoadInitialPose(request_["initial_pose"].get<std::string>());
+    }
+    else {
+        return {{"ok", false}, {"error", "request must contain \"T_CS\" or \"initial_pose\""}};
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    bool converged = resident->solver->SolveOptimization(CAD, camera_cloud);
+
+    double solve_ms = std::chrono::duration<double, std::milli>
+        (std::chrono::steady_clock::now() - start).count();
+
+    Eigen::Matrix4d T_CS = resident->solver->GetTransform();
+
+    json response;
+    response["ok"] = true;
+    response["converged"] = converged;
+    response["T_CS"] = json::array();
+    for (uint8_t row = 0; row < 4; row++)
+        for (uint8_t col = 0; col < 4; col++)
+            response["T_CS"].push_back(T_CS(row, col));
+    response["initial_pixel_error"] = resident->solver->GetInitialPixelError();
+    response["solution_iterations"] = resident->solver->GetSolutionIterations();
+    response["solve_ms"] = solve_ms;
+
+    return response;
+}
+
+json SolverDaemon::TransferDefects (const json& request_) {
+    resident_solver* resident = GetSolver(request_);
+    if (resident == nullptr) 
+        return {{"ok", false}, {"error", "failed to load solver"}};
+
+    std::shared_ptr<const PreparedCAD> CAD = GetCAD(request_, resident->solver->GetCloudScale());
+    if (CAD == nullptr) 
+        return {{"ok", false}, {"error", "failed to prepare CAD cloud"}};
+
+    Eigen::Matrix4d T_CS;
+    if (!request_.contains("T_CS") || !ReadTransform(request_["T_CS"], T_CS)) 
+        return {{"ok", false}, {"error", "request must contain a 16 value \"T_CS\""}};
+
+    // defect outlines are transferred as labelled, without densifying, a label file 
+    // gives every defect of the image, inline and shared memory points one defect
+    std::vector<LabelledShape> defects_camera, defects_CAD;
+    if (request_.contains("defect_labels")) {
+        if (!image_buffer.readShapes(request_["defect_labels"], &defects_camera)) 
+            return {{"ok", false}, {"error", "failed to read defect labels"}};
+    }
+    else {
+        LabelledShape defect;
+        defect.label = "defect";
+        if (!ReadPoints(request_, "defect", 0, &defect.points)) 
+            return {{"ok", false}, {"error", "failed to read defect points"}};
+        defects_camera.push_back(std::move(defect));
+    }
+
+    SelectCamera(resident, request_);
+
+    // back project onto the structure plane and return all defects to the CAD frame in one pass
+    resident->util->SetCloudOffsetxy(CAD->offset_x, CAD->offset_y);
+    // pixels that miss the structure plane are dropped and counted in the response
+    bool transferred = resident->util->TransferShapes(defects_camera, T_CS, 
+                                                      resident->solver->GetCloudScale(), &defects_CAD);
+
+    if (!transferred && defects_CAD.size() != defects_camera.size()) 
+        return {{"ok", false}, {"error", "failed to transfer defects"}};
+
+    std::vector<point> defect_points_CAD;
+    size_t num_dropped_points = 0;
+    for (size_t i = 0; i < defects_CAD.size(); i++) {
+        defect_points_CAD.insert(defect_points_CAD.end(), defects_CAD[i].points.begin(), 
+                                 defects_CAD[i].points.end());
+        num_dropped_points += defects_camera[i].points.size() - defects_CAD[i].points.size();
+    }
+
+    json response;
+    response["ok"] = true;
+    response["num_points"] = defect_points_CAD.size();
+    response["num_dropped_points"] = num_dropped_points;
+    response["defects"] = json::array();
+
+    bool inline_points = !request_.contains("output_shm");
+
+    if (!inline_points) {
+        if (!WriteShm(request_["output_shm"], &defect_points_CAD)) 
+            return {{"ok", false}, {"error", "failed to write output shared memory"}};
+    }
+
+    for (auto& defect : defects_CAD) {
+        json J = {{"label", defect.label}, {"id", defect.id}, {"num_points", defect.points.size()}};
+        if (inline_points) {
+            J["points"] = json::array();
+            for (auto& p : defect.points) 
+                J["points"].push_back({p.x, p.y});
+        }
+        response["defects"].push_back(J);
+    }
+
+    if (inline_points) {
+        response["points"] = json::array();
+        for (auto& p : defect_points_CAD) 
+            response["points"].push_back({p.x, p.y});
+    }
+
+    return response;
+}
+
+SolverDaemon::resident_solver* SolverDaemon::GetSolver (const json& request_) {
+    if (!request_.contains("config")) 
+        return nullptr;
+
+    std::string config = request_["config"];
+    std::string camera_model = request_.value("camera_model", "");
+    std::string key = config + "|" + camera_model;
+
+    auto existing = solvers.find(key);
+    if (existing != solvers.end()) 
+        return &existing->second;
+
+    std::ifstream config_file(config);
+    if (!config_file.is_open()) {
+        std::cout << "failed to open solution parameters:" << config << std::endl;
+        return nullptr;
+    }
+
+    // solution parameters and camera model are only read the first time they are requested
+    resident_solver resident;
+    resident.util = std::shared_ptr<Util> (new Util);
+    resident.vis = std::shared_ptr<Visualizer> (new Visualizer ("solution visualizer"));
+    resident.solver = std::unique_ptr<Solver> (new Solver (resident.vis, resident.util, config));
+    resident.solver->SetVisualization(false);
+
+    if (!camera_model.empty()) 
+        resident.solver->SetCameraModel(camera_model);
+
+    return &(solvers[key] = std::move(resident));
+}
+
+void SolverDaemon::SelectCamera (resident_solver* resident_, const json& request_) {
+    // the camera of a request does not carry over to the next request of the resident solver, 
+    // both models are held by the registry, so switching only swaps pointers
+    if (request_.contains("camera_id")) 
+        resident_->util->SetCameraID(request_["camera_id"].get<uint8_t>());
+    else 
+        resident_->util->ReadCameraModel(resident_->util->GetCameraModelFile());
+}
+
+std::shared_ptr<const PreparedCAD> SolverDaemon::GetCAD (const json& request_, double scale_) {
+    if (!request_.contains("CAD_labels")) 
+        return nullptr;
+
+    return CAD_cache.Get(request_["CAD_labels"], request_.value("CAD_density", 2), scale_, 
+                         request_.value("CAD_simplify", 0.0f));
+}
+
+bool SolverDaemon::ReadPoints (const json& request_, std::string prefix_, 
+                               uint8_t default_density_, std::vector<point>* points_) {
+    uint8_t density = 0;
+
+    if (request_.contains(prefix_ + "_labels")) {
+        if (!image_buffer.readPoints(request_[prefix_ + "_labels"], points_)) 
+            return false;
+        density = default_density_;
+    }
+    else if (request_.contains(prefix_ + "_points")) {
+        for (auto& p : request_[prefix_ + "_points"]) 
+            points_->push_back(point(p[0], p[1]));
+    }
+    else if (request_.contains(prefix_ + "_shm")) {
+        if (!ReadShm(request_[prefix_ + "_shm"], points_)) 
+            return false;
+    }
+    else {
+        return false;
+    }
+
+    density = request_.value(prefix_ + "_density", density);
+
+    // near-collinear points are removed before densifying, within the given tolerance in pixels
+    image_buffer.simplifyPoints(points_, request_.value(prefix_ + "_simplify", 0.0f));
+
+    if (density > 0 && points_->size() > 1) 
+        image_buffer.densifyPoints(points_, density);
+
+    return !points_->empty();
+}
+
+bool SolverDaemon::ReadShm (const json& shm_, std::vector<point>* points_) {
+    std::string name = shm_["name"];
+    size_t num_points = shm_["num_points"];
+    size_t num_bytes = num_points * 2 * sizeof(float);
+
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        perror("failed to open shared memory");
+        return false;
+    }
+
+    struct stat shm_stat;
+    if (fstat(fd, &shm_stat) < 0 || (size_t)shm_stat.st_size < num_bytes) {
+        std::cout << "shared memory " << name << " is smaller than " << num_points 
+                  << " points" << std::endl;
+        close(fd);
+        return false;
+    }
+
+    // nothing to map, mmap fails on 0 bytes
+    if (num_points == 0) {
+        close(fd);
+        return true;
+    }
+
+    void* data = mmap(nullptr, num_bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        perror("failed to map shared memory");
+        return false;
+    }
+
+    // the points are read straight from the mapping, they never pass through the socket
+    const float* values = static_cast<const float*>(data);
+    points_->reserve(points_->size() + num_points);
+    for (size_t i = 0; i < num_points; i++) 
+        points_->push_back(point(values[2 * i], values[2 * i + 1]));
+
+    munmap(data, num_bytes);
+
+    return true;
+}
+
+bool SolverDaemon::WriteShm (const json& shm_, std::vector<point>* points_) {
+    std::string name = shm_["name"];
+    size_t capacity = shm_["num_points"];
+
+    if (points_->size() > capacity) {
+        std::cout << "output shared memory " << name << " holds " << capacity << " of " 
+                  << points_->size() << " points" << std::endl;
+        return false;
+    }
+
+    size_t num_bytes = points_->size() * 2 * sizeof(float);
+
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        perror("failed to open shared memory");
+        return false;
+    }
+
+    // a segment smaller than the stated capacity would fault (SIGBUS) when written past its end
+    struct stat shm_stat;
+    if (fstat(fd, &shm_stat) < 0 || (size_t)shm_stat.st_size < capacity * 2 * sizeof(float)) {
+        std::cout << "output shared memory " << name << " is smaller than " << capacity 
+                  << " points" << std::endl;
+        close(fd);
+        return false;
+    }
+
+    // an empty transfer writes nothing, mmap fails on 0 bytes
+    if (num_bytes == 0) {
+        close(fd);
+        return true;
+    }
+
+    void* data = mmap(nullptr, num_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        perror("failed to map shared memory");
+        return false;
+    }
+
+    float* values = static_cast<float*>(data);
+    for (size_t i = 0; i < points_->size(); i++) {
+        values[2 * i] = points_->at(i).x;
+        values[2 * i + 1] = points_->at(i).y;
+    }
+
+    munmap(data, num_bytes);
+
+    return true;
+}
+
+bool SolverDaemon::ReadTransform (const json& T_json_, Eigen::Matrix4d& T_) {
+    if (!T_json_.is_array() || T_json_.size() != 16) 
+        return false;
+
+    for (uint8_t row = 0; row < 4; row++)
+        for (uint8_t col = 0; col < 4; col++)
+            T_(row, col) = T_json_[row * 4 + col];
+
+    return true;
+}
+
+} // namespace cam_cad
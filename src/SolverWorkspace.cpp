@@ -0,0 +1,112 @@
+#include "SolverWorkspace.h"
+#include <algorithm>
+
+namespace cam_cad {
+
+SolverWorkspace::SolverWorkspace ()
+    : trans_cloud(new pcl::PointCloud<pcl::PointXYZ>),
+      proj_cloud(new pcl::PointCloud<pcl::PointXYZ>),
+      scratch_proj_cloud(new pcl::PointCloud<pcl::PointXYZ>),
+      corrs(new pcl::Correspondences) {
+    corr_est_target = nullptr;
+    camera_stats_cloud = nullptr;
+    std::fill(capacities, capacities + 4, 0);
+}
+
+void SolverWorkspace::BeginProblem (size_t num_CAD_points_, size_t num_camera_points_) {
+    stats.num_problems++;
+    stats.max_camera_points = std::max(stats.max_camera_points, num_camera_points_);
+
+    Reserve(trans_cloud->points, num_CAD_points_);
+    Reserve(proj_cloud->points, num_CAD_points_);
+    Reserve(scratch_proj_cloud->points, num_CAD_points_);
+    Reserve(*corrs, num_CAD_points_);
+
+    // the camera cloud may have been modified in place since the last problem
+    corr_est_target = nullptr;
+    camera_stats_cloud = nullptr;
+
+    Update();
+}
+
+pcl::PointCloud<pcl::PointXYZ>::Ptr SolverWorkspace::GetTransformedCloud () {
+    return trans_cloud;
+}
+
+pcl::PointCloud<pcl::PointXYZ>::Ptr SolverWorkspace::GetProjectedCloud () {
+    return proj_cloud;
+}
+
+pcl::PointCloud<pcl::PointXYZ>::Ptr SolverWorkspace::GetScratchProjectedCloud () {
+    return scratch_proj_cloud;
+}
+
+pcl::CorrespondencesPtr SolverWorkspace::GetCorrespondences () {
+    return corrs;
+}
+
+pcl::registration::CorrespondenceEstimation<pcl::PointXYZ, pcl::PointXYZ>&
+    SolverWorkspace::GetCorrespondenceEstimation (pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_) {
+
+    if (camera_cloud_.get() != corr_est_target) {
+        corr_est.setInputTarget(camera_cloud_);
+        corr_est_target = camera_cloud_.get();
+    }
+
+    return corr_est;
+}
+
+bool SolverWorkspace::GetCameraStats (pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_, 
+                                      CloudStats& stats_) {
+    if (camera_cloud_.get() != camera_stats_cloud) return false;
+
+    stats_ = camera_stats;
+    return true;
+}
+
+void SolverWorkspace::SetCameraStats (pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_, 
+                                      const CloudStats& stats_) {
+    camera_stats = stats_;
+    camera_stats_cloud = camera_cloud_.get();
+}
+
+void SolverWorkspace::Update () {
+    stats.max_CAD_points = std::max({stats.max_CAD_points, trans_cloud->size(),
+                                     proj_cloud->size(), scratch_proj_cloud->size()});
+    stats.max_correspondences = std::max(stats.max_correspondences, corrs->size());
+
+    Track(trans_cloud->points, capacities[0]);
+    Track(proj_cloud->points, capacities[1]);
+    Track(scratch_proj_cloud->points, capacities[2]);
+    Track(*corrs, capacities[3]);
+
+    stats.reserved_bytes = (capacities[0] + capacities[1] + capacities[2]) *
+                           sizeof(pcl::PointXYZ) + capacities[3] * sizeof(pcl::Correspondence);
+}
+
+WorkspaceStats SolverWorkspace::GetStats () {
+    return stats;
+}
+
+void SolverWorkspace::PrintStats () {
+    printf("workspace: %u problems, %u allocations, %.1f kB reserved \n", stats.num_problems,
+           stats.num_allocations, stats.reserved_bytes / 1024.0);
+    printf("high-water marks: %zu CAD points, %zu camera points, %zu correspondences \n",
+           stats.max_CAD_points, stats.max_camera_points, stats.max_correspondences);
+}
+
+template <typename T>
+void SolverWorkspace::Reserve (T& buffer_, size_t size_) {
+    if (buffer_.capacity() >= size_) return;
+    buffer_.reserve(size_);
+}
+
+template <typename T>
+void SolverWorkspace::Track (T& buffer_, size_t& capacity_) {
+    if (buffer_.capacity() > capacity_) {
+        stats.num_allocations++;
+        capacity_ = buffer_.capacity();
+    }
+}
+
+}
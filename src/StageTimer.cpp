@@ -0,0 +1,176 @@
+#include "StageTimer.h"
+
+#include <fstream>
+#include <iostream>
+#include <stdio.h>
+#include <nlohmann/json.hpp>
+
+namespace cam_cad {
+
+TraceRecorder::TraceRecorder() : enabled(false), next_event(0), max_events(1 << 20), num_dropped(0) {
+    epoch = std::chrono::steady_clock::now();
+}
+
+TraceRecorder& TraceRecorder::GetInstance () {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+void TraceRecorder::Enable (bool enable_) {
+    enabled.store(enable_, std::memory_order_relaxed);
+}
+
+void TraceRecorder::SetMaxEvents (size_t max_events_) {
+    std::lock_guard<std::mutex> lock(mtx);
+    max_events = max_events_;
+    events.clear();
+    events.shrink_to_fit();
+    next_event = 0;
+    num_dropped = 0;
+}
+
+void TraceRecorder::Record (const char* stage_, std::chrono::steady_clock::time_point start_, 
+                            std::chrono::steady_clock::time_point end_) {
+
+    trace_event event;
+    event.stage = stage_;
+    event.start_us = std::chrono::duration_cast<std::chrono::microseconds>(start_ - epoch).count();
+    event.duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end_ - start_).count();
+
+    std::lock_guard<std::mutex> lock(mtx);
+
+    // small sequential thread IDs keep the trace readable
+    auto thread = thread_ids.find(std::this_thread::get_id());
+    if (thread == thread_ids.end()) 
+        thread = thread_ids.emplace(std::this_thread::get_id(), thread_ids.size()).first;
+    event.thread = thread->second;
+
+    StageStats& stage = stage_stats[stage_];
+    double ms = event.duration_us / 1000.0;
+    if (stage.count == 0 || ms < stage.min_ms) stage.min_ms = ms;
+    if (ms > stage.max_ms) stage.max_ms = ms;
+    stage.total_ms += ms;
+    stage.count++;
+
+    if (events.size() < max_events) {
+        events.push_back(event);
+        return;
+    }
+
+    // full, overwrite the oldest stage
+    num_dropped++;
+    if (max_events == 0) return;
+    events[next_event] = event;
+    next_event = (next_event + 1) % max_events;
+}
+
+std::map<std::string, StageStats> TraceRecorder::GetStageStats () {
+    std::map<std::string, StageStats> stats;
+
+    std::lock_guard<std::mutex> lock(mtx);
+
+    // equal names at different addresses (e.g. in two libraries) are one stage
+    for (auto& recorded : stage_stats) {
+        StageStats& stage = stats[recorded.first];
+
+        if (stage.count == 0 || recorded.second.min_ms < stage.min_ms) stage.min_ms = recorded.second.min_ms;
+        if (recorded.second.max_ms > stage.max_ms) stage.max_ms = recorded.second.max_ms;
+        stage.total_ms += recorded.second.total_ms;
+        stage.count += recorded.second.count;
+    }
+
+    for (auto& stage : stats) 
+        stage.second.mean_ms = stage.second.total_ms / stage.second.count;
+
+    return stats;
+}
+
+bool TraceRecorder::WriteTrace (std::string file_name_) {
+    std::ofstream fout(file_name_);
+
+    if (!fout.is_open()) {
+        printf("failed to open trace file: %s\n", file_name_.c_str());
+        return false;
+    }
+
+    nlohmann::json J;
+    J["displayTimeUnit"] = "ms";
+    J["traceEvents"] = nlohmann::json::array();
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        if (num_dropped > 0) 
+            printf("trace holds the last %zu stages, %lu earlier stages were dropped\n", 
+                   events.size(), (unsigned long)num_dropped);
+
+        // complete events: name, phase "X", start and duration in microseconds, oldest first
+        for (size_t i = 0; i < events.size(); i++) {
+            const trace_event& event = events[(next_event + i) % events.size()];
+            J["traceEvents"].push_back({{"name", event.stage},
+                                        {"cat", "cam_cad"},
+                                        {"ph", "X"},
+                                        {"ts", event.start_us},
+                                        {"dur", event.duration_us},
+                                        {"pid", 1},
+                                        {"tid", event.thread}});
+        }
+    }
+
+    fout << J.dump() << std::endl;
+
+    return true;
+}
+
+bool TraceRecorder::WriteStats (std::string file_name_) {
+    std::ofstream fout(file_name_);
+
+    if (!fout.is_open()) {
+        printf("failed to open stats file: %s\n", file_name_.c_str());
+        return false;
+    }
+
+    nlohmann::json J = nlohmann::json::object();
+
+    for (auto& stage : GetStageStats()) {
+        J[stage.first] = {{"count", stage.second.count},
+                          {"total_ms", stage.second.total_ms},
+                          {"min_ms", stage.second.min_ms},
+                          {"max_ms", stage.second.max_ms},
+                          {"mean_ms", stage.second.mean_ms}};
+    }
+
+    fout << J.dump(2) << std::endl;
+
+    return true;
+}
+
+void TraceRecorder::PrintStats () {
+    printf("%-28s %8s %12s %10s %10s %10s\n", "stage", "count", "total ms", "mean ms", "min ms", "max ms");
+
+    for (auto& stage : GetStageStats()) {
+        printf("%-28s %8lu %12.2f %10.3f %10.3f %10.3f\n", stage.first.c_str(), 
+               (unsigned long)stage.second.count, stage.second.total_ms, stage.second.mean_ms, 
+               stage.second.min_ms, stage.second.max_ms);
+    }
+}
+
+void TraceRecorder::Clear () {
+    std::lock_guard<std::mutex> lock(mtx);
+    events.clear();
+    next_event = 0;
+    num_dropped = 0;
+    stage_stats.clear();
+}
+
+size_t TraceRecorder::GetNumEvents () {
+    std::lock_guard<std::mutex> lock(mtx);
+    return events.size();
+}
+
+uint64_t TraceRecorder::GetNumDropped () {
+    std::lock_guard<std::mutex> lock(mtx);
+    return num_dropped;
+}
+
+} // namespace cam_cad
@@ -0,0 +1,428 @@
+#include "TileMapStore.h"
+#include "AnnotationSession.h"
+#include <map>
+#include <set>
+
+using json = nlohmann::json;
+
+namespace cam_cad
+{
+
+    TileMapStore::TileMapStore() 
+    {
+        width = 0;
+        height = 0;
+        rows = 0;
+        cols = 0;
+        tile_size = 0;
+        num_tile_writes = 0;
+        store_open = false;
+        index_changed = false;
+    }
+
+    TileMapStore::~TileMapStore() 
+    {
+        flush();
+    }
+
+    bool TileMapStore::flush()
+    {
+        if (!store_open || !index_changed)
+            return true;
+
+        return writeIndex();
+    }
+
+    bool TileMapStore::create(std::string src_file_name_, std::string store_dir_, 
+                              uint16_t tile_size_)
+    {
+        if (tile_size_ == 0)
+        {
+            std::cout << "tile size must be greater than zero" << std::endl;
+            return false;
+        }
+
+        // the index of a previously opened store is written before switching
+        flush();
+
+        // the full drawing is only decoded here, all later updates work on single tiles
+        cv::Mat image = cv::imread(src_file_name_, 1);
+
+        if (image.empty())
+        {
+            std::cout << "failed to open image:" << src_file_name_ << std::endl;
+            return false;
+        }
+
+        store_dir = store_dir_;
+        source_file = src_file_name_;
+        tile_size = tile_size_;
+        width = image.cols;
+        height = image.rows;
+        cols = (width + tile_size - 1) / tile_size;
+        rows = (height + tile_size - 1) / tile_size;
+        num_tile_writes = 0;
+
+        tiles.assign(rows * cols, tile_info{0, 0});
+
+        for (uint32_t row = 0; row < rows; row++)
+        {
+            for (uint32_t col = 0; col < cols; col++)
+            {
+                cv::Rect roi(col * tile_size, row * tile_size, 
+                             std::min<uint32_t>(tile_size, width - col * tile_size), 
+                             std::min<uint32_t>(tile_size, height - row * tile_size));
+
+                if (!cv::imwrite(tileFileName(row, col), image(roi)))
+                {
+                    std::cout << "failed to write tile:" << tileFileName(row, col) << std::endl;
+                    return false;
+                }
+            }
+        }
+
+        store_open = writeIndex();
+
+        return store_open;
+    }
+
+    bool TileMapStore::open(std::string store_dir_)
+    {
+        std::ifstream input_stream(store_dir_ + "/index.json");
+
+        if (!input_stream.is_open())
+        {
+            std::cout << "failed to open tile index in:" << store_dir_ << std::endl;
+            return false;
+        }
+
+        json J;
+        input_stream >> J;
+
+        flush();
+
+        store_dir = store_dir_;
+        source_file = J["source"];
+        width = J["width"];
+        height = J["height"];
+        tile_size = J["tile_size"];
+        rows = J["rows"];
+        cols = J["cols"];
+        num_tile_writes = 0;
+
+        tiles.assign(rows * cols, tile_info{0, 0});
+
+        for (auto& tile : J["tiles"])
+        {
+            uint32_t row = tile["row"];
+            uint32_t col = tile["col"];
+            tiles.at(row * cols + col).revision = tile["revision"];
+            tiles.at(row * cols + col).num_defects = tile["num_defects"];
+        }
+
+        store_open = true;
+
+        return true;
+    }
+
+    bool TileMapStore::addPoints(std::vector<point> *points_, std::string color_)
+    {
+        if (!store_open)
+            return false;
+
+        cv::Vec3b color = AnnotationSession::getColor(color_);
+
+        // bucket the pixels by tile so each touched tile is read and written once
+        std::map<uint32_t, std::vector<cv::Point>> tile_pixels;
+
+        for (uint32_t i = 0; i < points_->size(); i++)
+        {
+            int u = points_->at(i).x;
+            int v = points_->at(i).y;
+
+            if (u < 0 || v < 0 || u >= (int)width || v >= (int)height)
+                continue;
+
+            uint32_t tile_index = (v / tile_size) * cols + (u / tile_size);
+            tile_pixels[tile_index].push_back(cv::Point(u % tile_size, v % tile_size));
+        }
+
+        for (auto& bucket : tile_pixels)
+        {
+            uint32_t row = bucket.first / cols;
+            uint32_t col = bucket.first % cols;
+
+            cv::Mat tile;
+            if (!readTile(row, col, tile))
+                return false;
+
+            for (auto& pixel : bucket.second)
+                tile.at<cv::Vec3b>(pixel.y, pixel.x) = color;
+
+            tiles.at(bucket.first).num_defects++;
+            index_changed = true;
+
+            if (!writeTile(row, col, tile))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool TileMapStore::addPolyline(std::vector<point> *points_, std::string color_, 
+                                   uint16_t thickness_, bool closed_)
+    {
+        std::vector<cv::Point> pixels;
+        pixels.reserve(points_->size());
+
+        for (uint32_t i = 0; i < points_->size(); i++)
+            pixels.push_back(cv::Point(std::round(points_->at(i).x), 
+                                       std::round(points_->at(i).y)));
+
+        return drawShape(pixels, AnnotationSession::getColor(color_), thickness_, closed_, false);
+    }
+
+    bool TileMapStore::addPolygon(std::vector<point> *points_, std::string color_)
+    {
+        std::vector<cv::Point> pixels;
+        pixels.reserve(points_->size());
+
+        for (uint32_t i = 0; i < points_->size(); i++)
+            pixels.push_back(cv::Point(std::round(points_->at(i).x), 
+                                       std::round(points_->at(i).y)));
+
+        return drawShape(pixels, AnnotationSession::getColor(color_), 1, true, true);
+    }
+
+    bool TileMapStore::renderTile(uint32_t row_, uint32_t col_, cv::Mat& tile_)
+    {
+        if (!store_open || row_ >= rows || col_ >= cols)
+            return false;
+
+        return readTile(row_, col_, tile_);
+    }
+
+    bool TileMapStore::exportRegion(uint32_t x_, uint32_t y_, uint32_t width_, 
+                                    uint32_t height_, std::string target_file_name_)
+    {
+        if (!store_open || x_ >= width || y_ >= height || width_ == 0 || height_ == 0)
+        {
+            std::cout << "export region must be non-empty and start inside the drawing" << std::endl;
+            return false;
+        }
+
+        // clip region to the drawing
+        width_ = std::min(width_, width - x_);
+        height_ = std::min(height_, height - y_);
+
+        cv::Mat region(height_, width_, CV_8UC3);
+
+        uint32_t first_row = y_ / tile_size, last_row = (y_ + height_ - 1) / tile_size;
+        uint32_t first_col = x_ / tile_size, last_col = (x_ + width_ - 1) / tile_size;
+
+        for (uint32_t row = first_row; row <= last_row; row++)
+        {
+            for (uint32_t col = first_col; col <= last_col; col++)
+            {
+                cv::Mat tile;
+                if (!readTile(row, col, tile))
+                    return false;
+
+                // intersection of the tile and the region in drawing coordinates
+                cv::Rect tile_rect(col * tile_size, row * tile_size, tile.cols, tile.rows);
+                cv::Rect region_rect(x_, y_, width_, height_);
+                cv::Rect overlap = tile_rect & region_rect;
+
+                tile(cv::Rect(overlap.x - tile_rect.x, overlap.y - tile_rect.y, 
+                              overlap.width, overlap.height))
+                    .copyTo(region(cv::Rect(overlap.x - x_, overlap.y - y_, 
+                                            overlap.width, overlap.height)));
+            }
+        }
+
+        return cv::imwrite(target_file_name_, region);
+    }
+
+    bool TileMapStore::exportImage(std::string target_file_name_)
+    {
+        return exportRegion(0, 0, width, height, target_file_name_);
+    }
+
+    uint32_t TileMapStore::getNumTileWrites()
+    {
+        return num_tile_writes;
+    }
+
+    uint32_t TileMapStore::getWidth() { return width; }
+
+    uint32_t TileMapStore::getHeight() { return height; }
+
+    uint32_t TileMapStore::getRows() { return rows; }
+
+    uint32_t TileMapStore::getCols() { return cols; }
+
+    bool TileMapStore::drawShape(const std::vector<cv::Point>& pixels_, cv::Vec3b color_, 
+                                 int thickness_, bool closed_, bool filled_)
+    {
+        if (!store_open || pixels_.empty())
+            return false;
+
+        // rasterise the outline and bucket its pixels by tile, a pixel marks every tile within 
+        // the line thickness of it, so only the tiles the shape touches are read and written
+        std::set<uint32_t> touched_tiles;
+        int margin = filled_ ? 0 : thickness_;
+
+        auto mark = [&](const cv::Point& pixel_) {
+            int min_u = std::max(pixel_.x - margin, 0), max_u = std::min(pixel_.x + margin, (int)width - 1);
+            int min_v = std::max(pixel_.y - margin, 0), max_v = std::min(pixel_.y + margin, (int)height - 1);
+            if (min_u > max_u || min_v > max_v)
+                return;
+
+            for (uint32_t row = min_v / tile_size; row <= (uint32_t)max_v / tile_size; row++)
+                for (uint32_t col = min_u / tile_size; col <= (uint32_t)max_u / tile_size; col++)
+                    touched_tiles.insert(row * cols + col);
+        };
+
+        size_t num_segments = (closed_ || filled_) ? pixels_.size() : pixels_.size() - 1;
+        mark(pixels_[0]);
+
+        for (size_t i = 0; i < num_segments; i++)
+        {
+            cv::LineIterator line(pixels_[i], pixels_[(i + 1) % pixels_.size()], 8);
+            for (int j = 0; j < line.count; j++, ++line)
+                mark(line.pos());
+        }
+
+        // a filled shape also covers the tiles inside it that the outline does not cross
+        if (filled_ && pixels_.size() > 2)
+        {
+            cv::Rect bounds = cv::boundingRect(pixels_) & cv::Rect(0, 0, width, height);
+            uint32_t last_row = bounds.area() > 0 ? (bounds.y + bounds.height - 1) / tile_size : 0;
+            uint32_t last_col = bounds.area() > 0 ? (bounds.x + bounds.width - 1) / tile_size : 0;
+
+            for (uint32_t row = bounds.y / tile_size; bounds.area() > 0 && row <= last_row; row++)
+            {
+                for (uint32_t col = bounds.x / tile_size; col <= last_col; col++)
+                {
+                    cv::Point2f center(col * tile_size + tile_size / 2.0f, row * tile_size + tile_size / 2.0f);
+                    if (cv::pointPolygonTest(pixels_, center, false) > 0)
+                        touched_tiles.insert(row * cols + col);
+                }
+            }
+        }
+
+        cv::Scalar color(color_[0], color_[1], color_[2]);
+
+        for (uint32_t tile_index : touched_tiles)
+        {
+            uint32_t row = tile_index / cols;
+            uint32_t col = tile_index % cols;
+
+            cv::Mat tile;
+            if (!readTile(row, col, tile))
+                return false;
+
+            cv::Mat original = tile.clone();
+
+            // shift the shape into tile coordinates, opencv clips to the tile bounds
+            std::vector<std::vector<cv::Point>> shape(1);
+            shape[0].reserve(pixels_.size());
+
+            for (auto& pixel : pixels_)
+                shape[0].push_back(cv::Point(pixel.x - col * tile_size, 
+                                             pixel.y - row * tile_size));
+
+            if (filled_)
+                cv::fillPoly(tile, shape, color, cv::LINE_8);
+            else
+                cv::polylines(tile, shape, closed_, color, thickness_, cv::LINE_8);
+
+            // the thickness margin can mark a neighbouring tile the line does not reach
+            cv::Mat difference;
+            cv::absdiff(tile, original, difference);
+            if (cv::countNonZero(difference.reshape(1)) == 0)
+                continue;
+
+            tiles.at(tile_index).num_defects++;
+            index_changed = true;
+
+            if (!writeTile(row, col, tile))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool TileMapStore::readTile(uint32_t row_, uint32_t col_, cv::Mat& tile_)
+    {
+        tile_ = cv::imread(tileFileName(row_, col_), 1);
+
+        if (tile_.empty())
+        {
+            std::cout << "failed to read tile:" << tileFileName(row_, col_) << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool TileMapStore::writeTile(uint32_t row_, uint32_t col_, const cv::Mat& tile_)
+    {
+        if (!cv::imwrite(tileFileName(row_, col_), tile_))
+        {
+            std::cout << "failed to write tile:" << tileFileName(row_, col_) << std::endl;
+            return false;
+        }
+
+        tiles.at(row_ * cols + col_).revision++;
+        num_tile_writes++;
+
+        return true;
+    }
+
+    bool TileMapStore::writeIndex()
+    {
+        json J;
+        J["source"] = source_file;
+        J["width"] = width;
+        J["height"] = height;
+        J["tile_size"] = tile_size;
+        J["rows"] = rows;
+        J["cols"] = cols;
+        J["tiles"] = json::array();
+
+        for (uint32_t row = 0; row < rows; row++)
+        {
+            for (uint32_t col = 0; col < cols; col++)
+            {
+                const tile_info& info = tiles.at(row * cols + col);
+                J["tiles"].push_back({{"row", row}, 
+                                      {"col", col}, 
+                                      {"file", "tile_" + std::to_string(row) + "_" + 
+                                               std::to_string(col) + ".png"},
+                                      {"revision", info.revision}, 
+                                      {"num_defects", info.num_defects}});
+            }
+        }
+
+        std::ofstream output_stream(store_dir + "/index.json");
+
+        if (!output_stream.is_open())
+        {
+            std::cout << "failed to write tile index in:" << store_dir << std::endl;
+            return false;
+        }
+
+        output_stream << J.dump(2);
+        index_changed = false;
+
+        return true;
+    }
+
+    std::string TileMapStore::tileFileName(uint32_t row_, uint32_t col_)
+    {
+        // tiles are stored losslessly so repeated updates do not degrade the drawing
+        return store_dir + "/tile_" + std::to_string(row_) + "_" + std::to_string(col_) + ".png";
+    }
+
+} // namespace cam_cad
@@ -0,0 +1,212 @@
+#include "VectorWriter.h"
+#include <algorithm>
+
+namespace cam_cad
+{
+
+    // escapes the characters that can not appear in an XML attribute value
+    static std::string escapeXML(const std::string& text_)
+    {
+        std::string escaped;
+        escaped.reserve(text_.size());
+
+        for (char c : text_)
+        {
+            switch (c)
+            {
+                case '&': escaped += "&amp;"; break;
+                case '<': escaped += "&lt;"; break;
+                case '>': escaped += "&gt;"; break;
+                case '"': escaped += "&quot;"; break;
+                case '\'': escaped += "&apos;"; break;
+                default: escaped += c;
+            }
+        }
+
+        return escaped;
+    }
+
+    // replaces the characters DXF does not allow in layer names, line breaks would also end 
+    // the group value early
+    static std::string sanitizeDXFName(const std::string& name_)
+    {
+        std::string sanitized = name_;
+
+        for (char& c : sanitized)
+        {
+            if (std::string("<>/\\\":;?*|=`").find(c) != std::string::npos || (unsigned char)c < 32)
+                c = '_';
+        }
+
+        return sanitized.empty() ? "defects" : sanitized;
+    }
+
+    VectorWriter::VectorWriter() 
+    {
+        width = 0;
+        height = 0;
+        num_defects = 0;
+        first_vertex = true;
+    }
+
+    VectorWriter::~VectorWriter() 
+    {
+        if (output_stream.is_open())
+            close();
+    }
+
+    bool VectorWriter::open(std::string target_file_name_, uint32_t width_, 
+                            uint32_t height_, std::string layer_)
+    {
+        if (output_stream.is_open())
+            close();
+
+        std::string extension = target_file_name_.substr(target_file_name_.find_last_of('.') + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+        if (extension != "svg" && extension != "dxf")
+        {
+            std::cout << "unsupported vector format:" << extension << std::endl;
+            return false;
+        }
+
+        output_stream.open(target_file_name_);
+
+        if (!output_stream.is_open())
+        {
+            std::cout << "failed to open file:" << target_file_name_ << std::endl;
+            return false;
+        }
+
+        format = extension;
+        layer = format == "dxf" ? sanitizeDXFName(layer_) : layer_;
+        width = width_;
+        height = height_;
+        num_defects = 0;
+
+        // float pixel coordinates are written at full precision
+        output_stream.precision(9);
+
+        if (format == "svg")
+        {
+            output_stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                          << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width 
+                          << "\" height=\"" << height << "\" viewBox=\"0 0 " << width << " " 
+                          << height << "\">\n"
+                          << "<g id=\"" << escapeXML(layer) << "\" fill=\"none\">\n";
+        }
+        else
+        {
+            output_stream << "0\nSECTION\n2\nENTITIES\n";
+        }
+
+        return output_stream.good();
+    }
+
+    bool VectorWriter::addPolyline(pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_, 
+                                   bool closed_, std::string color_)
+    {
+        if (!output_stream.is_open())
+            return false;
+
+        beginPolyline(closed_, color_);
+
+        for (size_t i = 0; i < cloud_->size(); i++)
+            addVertex(cloud_->at(i).x, cloud_->at(i).y);
+
+        endPolyline();
+
+        return output_stream.good();
+    }
+
+    bool VectorWriter::addPolyline(std::vector<point> *points_, bool closed_, 
+                                   std::string color_)
+    {
+        if (!output_stream.is_open())
+            return false;
+
+        beginPolyline(closed_, color_);
+
+        for (size_t i = 0; i < points_->size(); i++)
+            addVertex(points_->at(i).x, points_->at(i).y);
+
+        endPolyline();
+
+        return output_stream.good();
+    }
+
+    bool VectorWriter::close()
+    {
+        if (!output_stream.is_open())
+            return false;
+
+        if (format == "svg")
+            output_stream << "</g>\n</svg>\n";
+        else
+            output_stream << "0\nENDSEC\n0\nEOF\n";
+
+        bool write_success = output_stream.good();
+        output_stream.close();
+
+        return write_success;
+    }
+
+    uint32_t VectorWriter::getNumDefects()
+    {
+        return num_defects;
+    }
+
+    void VectorWriter::beginPolyline(bool closed_, std::string color_)
+    {
+        first_vertex = true;
+
+        if (format == "svg")
+        {
+            if (color_ != "black" && color_ != "green" && color_ != "blue")
+                color_ = "red";
+
+            output_stream << (closed_ ? "<polygon" : "<polyline") << " stroke=\"" 
+                          << color_ << "\" points=\"";
+        }
+        else
+        {
+            // ACI color numbers
+            int color = 1;
+            if (color_ == "black") color = 7;
+            if (color_ == "green") color = 3;
+            if (color_ == "blue") color = 5;
+
+            // the header point (10/20/30) is a dummy, but strict readers require it
+            output_stream << "0\nPOLYLINE\n8\n" << layer << "\n62\n" << color 
+                          << "\n66\n1\n10\n0\n20\n0\n30\n0\n70\n" << (closed_ ? 1 : 0) << "\n";
+        }
+    }
+
+    void VectorWriter::addVertex(float x_, float y_)
+    {
+        if (format == "svg")
+        {
+            if (!first_vertex)
+                output_stream << " ";
+            output_stream << x_ << "," << y_;
+        }
+        else
+        {
+            output_stream << "0\nVERTEX\n8\n" << layer << "\n10\n" << x_ 
+                          << "\n20\n" << (float)height - y_ << "\n30\n0\n";
+        }
+
+        first_vertex = false;
+    }
+
+    void VectorWriter::endPolyline()
+    {
+        if (format == "svg")
+            output_stream << "\"/>\n";
+        else
+            output_stream << "0\nSEQEND\n8\n" << layer << "\n";
+
+        num_defects++;
+    }
+
+} // namespace cam_cad
@@ -1,21 +1,125 @@
 #include <stdio.h>
 #include <cstdint>
 #include <iostream>
-#include "ImageBuffer.h"
-#include "visualizer.h"
-#include "Solver.h"
-#include "util.h"
-#include <X11/Xlib.h> 
-#include <Eigen/Dense>
-#include <Eigen/Geometry>
+#include <cstdlib>
+#include <string>
+#include "BatchRunner.h"
+#include "SolverDaemon.h"
+#include "StageTimer.h"
 
+/**
+ * @brief Batch pose estimation and defect transfer for all jobs of a manifest
+ * usage: beam_2DCAD_projection <manifest.json> [-j workers] [-o results.json] [-t trace.json]
+ * see BatchRunner.h and config/example_manifest.json for the manifest format
+ * 
+ * or run as a solver daemon answering requests on a unix domain socket: 
+ * usage: beam_2DCAD_projection --daemon <socket path> [-t trace.json]
+ * see SolverDaemon.h for the request format
+ * 
+ * -t records the time spent in each stage (correspondence estimation, transform/project, problem 
+ * build, ceres solve, convergence check, back projection, image I/O) and writes it as a Chrome 
+ * trace on exit, the per-stage statistics are printed and written next to it (<trace>.stats.json)
+ */
 
-int main () {
+/**
+ * @brief writes the trace and per-stage statistics if stage timing was enabled
+ */
+bool writeTrace (std::string trace_file_) {
+    if (trace_file_.empty()) return true;
 
-    return 0;
+    cam_cad::TraceRecorder& recorder = cam_cad::TraceRecorder::GetInstance();
+
+    recorder.PrintStats();
+
+    return recorder.WriteTrace(trace_file_) && recorder.WriteStats(trace_file_ + ".stats.json");
 }
 
+int main (int argc, char** argv) {
+
+    if (argc < 2) {
+        printf("usage: %s <manifest.json> [-j workers] [-o results.json] [-t trace.json]\n", argv[0]);
+        printf("       %s --daemon <socket path> [-t trace.json]\n", argv[0]);
+        return 1;
+    }
+
+    if (std::string(argv[1]) == "--daemon") {
+        if (argc < 3) {
+            printf("usage: %s --daemon <socket path> [-t trace.json]\n", argv[0]);
+            return 1;
+        }
+
+        std::string trace_file = "";
+        if (argc > 4 && std::string(argv[3]) == "-t") trace_file = argv[4];
+
+        cam_cad::TraceRecorder::GetInstance().Enable(!trace_file.empty());
+
+        cam_cad::SolverDaemon daemon;
+
+        if (!daemon.Start(argv[2])) return 1;
+
+        daemon.Serve();
+
+        return writeTrace(trace_file) ? 0 : 1;
+    }
+
+    std::string manifest_file = argv[1];
+    std::string results_file = "";
+    std::string trace_file = "";
+    int num_workers = -1;
 
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            char* end = nullptr;
+            long workers = std::strtol(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0' || workers < 0 || workers > UINT16_MAX) {
+                printf("invalid number of workers: %s\n", argv[i]);
+                return 1;
+            }
+            num_workers = int(workers);
+        }
+        else if (arg == "-o" && i + 1 < argc) results_file = argv[++i];
+        else if (arg == "-t" && i + 1 < argc) trace_file = argv[++i];
+        else {
+            printf("unknown argument: %s\n", arg.c_str());
+            return 1;
+        }
+    }
 
+    cam_cad::TraceRecorder::GetInstance().Enable(!trace_file.empty());
 
+    cam_cad::BatchRunner runner;
 
+    if (!runner.ReadManifest(manifest_file)) return 1;
+
+    if (num_workers >= 0) runner.SetNumWorkers(num_workers);
+
+    bool all_succeeded = runner.Run();
+
+    uint32_t num_converged = 0;
+    for (auto& result : runner.GetResults()) {
+        if (result.converged) num_converged++;
+        if (!result.success) 
+            printf("job %s failed: %s\n", result.id.c_str(), result.error.c_str());
+    }
+
+    printf("%u of %zu jobs converged \n", num_converged, runner.GetResults().size());
+
+    uint32_t num_cached = 0;
+    for (auto& result : runner.GetResults()) 
+        if (result.cached) num_cached++;
+    if (num_cached > 0) 
+        printf("%u jobs looked up in the solution cache \n", num_cached);
+
+    for (auto& joint : runner.GetJointResults()) {
+        printf("joint refinement of %u images of %s: CAD scale %f, pixel error %f -> %f \n", 
+               joint.num_images, joint.CAD_labels.c_str(), joint.cloud_scale, 
+               joint.initial_pixel_error, joint.final_pixel_error);
+    }
+
+    if (!runner.WriteResults(results_file)) return 1;
+
+    if (!writeTrace(trace_file)) return 1;
+
+    return all_succeeded ? 0 : 1;
+}
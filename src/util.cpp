@@ -4,6 +4,8 @@ namespace cam_cad {
 
 Util::Util() {
     center_image_called_ = false;
+    float_precision_ = false;
+    float_projector_tried_ = nullptr;
 }
 
 void Util::getCorrespondences(pcl::CorrespondencesPtr corrs_, 
@@ -24,36 +26,50 @@ void Util::CorrEst (pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_,
                         pcl::CorrespondencesPtr corrs_, 
                         std::string offset_type_) {
 
-    pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud (new pcl::PointCloud<pcl::PointXYZ>); 
-    pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+    SolverWorkspace workspace;
+    workspace.BeginProblem(CAD_cloud_->size(), camera_cloud_->size());
+
+    CorrEst(CAD_cloud_, camera_cloud_, T_, corrs_, offset_type_, workspace);
+
+}
+
+void Util::CorrEst (pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_,
+                        pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_,
+                        Eigen::Matrix4d &T_,
+                        pcl::CorrespondencesPtr corrs_, 
+                        std::string offset_type_, 
+                        SolverWorkspace& workspace_, 
+                        pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud_) {
 
-    // transform the CAD cloud points to the camera frame
-    trans_cloud = this->TransformCloud(CAD_cloud_,T_);
+    StageTimer timer("correspondence_estimation");
 
-    // project the transformed points to the camera plane
-    proj_cloud = this->ProjectCloud(trans_cloud);
+    pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud = workspace_.GetProjectedCloud(); 
 
-    // merge centroids for correspondence estimation (projected -> camera)
-    pcl::PointXYZ camera_centroid = Util::GetCloudCentroid(camera_cloud_);
-    pcl::PointXYZ proj_centroid = Util::GetCloudCentroid(proj_cloud);
+    // transform the CAD cloud points to the camera frame, project them to the camera plane 
+    // and compute the centroid and center of the projection in one pass
+    CloudStats proj_stats;
+    this->TransformProjectCloud(CAD_cloud_, T_, proj_cloud, proj_stats, trans_cloud_);
 
-    // merge centers for correspondence estimation (projected -> camera)
-    pcl::PointXYZ camera_center = Util::GetCloudCenter(camera_cloud_);
-    pcl::PointXYZ proj_center = Util::GetCloudCenter(proj_cloud);
+    // the camera cloud statistics only change with the camera cloud
+    CloudStats camera_stats;
+    if (!workspace_.GetCameraStats(camera_cloud_, camera_stats)) {
+        camera_stats = Util::GetCloudStats(camera_cloud_);
+        workspace_.SetCameraStats(camera_cloud_, camera_stats);
+    }
 
     Eigen::Vector3d offset; 
     
     // offset using centroid
     if (offset_type_ == "centroid") {
-        offset(0) = camera_centroid.x - proj_centroid.x;
-        offset(1) = camera_centroid.y - proj_centroid.y;
-        offset(2) = camera_centroid.z - proj_centroid.z;
+        offset(0) = camera_stats.centroid.x - proj_stats.centroid.x;
+        offset(1) = camera_stats.centroid.y - proj_stats.centroid.y;
+        offset(2) = camera_stats.centroid.z - proj_stats.centroid.z;
     }
     // offset using center 
     else if (offset_type_ == "center") {
-        offset(0) = camera_center.x - proj_center.x;
-        offset(1) = camera_center.y - proj_center.y;
-        offset(2) = camera_center.z - proj_center.z;
+        offset(0) = camera_stats.center.x - proj_stats.center.x;
+        offset(1) = camera_stats.center.y - proj_stats.center.y;
+        offset(2) = camera_stats.center.z - proj_stats.center.z;
     }
     else { 
         offset(0) = 0;
@@ -61,11 +77,106 @@ void Util::CorrEst (pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_,
         offset(2) = 0;
     }
 
+    // merge centers for correspondence estimation (projected -> camera), the offset projection is 
+    // matched from a scratch cloud so the projection itself stays available to the caller
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr match_cloud = proj_cloud;
 
-    Util::OffsetCloud(proj_cloud, offset);
+    if (!offset.isZero()) {
+        pcl::PointCloud<pcl::PointXYZ>::Ptr offset_cloud = workspace_.GetScratchProjectedCloud();
+        offset_cloud->clear();
+        offset_cloud->reserve(proj_cloud->size());
 
-    // get correspondences
-    this->getCorrespondences(corrs_, proj_cloud, camera_cloud_, 1000);
+        for (size_t i = 0; i < proj_cloud->size(); i++) {
+            const pcl::PointXYZ& p = proj_cloud->points[i];
+            offset_cloud->push_back(pcl::PointXYZ(p.x + offset(0), p.y + offset(1), p.z + offset(2)));
+        }
+
+        match_cloud = offset_cloud;
+    }
+
+    // get correspondences, the search tree over the camera cloud is kept by the workspace
+    pcl::registration::CorrespondenceEstimation<pcl::PointXYZ, pcl::PointXYZ>& corr_est = 
+        workspace_.GetCorrespondenceEstimation(camera_cloud_);
+    corr_est.setInputSource(match_cloud);
+    corr_est.determineCorrespondences(*corrs_, 1000);
+
+}
+
+void Util::TransformProjectCloud (pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_, Eigen::Matrix4d &T_, 
+                                  pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud_, CloudStats& stats_,
+                                  pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud_) {
+
+    StageTimer timer("transform_project");
+
+    if (UsesFloatProjection()) {
+        TransformProjectPoints<float>(cloud_, T_, proj_cloud_, stats_, trans_cloud_, 
+            [this](const Eigen::Vector3f& point_, Eigen::Vector2f& pixel_) {
+                return float_projector.Project(point_, pixel_);
+            });
+        return;
+    }
+
+    TransformProjectPoints<double>(cloud_, T_, proj_cloud_, stats_, trans_cloud_, 
+        [this](const Eigen::Vector3d& point_, Eigen::Vector2d& pixel_) {
+            std::optional<Eigen::Vector2d> pixel_projected = camera_model->ProjectPointPrecise(point_);
+            if (!pixel_projected.has_value()) return false;
+            pixel_ = pixel_projected.value();
+            return true;
+        });
+
+}
+
+template <typename Scalar, typename Project>
+void Util::TransformProjectPoints (pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_, Eigen::Matrix4d &T_, 
+                                   pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud_, CloudStats& stats_,
+                                   pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud_, Project project_) {
+
+    proj_cloud_->clear();
+    proj_cloud_->reserve(cloud_->size());
+
+    if (trans_cloud_ != nullptr) {
+        trans_cloud_->clear();
+        trans_cloud_->reserve(cloud_->size());
+    }
+
+    Eigen::Matrix<Scalar, 3, 3> R = T_.block<3, 3>(0, 0).cast<Scalar>();
+    Eigen::Matrix<Scalar, 3, 1> t = T_.block<3, 1>(0, 3).cast<Scalar>();
+    Eigen::Matrix<Scalar, 2, 1> pixel;
+
+    // the sums over up to millions of pixels stay in double in both precisions
+    double sum_x = 0, sum_y = 0;
+    float max_x = -FLT_MAX, max_y = -FLT_MAX, min_x = FLT_MAX, min_y = FLT_MAX;
+
+    for (size_t i = 0; i < cloud_->size(); i++) {
+        const pcl::PointXYZ& p = cloud_->points[i];
+        Eigen::Matrix<Scalar, 3, 1> point_transformed = R * Eigen::Matrix<Scalar, 3, 1>(p.x, p.y, p.z) + t;
+
+        if (trans_cloud_ != nullptr) 
+            trans_cloud_->push_back(pcl::PointXYZ(point_transformed(0), 
+                point_transformed(1), point_transformed(2)));
+
+        if (!project_(point_transformed, pixel)) continue;
+
+        pcl::PointXYZ proj_point (pixel(0), pixel(1), 0);
+        proj_cloud_->push_back(proj_point);
+
+        sum_x += proj_point.x;
+        sum_y += proj_point.y;
+        if (proj_point.x > max_x) max_x = proj_point.x; 
+        if (proj_point.y > max_y) max_y = proj_point.y; 
+        if (proj_point.x < min_x) min_x = proj_point.x; 
+        if (proj_point.y < min_y) min_y = proj_point.y;
+    }
+
+    if (proj_cloud_->empty()) {
+        stats_.centroid = pcl::PointXYZ(0, 0, 0);
+        stats_.center = pcl::PointXYZ(0, 0, 0);
+        return;
+    }
+
+    size_t num_points = proj_cloud_->size();
+    stats_.centroid = pcl::PointXYZ(sum_x / num_points, sum_y / num_points, 0);
+    stats_.center = pcl::PointXYZ(min_x + (max_x-min_x)/2, min_y + (max_y-min_y)/2, 0);
 
 }
 
@@ -74,22 +185,45 @@ pcl::PointCloud<pcl::PointXYZ>::Ptr Util::TransformCloud (
 
     pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud (new pcl::PointCloud<pcl::PointXYZ>);
     
-    for(uint16_t i=0; i < cloud_->size(); i++) {
+    TransformCloud(cloud_, T_, trans_cloud);
+
+    return trans_cloud;
+
+}
+
+void Util::TransformCloud (pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_, Eigen::Matrix4d &T_, 
+                           pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud_) {
+
+    // clear keeps the capacity, so a sized cloud is filled without allocating
+    trans_cloud_->clear();
+    trans_cloud_->reserve(cloud_->size());
+
+    if (float_precision_) {
+        Eigen::Matrix3f R = T_.block<3, 3>(0, 0).cast<float>();
+        Eigen::Vector3f t = T_.block<3, 1>(0, 3).cast<float>();
+
+        for (const pcl::PointXYZ& p : cloud_->points) {
+            Eigen::Vector3f point_transformed = R * Eigen::Vector3f(p.x, p.y, p.z) + t;
+            trans_cloud_->push_back(pcl::PointXYZ(point_transformed(0), 
+                point_transformed(1), point_transformed(2)));
+        }
+        return;
+    }
+
+    for(size_t i=0; i < cloud_->size(); i++) {
         Eigen::Vector4d point (cloud_->at(i).x, cloud_->at(i).y, cloud_->at(i).z, 1);
         Eigen::Vector4d point_transformed = T_*point; 
         pcl::PointXYZ pcl_point_transformed (point_transformed(0), 
             point_transformed(1), point_transformed(2));
-        trans_cloud->push_back(pcl_point_transformed);
+        trans_cloud_->push_back(pcl_point_transformed);
     }
 
-    return trans_cloud;
-
 }
 
 void Util::TransformCloudUpdate (pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_, 
                                  Eigen::Matrix4d &T_) {
     
-    for(uint16_t i=0; i < cloud_->size(); i++) {
+    for(size_t i=0; i < cloud_->size(); i++) {
         Eigen::Vector4d point (cloud_->at(i).x, cloud_->at(i).y, 
             cloud_->at(i).z, 1);
         Eigen::Vector4d point_transformed = T_*point; 
@@ -105,20 +239,40 @@ pcl::PointCloud<pcl::PointXYZ>::Ptr Util::ProjectCloud
 
     pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud (new pcl::PointCloud<pcl::PointXYZ>);
     
-    for(uint16_t i=0; i < cloud_->size(); i++) {
+    ProjectCloud(cloud_, proj_cloud);
+
+    return proj_cloud;
+
+}
+
+void Util::ProjectCloud (pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_, 
+                         pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud_) {
+
+    // clear keeps the capacity, so a sized cloud is filled without allocating
+    proj_cloud_->clear();
+    proj_cloud_->reserve(cloud_->size());
+
+    if (UsesFloatProjection()) {
+        Eigen::Vector2f pixel;
+        for (const pcl::PointXYZ& p : cloud_->points) {
+            if (float_projector.Project(Eigen::Vector3f(p.x, p.y, p.z), pixel)) 
+                proj_cloud_->push_back(pcl::PointXYZ(pixel(0), pixel(1), 0));
+        }
+        return;
+    }
+
+    for(size_t i=0; i < cloud_->size(); i++) {
         Eigen::Vector3d point (cloud_->at(i).x, cloud_->at(i).y, cloud_->at(i).z);
         std::optional<Eigen::Vector2d> pixel_projected;
         pixel_projected = camera_model->ProjectPointPrecise(point);
         if (pixel_projected.has_value()) {
             pcl::PointXYZ proj_point (pixel_projected.value()(0), 
                 pixel_projected.value()(1), 0);
-            proj_cloud->push_back(proj_point);
+            proj_cloud_->push_back(proj_point);
         }
         
     }
 
-    return proj_cloud;
-
 }
 
 Eigen::Matrix4d Util::QuaternionAndTranslationToTransformMatrix
@@ -140,19 +294,41 @@ std::vector<double> Util::TransformMatrixToQuaternionAndTranslation
   Eigen::Quaternion<double> q = Eigen::Quaternion<double>(R);
   std::vector<double> pose{q.w(),   q.x(),   q.y(),  q.z(),
                            T_(0, 3), T_(1, 3), T_(2, 3)};
+  return pose;
 }
 
 std::shared_ptr<beam_calibration::CameraModel> Util::GetCameraModel () {
     return camera_model;
 }
 
+std::string Util::GetCameraModelFile () {
+    return camera_model_file_;
+}
+
 void Util::ReadCameraModel (std::string intrinsics_file_path_) {
-    camera_model = beam_calibration::CameraModel::Create(intrinsics_file_path_); 
+    camera_model_file_ = intrinsics_file_path_;
+    camera_model = CameraModelRegistry::GetInstance().Get(intrinsics_file_path_); 
 }
 
 void Util::SetCameraID (uint8_t cam_ID_){
-    camera_model->SetCameraID(cam_ID_);
-    
+    // shared models are read-only, select the registry's copy of this camera instead
+    camera_model = CameraModelRegistry::GetInstance().Get(camera_model_file_, cam_ID_);
+}
+
+void Util::SetFloatPrecision (bool enable_) {
+    float_precision_ = enable_;
+}
+
+bool Util::UsesFloatProjection () {
+    if (!float_precision_ || camera_model == nullptr) return false;
+
+    if (float_projector.IsValidFor(camera_model.get())) return true;
+
+    // the projector is validated once per camera model (models change with SetCameraID)
+    if (float_projector_tried_ == camera_model.get()) return false;
+    float_projector_tried_ = camera_model.get();
+
+    return float_projector.Init(camera_model, camera_model_file_);
 }
 
 Eigen::Matrix4d Util::PerturbTransformRadM(const Eigen::Matrix4d& T_in_,
@@ -190,11 +366,11 @@ Eigen::MatrixXd Util::RoundMatrix(const Eigen::MatrixXd& M_, const int& precisio
 
 void Util::originCloudxy (pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_) {
     
-    uint16_t num_points = cloud_->size();
+    size_t num_points = cloud_->size();
 
     // determine central x and y values
-    float max_x = 0, max_y = 0, min_x = 2048, min_y = 2048;
-    for (uint16_t point_index = 0; point_index < num_points; point_index ++) {
+    float max_x = -FLT_MAX, max_y = -FLT_MAX, min_x = FLT_MAX, min_y = FLT_MAX;
+    for (size_t point_index = 0; point_index < num_points; point_index ++) {
         if (cloud_->at(point_index).x > max_x) max_x = cloud_->at(point_index).x; 
         if (cloud_->at(point_index).y > max_y) max_y = cloud_->at(point_index).y; 
 
@@ -209,7 +385,7 @@ void Util::originCloudxy (pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_) {
     image_offset_y_ = center_y;
 
     // shift all points back to center on origin
-    for (uint16_t point_index = 0; point_index < num_points; point_index ++) {
+    for (size_t point_index = 0; point_index < num_points; point_index ++) {
         cloud_->at(point_index).x -= (int)center_x;
         cloud_->at(point_index).y -= (int)center_y;
     }
@@ -225,30 +401,42 @@ void Util::OffsetCloudxy (pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_) {
     }
 
     // restore offset to all points 
-    for (uint16_t point_index = 0; point_index < cloud_->size(); point_index ++) {
+    for (size_t point_index = 0; point_index < cloud_->size(); point_index ++) {
         cloud_->at(point_index).x += (int)image_offset_x_;
         cloud_->at(point_index).y += (int)image_offset_y_;
     }
 
 }
 
+bool Util::GetCloudOffsetxy (double& offset_x_, double& offset_y_) {
+    offset_x_ = image_offset_x_;
+    offset_y_ = image_offset_y_;
+    return center_image_called_;
+}
+
+void Util::SetCloudOffsetxy (double offset_x_, double offset_y_) {
+    image_offset_x_ = offset_x_;
+    image_offset_y_ = offset_y_;
+    center_image_called_ = true;
+}
+
 void Util::rotateCCWxy(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_) {
     // determine max x,y values
     uint32_t max_x = 0, max_y = 0;
-    for (uint16_t point_index = 0; point_index < cloud_->size(); point_index ++) {
+    for (size_t point_index = 0; point_index < cloud_->size(); point_index ++) {
         if (cloud_->at(point_index).x > max_x) max_x = cloud_->at(point_index).x;
         if (cloud_->at(point_index).y > max_y) max_y = cloud_->at(point_index).y;
     }
 
     uint32_t min_x = 100000, min_y = 100000;
-    for (uint16_t point_index = 0; point_index < cloud_->size(); point_index ++) {
+    for (size_t point_index = 0; point_index < cloud_->size(); point_index ++) {
         if (cloud_->at(point_index).x < min_x) min_x = cloud_->at(point_index).x;
         if (cloud_->at(point_index).y < min_y) min_y = cloud_->at(point_index).y;
     }
     
-    for (uint16_t index = 0; index < cloud_->size(); index ++) {
+    for (size_t index = 0; index < cloud_->size(); index ++) {
         cloud_->at(index).x = max_x - cloud_->at(index).x + min_x;
-        uint16_t x_tmp = cloud_->at(index).x;
+        float x_tmp = cloud_->at(index).x;
         cloud_->at(index).x = cloud_->at(index).y;
         cloud_->at(index).y = x_tmp; 
     }
@@ -261,7 +449,7 @@ void Util::GetCloudScale(pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_,
     // get max cloud dimensions in x and y
     float max_x = 0, max_y = 0;
     float min_x = cloud_->at(0).x, min_y = cloud_->at(0).y;
-    for(uint16_t point_index = 0; point_index < cloud_->size(); point_index++) {
+    for(size_t point_index = 0; point_index < cloud_->size(); point_index++) {
         if (cloud_->at(point_index).x > max_x) max_x = cloud_->at(point_index).x;
         if (cloud_->at(point_index).y > max_y) max_y = cloud_->at(point_index).y;
         if (cloud_->at(point_index).x < min_x) min_x = cloud_->at(point_index).x;
@@ -275,7 +463,7 @@ void Util::GetCloudScale(pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_,
 }
 
 void Util::ScaleCloud (pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_, float scale_) {
-    for (uint16_t i = 0; i < cloud_->size(); i++) {
+    for (size_t i = 0; i < cloud_->size(); i++) {
         cloud_->at(i).x *= scale_;
         cloud_->at(i).y *= scale_;
         cloud_->at(i).z *= scale_;
@@ -287,7 +475,7 @@ pcl::PointCloud<pcl::PointXYZ>::Ptr Util::ScaleCloud
 
     pcl::PointCloud<pcl::PointXYZ>::Ptr scaled_cloud (new pcl::PointCloud<pcl::PointXYZ>);
 
-    for (uint16_t i = 0; i < cloud_->size(); i++) {
+    for (size_t i = 0; i < cloud_->size(); i++) {
         pcl::PointXYZ to_add;
         to_add.x = cloud_->at(i).x * scale_;
         to_add.y = cloud_->at(i).y * scale_;
@@ -301,7 +489,7 @@ pcl::PointCloud<pcl::PointXYZ>::Ptr Util::ScaleCloud
 
 void Util::ScaleCloud (pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_, 
                         float x_scale_, float y_scale_) {
-    for (uint16_t i = 0; i < cloud_->size(); i++) {
+    for (size_t i = 0; i < cloud_->size(); i++) {
         cloud_->at(i).x *= x_scale_;
         cloud_->at(i).y *= y_scale_;
     }
@@ -436,42 +624,139 @@ pcl::ModelCoefficients::Ptr Util::GetCloudPlane
 
 }
 
+pcl::ModelCoefficients::Ptr Util::GetStructurePlane (Eigen::Matrix4d &T_) {
+
+    pcl::ModelCoefficients::Ptr coefficients (new pcl::ModelCoefficients);
+
+    // the structure z axis is the plane normal and the structure origin lies on the plane
+    Eigen::Vector3d normal = T_.block(0, 2, 3, 1);
+    Eigen::Vector3d origin = T_.block(0, 3, 3, 1);
+
+    coefficients->values.resize(4);
+    coefficients->values[0] = normal[0];
+    coefficients->values[1] = normal[1];
+    coefficients->values[2] = normal[2];
+    coefficients->values[3] = -normal.dot(origin);
+
+    return coefficients;
+
+}
+
 pcl::PointCloud<pcl::PointXYZ>::Ptr Util::BackProject
     (pcl::PointCloud<pcl::PointXYZ>::ConstPtr image_cloud_, 
      pcl::PointCloud<pcl::PointXYZ>::ConstPtr cad_cloud_, 
      pcl::ModelCoefficients::ConstPtr target_plane_) {
 
-    pcl::PointCloud<pcl::PointXYZ>::Ptr back_projected_cloud 
-        (new pcl::PointCloud<pcl::PointXYZ>);
-
     // get cad surface normal and point on the cad plane
     Eigen::Vector3d cad_normal (target_plane_->values[0], 
         target_plane_->values[1], target_plane_->values[2]);
     Eigen::Vector3d cad_point (cad_cloud_->at(0).x, 
         cad_cloud_->at(0).y, cad_cloud_->at(0).z);
 
-
     printf ("BACK PROJECT: got plane normal and point \n");
 
-    for (uint32_t i = 0; i < image_cloud_->size(); i++) {
-        Eigen::Vector3d image_point (0,0,0);
-        Eigen::Vector2i image_pixel (image_cloud_->at(i).x, image_cloud_->at(i).y);
-        Eigen::Vector3d ray_unit_vector = camera_model->
-            BackProject(image_pixel).value().normalized();
-        double prod1 = (image_point - cad_point).dot(cad_normal);
+    return BackProjectToPlane(image_cloud_, cad_normal, cad_point);
+
+}
+
+pcl::PointCloud<pcl::PointXYZ>::Ptr Util::BackProject
+    (pcl::PointCloud<pcl::PointXYZ>::ConstPtr image_cloud_, Eigen::Matrix4d &T_) {
+
+    // structure z axis and origin in the camera frame
+    Eigen::Vector3d cad_normal = T_.block(0, 2, 3, 1);
+    Eigen::Vector3d cad_point = T_.block(0, 3, 3, 1);
 
-        double len = prod1 / (ray_unit_vector.dot(cad_normal));
+    return BackProjectToPlane(image_cloud_, cad_normal, cad_point);
 
-        Eigen::Vector3d back_projected_point = image_point - ray_unit_vector * len;
+}
 
-        pcl::PointXYZ back_projected_cloud_point (back_projected_point[0], 
-            back_projected_point[1], back_projected_point[2]);
+bool Util::TransferShapes(const std::vector<LabelledShape>& shapes_camera_, Eigen::Matrix4d &T_, 
+                          double cloud_scale_, std::vector<LabelledShape>* shapes_CAD_) {
 
-        back_projected_cloud->push_back(back_projected_cloud_point);
+    StageTimer timer("defect_transfer");
 
+    if (!center_image_called_) {
+        printf("FAILED to transfer shapes - originCloudxy not previously called by this utility\n");
+        return false;
     }
 
-    return back_projected_cloud;
+    size_t num_points = 0;
+    for (auto& shape : shapes_camera_) num_points += shape.points.size();
+
+    // unit rays of every pixel of every shape, in shape order, pixels that can not be 
+    // back projected are dropped and counted per shape
+    Eigen::Matrix3Xd rays(3, num_points);
+    std::vector<size_t> shape_sizes;
+    shape_sizes.reserve(shapes_camera_.size());
+    size_t num_rays = 0;
+
+    for (auto& shape : shapes_camera_) {
+        size_t shape_start = num_rays;
+        for (auto& p : shape.points) {
+            std::optional<Eigen::Vector3d> ray = 
+                camera_model->BackProject(Eigen::Vector2i(p.x, p.y));
+            if (!ray.has_value()) continue;
+            rays.col(num_rays++) = ray.value().normalized();
+        }
+        shape_sizes.push_back(num_rays - shape_start);
+    }
+
+    // structure z axis and origin in the camera frame, the rays start at the camera origin
+    Eigen::Vector3d plane_normal = T_.block(0, 2, 3, 1);
+    Eigen::Vector3d plane_point = T_.block(0, 3, 3, 1);
+    double plane_distance = plane_point.dot(plane_normal);
+
+    Eigen::RowVectorXd lengths = plane_distance / 
+        (plane_normal.transpose() * rays.leftCols(num_rays)).array();
+
+    // rays parallel to the plane (infinite length) or pointing away from it (length <= 0) never 
+    // reach the structure, their pixels are dropped like pixels without a ray
+    size_t num_valid = 0, ray_index = 0;
+    for (auto& shape_size : shape_sizes) {
+        size_t shape_valid = 0;
+        for (size_t i = 0; i < shape_size; i++, ray_index++) {
+            if (!std::isfinite(lengths[ray_index]) || lengths[ray_index] <= 0) continue;
+            rays.col(num_valid) = rays.col(ray_index);
+            lengths[num_valid++] = lengths[ray_index];
+            shape_valid++;
+        }
+        shape_size = shape_valid;
+    }
+    num_rays = num_valid;
+
+    // camera frame -> CAD pixels in one affine transform
+    Eigen::Matrix4d T_SC = T_.inverse();
+    Eigen::Matrix<double, 2, 3> A = T_SC.block(0, 0, 2, 3) / cloud_scale_;
+    Eigen::Vector2d b = T_SC.block(0, 3, 2, 1) / cloud_scale_;
+    b[0] += (int)image_offset_x_;
+    b[1] += (int)image_offset_y_;
+
+    Eigen::Matrix2Xd CAD_points = 
+        (A * (rays.leftCols(num_rays).array().rowwise() * lengths.head(num_rays).array()).matrix()).colwise() + b;
+
+    shapes_CAD_->reserve(shapes_CAD_->size() + shapes_camera_.size());
+    size_t col = 0;
+
+    for (size_t shape_index = 0; shape_index < shapes_camera_.size(); shape_index++) {
+        LabelledShape shape;
+        shape.label = shapes_camera_[shape_index].label;
+        shape.id = shapes_camera_[shape_index].id;
+        shape.closed = shapes_camera_[shape_index].closed;
+        shape.points.reserve(shape_sizes[shape_index]);
+
+        for (size_t i = 0; i < shape_sizes[shape_index]; i++, col++) 
+            shape.points.push_back(point(CAD_points(0, col), CAD_points(1, col)));
+
+        shapes_CAD_->push_back(std::move(shape));
+    }
+
+    if (num_rays < num_points) {
+        printf("TRANSFER SHAPES: %zu of %zu points could not be back projected onto the structure \n", 
+               num_points - num_rays, num_points);
+        return false;
+    }
+
+    return true;
 
 }
 
@@ -489,13 +774,13 @@ pcl::PointXYZ Util::GetCloudCentroid(pcl::PointCloud<pcl::PointXYZ>::ConstPtr cl
 
 pcl::PointXYZ Util::GetCloudCenter(pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_) {
 
-    uint16_t num_points = cloud_->size();
+    size_t num_points = cloud_->size();
 
     pcl::PointXYZ center_point;
 
     // determine central x and y values
-    float max_x = 0, max_y = 0, min_x = 2048, min_y = 2048;
-    for (uint16_t point_index = 0; point_index < num_points; point_index ++) {
+    float max_x = -FLT_MAX, max_y = -FLT_MAX, min_x = FLT_MAX, min_y = FLT_MAX;
+    for (size_t point_index = 0; point_index < num_points; point_index ++) {
         if (cloud_->at(point_index).x > max_x) max_x = cloud_->at(point_index).x; 
         if (cloud_->at(point_index).y > max_y) max_y = cloud_->at(point_index).y; 
 
@@ -514,13 +799,55 @@ pcl::PointXYZ Util::GetCloudCenter(pcl::PointCloud<pcl::PointXYZ>::ConstPtr clou
 
 }
 
-void Util::OffsetCloud(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_, Eigen::Vector3d offset_) {
-    
-    for (uint16_t i = 0; i < cloud_->size(); i++) {
-        cloud_->at(i).x += offset_(0);
-        cloud_->at(i).y += offset_(1);
-        cloud_->at(i).z += offset_(2);
+CloudStats Util::GetCloudStats(pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_) {
+
+    CloudStats stats;
+    stats.centroid = GetCloudCentroid(cloud_);
+    stats.center = GetCloudCenter(cloud_);
+
+    return stats;
+
+}
+
+pcl::PointCloud<pcl::PointXYZ>::Ptr Util::BackProjectToPlane
+    (pcl::PointCloud<pcl::PointXYZ>::ConstPtr image_cloud_, 
+     const Eigen::Vector3d& plane_normal_, const Eigen::Vector3d& plane_point_) {
+
+    StageTimer timer("back_projection");
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr back_projected_cloud 
+        (new pcl::PointCloud<pcl::PointXYZ>);
+    back_projected_cloud->reserve(image_cloud_->size());
+
+    // the rays start at the camera origin
+    double plane_distance = plane_point_.dot(plane_normal_);
+
+    for (uint32_t i = 0; i < image_cloud_->size(); i++) {
+        Eigen::Vector2i image_pixel (image_cloud_->at(i).x, image_cloud_->at(i).y);
+        std::optional<Eigen::Vector3d> ray = camera_model->BackProject(image_pixel);
+        if (!ray.has_value()) continue;
+
+        Eigen::Vector3d ray_unit_vector = ray.value().normalized();
+        double len = plane_distance / ray_unit_vector.dot(plane_normal_);
+
+        // rays parallel to the plane (infinite length) or pointing away from it (length <= 0) never 
+        // reach the structure, their pixels are dropped like pixels without a ray
+        if (!std::isfinite(len) || len <= 0) continue;
+
+        Eigen::Vector3d back_projected_point = ray_unit_vector * len;
+
+        back_projected_cloud->push_back(pcl::PointXYZ(back_projected_point[0], 
+            back_projected_point[1], back_projected_point[2]));
+
     }
+
+    if (back_projected_cloud->size() < image_cloud_->size()) {
+        printf("BACK PROJECT: %zu of %zu points could not be back projected onto the structure \n", 
+               image_cloud_->size() - back_projected_cloud->size(), image_cloud_->size());
+    }
+
+    return back_projected_cloud;
+
 }
 
 Eigen::Matrix3d Util::LieAlgebraToR(const Eigen::Vector3d& eps) {
@@ -3,138 +3,98 @@
 
 namespace cam_cad {
 
-Visualizer::Visualizer(const std::string name_) {
+void VisScene::addCloud (pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud_, std::string id_,
+                         uint8_t point_size_) {
+  VisCloud vis_cloud;
+  vis_cloud.id = id_;
+  vis_cloud.cloud.reset(new pcl::PointCloud<pcl::PointXYZ>(*cloud_));
+  vis_cloud.point_size = point_size_;
+  clouds.push_back(vis_cloud);
+}
+
+void VisScene::addCorrespondences (pcl::CorrespondencesConstPtr corrs_, std::string source_id_,
+                                   std::string target_id_, std::string id_) {
+  VisCorrespondences vis_corrs;
+  vis_corrs.id = id_;
+  vis_corrs.source_id = source_id_;
+  vis_corrs.target_id = target_id_;
+  vis_corrs.corrs.reset(new pcl::Correspondences(*corrs_));
+  correspondences.push_back(vis_corrs);
+}
+
+Visualizer::Visualizer(const std::string name_) : middle_state(1), num_published(0),
+                                                  num_rendered(0) {
   display_name = name_;
-  display1_called = false;
-  display2_called = false;
-  display3_called = false; 
-  display4_called = false;
-  display5_called = false;
-  display6_called = false;
-} 
+  coord_size_ = 100;
+  frame_ms_ = 16;
+  back_index = 0;
+  front_index = 2;
+}
 
 Visualizer::~Visualizer() {
-
+  if (vis_thread.joinable())
+    endVis();
 }
 
-void Visualizer::startVis(uint16_t coord_size) {
-  point_cloud_display = 
-    boost::make_shared<pcl::visualization::PCLVisualizer> (display_name);
-  point_cloud_display->setBackgroundColor (0, 0, 0);
-  point_cloud_display->addCoordinateSystem (coord_size);
-  point_cloud_display->initCameraParameters ();
+void Visualizer::startVis(uint16_t coord_size, uint16_t frame_ms) {
+  coord_size_ = coord_size;
+  frame_ms_ = frame_ms > 0 ? frame_ms : 1;
 
   this->continueFlag.test_and_set(std::memory_order_relaxed);
 
-  // start the visualizer spinning in its own thread
+  // the window is created and used only by the render thread
   this->vis_thread = std::thread(&Visualizer::spin, this);
 }
 
 void Visualizer::endVis() {
   this->continueFlag.clear(std::memory_order_relaxed);
-  vis_thread.join();
+  if (vis_thread.joinable())
+    vis_thread.join();
 }
 
-void Visualizer::displayClouds
-  (pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_, std::string id_) {
-  
-  // get mutex for visulalizer spinning in vis thread 
-  // and either create a new cloud or update the existing one
-  mtx.lock();
-
-  // if the visualizer does not already contain the point cloud, add it
-  if(!display1_called) {
-    point_cloud_display->addPointCloud(cloud_, id_,0);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, id_);
-    point_cloud_display->resetCamera();    
-  }
+void Visualizer::displayScene(std::shared_ptr<const VisScene> scene_) {
+  // fill the back slot, then swap it with the middle slot and flag it as new
+  scenes[back_index] = scene_;
+  uint8_t previous = middle_state.exchange(back_index | NEW_SCENE, std::memory_order_acq_rel);
+  back_index = previous & 3;
 
-  // otherwise, update the existing cloud
-  else 
-    point_cloud_display->updatePointCloud(cloud_,id_);
+  num_published++;
+}
 
-  mtx.unlock();
+void Visualizer::displayClouds(const std::vector<pcl::PointCloud<pcl::PointXYZ>::ConstPtr>& clouds_,
+                               const std::vector<std::string>& ids_) {
+  std::shared_ptr<VisScene> scene = std::make_shared<VisScene>();
 
-  display1_called = true;
+  for (size_t i = 0; i < clouds_.size() && i < ids_.size(); i++)
+    scene->addCloud(clouds_[i], ids_[i]);
+
+  displayScene(scene);
+}
 
+void Visualizer::displayClouds
+  (pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_, std::string id_) {
+  displayClouds({cloud_}, {id_});
 }
 
 void Visualizer::displayClouds(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud1_,
                                 pcl::PointCloud<pcl::PointXYZ>::Ptr cloud2_,
                                 std::string id1_,
                                 std::string id2_) {
-  
-  // get mutex for visulalizer spinning in vis thread 
-  // and either create a new cloud or update the existing one
-  mtx.lock();
-
-  // if the visualizer does not already contain the image cloud, add it
-  if(!display2_called) {
-    point_cloud_display->addPointCloud(cloud1_, id1_);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, id1_);
-    point_cloud_display->resetCamera();
-    point_cloud_display->addPointCloud(cloud2_, id2_);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, id2_);  
-    point_cloud_display->resetCamera();  
-  }
-
-  // otherwise, update the existing cloud
-  else {
-    point_cloud_display->updatePointCloud(cloud1_, id1_);
-    point_cloud_display->updatePointCloud(cloud2_, id2_);
-  }
-
-  mtx.unlock();
-
-  display2_called = true;
-
+  displayClouds({cloud1_, cloud2_}, {id1_, id2_});
 }
 
 // display three clouds with no correspondences
-void Visualizer::displayClouds(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud1_, 
+void Visualizer::displayClouds(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud1_,
                        pcl::PointCloud<pcl::PointXYZ>::Ptr cloud2_,
                        pcl::PointCloud<pcl::PointXYZ>::Ptr cloud3_,
                        std::string id1_,
                        std::string id2_,
                        std::string id3_) {
-
-  // get mutex for visulalizer spinning in vis thread 
-  // and either create a new cloud or update the existing one
-  mtx.lock();
-
-  // if the visualizer does not already contain the image cloud, add it
-  if(!display3_called) {
-    point_cloud_display->addPointCloud(cloud1_, id1_);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, id1_);
-    point_cloud_display->resetCamera();
-    point_cloud_display->addPointCloud(cloud2_, id2_);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, id2_);
-    point_cloud_display->resetCamera();
-    point_cloud_display->addPointCloud(cloud3_, id3_);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, id3_);
-    point_cloud_display->resetCamera();
-  }
-  // otherwise, update the existing cloud
-  else {
-    point_cloud_display->updatePointCloud(cloud1_, id1_);
-    point_cloud_display->updatePointCloud(cloud2_, id2_);
-    point_cloud_display->updatePointCloud(cloud3_, id3_);
-  }
-
-  mtx.unlock();
-
-  display3_called = true;
-
+  displayClouds({cloud1_, cloud2_, cloud3_}, {id1_, id2_, id3_});
 }
 
-// display three clouds with no correspondences
-void Visualizer::displayClouds(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud1_, 
+// display four clouds with no correspondences
+void Visualizer::displayClouds(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud1_,
                        pcl::PointCloud<pcl::PointXYZ>::Ptr cloud2_,
                        pcl::PointCloud<pcl::PointXYZ>::Ptr cloud3_,
                        pcl::PointCloud<pcl::PointXYZ>::Ptr cloud4_,
@@ -142,43 +102,7 @@ void Visualizer::displayClouds(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud1_,
                        std::string id2_,
                        std::string id3_,
                        std::string id4_) {
-
-  // get mutex for visulalizer spinning in vis thread and 
-  // either create a new cloud or update the existing one
-  mtx.lock();
-
-  // if the visualizer does not already contain the image cloud, add it
-  if(!display3_called) {
-    point_cloud_display->addPointCloud(cloud1_, id1_);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, id1_);
-    point_cloud_display->resetCamera();
-    point_cloud_display->addPointCloud(cloud2_, id2_);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, id2_);
-    point_cloud_display->resetCamera();
-    point_cloud_display->addPointCloud(cloud3_, id3_);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, id3_);
-    point_cloud_display->resetCamera();
-    point_cloud_display->addPointCloud(cloud4_, id4_);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, id4_);
-    point_cloud_display->resetCamera();
-  }
-
-  // otherwise, update the existing cloud
-  else {
-    point_cloud_display->updatePointCloud(cloud1_, id1_);
-    point_cloud_display->updatePointCloud(cloud2_, id2_);
-    point_cloud_display->updatePointCloud(cloud3_, id3_);
-    point_cloud_display->updatePointCloud(cloud3_, id4_);
-  }
-
-  mtx.unlock();
-
-  display4_called = true;
-
+  displayClouds({cloud1_, cloud2_, cloud3_, cloud4_}, {id1_, id2_, id3_, id4_});
 }
 
 void Visualizer::displayClouds(pcl::PointCloud<pcl::PointXYZ>::Ptr image_cloud_,
@@ -186,49 +110,13 @@ void Visualizer::displayClouds(pcl::PointCloud<pcl::PointXYZ>::Ptr image_cloud_,
                                 pcl::CorrespondencesConstPtr corrs_,
                                 std::string id_image_,
                                 std::string id_projected_) {
+  std::shared_ptr<VisScene> scene = std::make_shared<VisScene>();
 
-  // get mutex for visulalizer spinning in vis thread and 
-  // either create a new cloud or update the existing one
-  mtx.lock();
-
-  // if the visualizer does not already contain the image cloud, add it
-  if(!display3_called) {
-    point_cloud_display->addPointCloud(image_cloud_, id_image_);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, id_image_);
-    point_cloud_display->addPointCloud(projected_cloud_, id_projected_);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, id_projected_); 
-  }
-  // otherwise, update the existing cloud
-  else {
-    point_cloud_display->updatePointCloud(image_cloud_, id_image_);
-    point_cloud_display->updatePointCloud(projected_cloud_, id_projected_);
-  }    
-
-  // remove all correspondence lines and redraw
-  point_cloud_display->removeAllShapes();
-
-  uint16_t line_start_index = 0, line_end_index = 1; 
-  uint16_t line_id = 0;
-
-  // illustrate correspondences
-  for (uint16_t i = 0; i < corrs_->size(); i++) {
-    uint16_t proj_point_index = corrs_->at(i).index_query;
-    uint16_t cam_point_index = corrs_->at(i).index_match;
-
-    point_cloud_display->addLine(projected_cloud_->at(proj_point_index), 
-                                 image_cloud_->at(cam_point_index),
-                                 0, 255, 0, std::to_string(line_id));
-    line_start_index += 2;
-    line_end_index += 2;
-    line_id ++;
-  }
-
-  mtx.unlock();
-
-  display5_called = true;
+  scene->addCloud(image_cloud_, id_image_);
+  scene->addCloud(projected_cloud_, id_projected_);
+  scene->addCorrespondences(corrs_, id_projected_, id_image_);
 
+  displayScene(scene);
 }
 
 void Visualizer::displayClouds(pcl::PointCloud<pcl::PointXYZ>::ConstPtr image_cloud_,
@@ -238,72 +126,119 @@ void Visualizer::displayClouds(pcl::PointCloud<pcl::PointXYZ>::ConstPtr image_cl
                         std::string id_image_,
                         std::string id_CAD_,
                         std::string id_projected_) {
+  std::shared_ptr<VisScene> scene = std::make_shared<VisScene>();
 
-  // get mutex for visulalizer spinning in vis thread and 
-  // either create a new cloud or update the existing one
-  mtx.lock();
-
-  // if the visualizer does not already contain the image cloud, add it
-  if(!display6_called) {
-    point_cloud_display->addPointCloud(image_cloud_, id_image_);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, id_image_);
-    point_cloud_display->addPointCloud(CAD_cloud_, id_CAD_);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, id_CAD_);
-    point_cloud_display->addPointCloud(projected_cloud_, id_projected_);
-    point_cloud_display->setPointCloudRenderingProperties 
-      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 3, id_projected_); 
-    point_cloud_display->resetCamera();
-  }
-
-  // otherwise, update the existing cloud
-  else {
-    point_cloud_display->updatePointCloud(image_cloud_, id_image_);
-    point_cloud_display->updatePointCloud(CAD_cloud_, id_CAD_);
-    point_cloud_display->updatePointCloud(projected_cloud_, id_projected_);
-    point_cloud_display->resetCamera();
-  }    
-
-  // remove all correspondence lines and redraw
-  point_cloud_display->removeAllShapes();
-
-  uint16_t line_start_index = 0, line_end_index = 1; 
-  uint16_t line_id = 0;
-
-  // illustrate correspondences
-  for (uint16_t i = 0; i < corrs_->size(); i++) {
+  scene->addCloud(image_cloud_, id_image_);
+  scene->addCloud(CAD_cloud_, id_CAD_);
+  scene->addCloud(projected_cloud_, id_projected_, 3);
+  scene->addCorrespondences(corrs_, id_projected_, id_image_);
 
-    uint16_t proj_point_index = corrs_->at(i).index_query;
-    uint16_t cam_point_index = corrs_->at(i).index_match;
-
-    point_cloud_display->addLine(projected_cloud_->at(proj_point_index), 
-                                 image_cloud_->at(cam_point_index),
-                                 0, 255, 0, std::to_string(line_id));
-    line_start_index += 2;
-    line_end_index += 2;
-    line_id ++;
-
-  }
-
-  mtx.unlock();
+  displayScene(scene);
+}
 
-  display6_called = true;
+uint64_t Visualizer::getNumPublished() {
+  return num_published;
+}
 
+uint64_t Visualizer::getNumRendered() {
+  return num_rendered;
 }
 
 void Visualizer::spin() {
+  point_cloud_display =
+    boost::make_shared<pcl::visualization::PCLVisualizer> (display_name);
+  point_cloud_display->setBackgroundColor (0, 0, 0);
+  point_cloud_display->addCoordinateSystem (coord_size_);
+  point_cloud_display->initCameraParameters ();
+
+  displayed_clouds.clear();
+  displayed_corrs.clear();
+
   while (this->continueFlag.test_and_set(std::memory_order_relaxed) &&
            !(this->point_cloud_display->wasStopped()))
   {
-    mtx.lock();
-    point_cloud_display->spinOnce (3);
-    mtx.unlock();
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // take the middle slot if it holds a scene newer than the front one
+    if (middle_state.load(std::memory_order_acquire) & NEW_SCENE) {
+      uint8_t previous = middle_state.exchange(front_index, std::memory_order_acq_rel);
+      front_index = previous & 3;
+
+      if (scenes[front_index] != nullptr) {
+        renderScene(*scenes[front_index]);
+        num_rendered++;
+      }
+    }
+
+    // processes window events for up to one frame, no extra sleep
+    point_cloud_display->spinOnce (frame_ms_);
   }
+
+  point_cloud_display->close();
 }
 
+void Visualizer::renderScene(const VisScene& scene_) {
+  std::set<std::string> scene_clouds;
+  bool added = false;
+
+  for (auto& vis_cloud : scene_.clouds) {
+    scene_clouds.insert(vis_cloud.id);
+
+    // if the visualizer does not already contain the point cloud, add it
+    if (displayed_clouds.count(vis_cloud.id) == 0) {
+      point_cloud_display->addPointCloud(vis_cloud.cloud, vis_cloud.id);
+      displayed_clouds.insert(vis_cloud.id);
+      added = true;
+    }
+    // otherwise, update the existing cloud
+    else
+      point_cloud_display->updatePointCloud(vis_cloud.cloud, vis_cloud.id);
+
+    point_cloud_display->setPointCloudRenderingProperties
+      (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, vis_cloud.point_size, vis_cloud.id);
+
+    if (vis_cloud.r >= 0 && vis_cloud.g >= 0 && vis_cloud.b >= 0) {
+      point_cloud_display->setPointCloudRenderingProperties
+        (pcl::visualization::PCL_VISUALIZER_COLOR, vis_cloud.r, vis_cloud.g, vis_cloud.b,
+         vis_cloud.id);
+    }
+  }
 
+  // remove clouds that are not part of the new scene
+  for (auto it = displayed_clouds.begin(); it != displayed_clouds.end();) {
+    if (scene_clouds.count(*it) == 0) {
+      point_cloud_display->removePointCloud(*it);
+      it = displayed_clouds.erase(it);
+    }
+    else it++;
+  }
 
+  // correspondences are redrawn as one line set per correspondence set
+  for (auto& id : displayed_corrs)
+    point_cloud_display->removeCorrespondences(id);
+  displayed_corrs.clear();
+
+  for (auto& vis_corrs : scene_.correspondences) {
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr source, target;
+
+    for (auto& vis_cloud : scene_.clouds) {
+      if (vis_cloud.id == vis_corrs.source_id) source = vis_cloud.cloud;
+      if (vis_cloud.id == vis_corrs.target_id) target = vis_cloud.cloud;
+    }
+
+    if (source == nullptr || target == nullptr) {
+      printf("correspondences %s refer to clouds not in the scene\n", vis_corrs.id.c_str());
+      continue;
+    }
+
+    point_cloud_display->addCorrespondences<pcl::PointXYZ>(source, target, *vis_corrs.corrs,
+                                                            vis_corrs.id);
+    point_cloud_display->setShapeRenderingProperties
+      (pcl::visualization::PCL_VISUALIZER_COLOR, 0, 1, 0, vis_corrs.id);
+    displayed_corrs.insert(vis_corrs.id);
+  }
 
-}
\ No newline at end of file
+  // frame the scene when new clouds appear
+  if (added)
+    point_cloud_display->resetCamera();
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdio.h>
+#include <cstdint>
+#include <Eigen/Dense>
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <string>
+#include "ScenarioGenerator.h"
+
+/**
+ * @brief Scaffolding shared by the test programs that run on a synthetic scenario
+ * (ScenarioGenerator): the scenario is generated into a directory under /tmp and its batch
+ * manifest lists every image with its label files, initial "T_CS" and ground truth "truth_T_CS".
+ */
+
+// reads a row major 4x4 transform, e.g. the "T_CS" or "truth_T_CS" of a manifest job
+inline Eigen::Matrix4d readTransform (const nlohmann::json& J_) {
+    Eigen::Matrix4d T;
+    for (uint8_t row = 0; row < 4; row++)
+        for (uint8_t col = 0; col < 4; col++)
+            T(row, col) = J_[row * 4 + col];
+    return T;
+}
+
+// generates the scenario into dir_ and reads its manifest, false if either fails
+inline bool generateScenario (const cam_cad::ScenarioConfig& scenario_, std::string dir_,
+                              nlohmann::json& manifest_) {
+    cam_cad::ScenarioGenerator generator;
+    generator.SetConfig(scenario_);
+    if (!generator.Generate(dir_)) return false;
+
+    std::ifstream manifest_file(dir_ + "/manifest.json");
+    if (!manifest_file.is_open()) {
+        printf("failed to open %s/manifest.json\n", dir_.c_str());
+        return false;
+    }
+
+    try {
+        manifest_file >> manifest_;
+    }
+    catch (const nlohmann::json::exception& e) {
+        printf("failed to parse %s/manifest.json: %s\n", dir_.c_str(), e.what());
+        return false;
+    }
+
+    return true;
+}
+
+// writes an edited manifest back, e.g. with extra keys or jobs for the batch runner
+inline bool writeManifest (std::string file_name_, const nlohmann::json& manifest_) {
+    std::ofstream manifest_file(file_name_);
+    if (!manifest_file.is_open()) return false;
+    manifest_file << manifest_.dump(2);
+    return manifest_file.good();
+}
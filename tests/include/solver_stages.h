@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Solver.h"
+
+namespace cam_cad {
+
+/**
+ * @brief Solver with its ceres stages (options and problem setup, problem build and solve) made
+ * public, so tests and benchmarks can run and time one stage at a time. Only for tests, the
+ * stages are protected in Solver.
+ */
+class SolverStages : public Solver {
+public:
+    using Solver::Solver;
+
+    using Solver::SetupCeresOptions;
+    using Solver::BuildCeresProblem;
+    using Solver::SolveCeresProblem;
+};
+
+}
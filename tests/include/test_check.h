@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdio.h>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Pass/fail checks shared by the test programs. Every check prints one PASS or FAIL
+ * line, the program ends with "return checkResult();" so it returns 1 if any check failed.
+ */
+
+inline uint32_t num_failed = 0;
+
+inline void check (bool condition_, std::string name_) {
+    printf("%s: %s\n", condition_ ? "PASS" : "FAIL", name_.c_str());
+    if (!condition_) num_failed++;
+}
+
+inline int checkResult () {
+    printf("%u checks failed\n", num_failed);
+    return num_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+"""
+Program to test the python module (cam_cad) on the synthetic scenario written by
+pose_estimator_test: every image is solved from NumPy label points, the solved translations must
+be within 2% of the ground truth, back projected pixels must lie on the structure plane, and
+pixels that can not be back projected and malformed arrays must raise ValueError.
+The program prints one PASS or FAIL line per check and returns 1 if any check fails.
+
+usage: PYTHONPATH=<module dir> python3 pose_estimator_test.py <scenario dir> <config dir>
+"""
+
+import json
+import os
+import sys
+
+import numpy as np
+
+from cam_cad import PoseEstimator
+
+num_failed = 0
+
+
+def check(condition, name):
+    global num_failed
+    print("%s: %s" % ("PASS" if condition else "FAIL", name))
+    if not condition:
+        num_failed += 1
+
+
+def read_points(file_name):
+    """reads the first shape of a labelme json file as an (N, 2) float32 array"""
+    with open(file_name) as labels:
+        return np.array(json.load(labels)["shapes"][0]["points"], dtype=np.float32)
+
+
+def read_transform(values):
+    """reads a row major 4x4 transform, e.g. the "T_CS" or "truth_T_CS" of a manifest job"""
+    return np.array(values, dtype=np.float64).reshape(4, 4)
+
+
+def raises_value_error(call):
+    try:
+        call()
+    except ValueError:
+        return True
+    return False
+
+
+def main(scenario_dir, config_dir):
+    with open(os.path.join(scenario_dir, "manifest.json")) as manifest_file:
+        manifest = json.load(manifest_file)
+
+    estimator = PoseEstimator(os.path.join(config_dir, "SolutionParameters.json"),
+                              os.path.join(config_dir, "Radtan_test.json"))
+
+    CAD_points = read_points(os.path.join(scenario_dir, "CAD", "CAD_0.json"))
+    check(raises_value_error(lambda: estimator.solve(CAD_points, np.identity(4))),
+          "solve without a CAD face raises ValueError")
+    estimator.set_cad(CAD_points)
+
+    for job in manifest["jobs"]:
+        camera_points = read_points(os.path.join(scenario_dir, job["camera_labels"]))
+        T_truth = read_transform(job["truth_T_CS"])
+
+        solution = estimator.solve(camera_points, read_transform(job["T_CS"]))
+        check(solution.converged, "%s: converged in %d iterations" % (job["id"], solution.solution_iterations))
+
+        translation_error = (np.linalg.norm(solution.T_CS[:3, 3] - T_truth[:3, 3]) /
+                             np.linalg.norm(T_truth[:3, 3]))
+        check(translation_error < 0.02, "%s: translation within 2%% of the ground truth (%.3f%%)" %
+              (job["id"], 100 * translation_error))
+
+        # back projected camera labels lie on the structure plane
+        points = estimator.back_project(camera_points, T_truth)
+        plane_distance = np.abs((points - T_truth[:3, 3]) @ T_truth[:3, 2])
+        check(points.shape == (len(camera_points), 3) and plane_distance.max() < 1e-3,
+              "%s: back projected onto the structure plane (max %g)" % (job["id"], plane_distance.max()))
+
+    # a structure plane behind the camera is never reached by the pixel rays
+    T_behind = np.identity(4)
+    T_behind[2, 3] = -10
+    check(raises_value_error(lambda: estimator.back_project(camera_points, T_behind)),
+          "pixels that miss the structure plane raise ValueError")
+
+    check(raises_value_error(lambda: estimator.back_project(np.zeros((3, 3), dtype=np.float32), T_truth)),
+          "malformed pixel array raises ValueError")
+
+    print("%d checks failed" % num_failed)
+    return 1 if num_failed > 0 else 0
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3:
+        print("usage: %s <scenario dir> <config dir>" % sys.argv[0])
+        sys.exit(1)
+    sys.exit(main(sys.argv[1], sys.argv[2]))
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include "AnnotationSession.h"
+#include "test_check.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Program to test the drawing annotator (AnnotationSession) by reading back what it wrote.
+ * Layers of points, polylines and filled polygons are drawn onto a blank 200 x 100 drawing and
+ * encoded once as a (lossless) png; the decoded drawing must have every layer in its own color at
+ * the expected pixels and leave the rest of the drawing untouched. Points outside of the drawing
+ * are skipped and a session without a drawing refuses to draw or write.
+ * The program returns 1 if any check fails.
+ */
+
+const std::string TEST_DIR = "/tmp/cam_cad_annotation_session_test";
+
+bool isColor (const cv::Mat& image_, int u_, int v_, cv::Vec3b color_) {
+    cv::Vec3b pixel = image_.at<cv::Vec3b>(v_, u_);
+    return pixel[0] == color_[0] && pixel[1] == color_[1] && pixel[2] == color_[2];
+}
+
+int main () {
+
+    std::filesystem::create_directories(TEST_DIR);
+
+    cv::Mat drawing(100, 200, CV_8UC3, cv::Scalar(255, 255, 255));
+    check(cv::imwrite(TEST_DIR + "/drawing.png", drawing), "drawing written");
+
+    cv::Vec3b white(255, 255, 255);
+    cv::Vec3b black = cam_cad::AnnotationSession::getColor("black");
+    cv::Vec3b red = cam_cad::AnnotationSession::getColor("red");
+    cv::Vec3b green = cam_cad::AnnotationSession::getColor("green");
+    cv::Vec3b blue = cam_cad::AnnotationSession::getColor("blue");
+
+    //no drawing block****************//
+
+    cam_cad::AnnotationSession session;
+    std::vector<cam_cad::point> pixels = {cam_cad::point(10, 10), cam_cad::point(199, 99),
+                                          cam_cad::point(-1, 5), cam_cad::point(200, 5)};
+    check(!session.addPoints(&pixels, "red") && !session.write(TEST_DIR + "/annotated.png"),
+          "nothing drawn or written before open");
+    check(!session.open(TEST_DIR + "/missing.png") && session.getWidth() == 0, "missing drawing rejected");
+
+    //layer block*********************//
+
+    check(session.open(TEST_DIR + "/drawing.png"), "drawing opened");
+    check(session.getWidth() == 200 && session.getHeight() == 100, "session has the drawing size");
+
+    check(session.addPoints(&pixels, "red"), "points added");
+
+    std::vector<cam_cad::point> crack = {cam_cad::point(20.4f, 50), cam_cad::point(80.6f, 50)};
+    check(session.addPolyline(&crack, "blue", 3), "polyline added");
+
+    std::vector<cam_cad::point> outline = {cam_cad::point(100, 10), cam_cad::point(140, 10),
+                                           cam_cad::point(140, 40)};
+    check(session.addPolyline(&outline, "black", 1, true), "closed polyline added");
+
+    std::vector<cam_cad::point> polygon = {cam_cad::point(150, 60), cam_cad::point(190, 60),
+                                           cam_cad::point(190, 90), cam_cad::point(150, 90)};
+    check(session.addPolygon(&polygon, "green"), "polygon added");
+    check(session.getNumLayers() == 4, "one layer per call");
+
+    check(session.write(TEST_DIR + "/annotated.png"), "annotated drawing written");
+
+    //read back block*****************//
+
+    cv::Mat annotated = cv::imread(TEST_DIR + "/annotated.png", 1);
+    check(annotated.cols == 200 && annotated.rows == 100, "annotated drawing has the drawing size");
+    if (annotated.cols != 200 || annotated.rows != 100) return checkResult();
+
+    check(isColor(annotated, 10, 10, red) && isColor(annotated, 199, 99, red), "points drawn");
+    check(isColor(annotated, 0, 5, white) && isColor(annotated, 199, 5, white), "points outside skipped");
+
+    // vertices are rounded to the nearest pixel, the thickness spreads the line across rows 49 to 51
+    check(isColor(annotated, 20, 50, blue) && isColor(annotated, 81, 50, blue), "polyline ends rounded");
+    check(isColor(annotated, 50, 49, blue) && isColor(annotated, 50, 51, blue) &&
+          isColor(annotated, 50, 53, white), "polyline thickness");
+
+    check(isColor(annotated, 120, 10, black) && isColor(annotated, 140, 25, black), "outline drawn");
+    check(isColor(annotated, 120, 25, black) && isColor(annotated, 130, 15, white),
+          "outline closed and not filled");
+
+    check(isColor(annotated, 170, 75, green) && isColor(annotated, 150, 60, green) &&
+          isColor(annotated, 190, 90, green), "polygon filled up to its vertices");
+    check(isColor(annotated, 149, 75, white) && isColor(annotated, 170, 91, white), "polygon not spilled");
+
+    //reopen block********************//
+
+    check(session.open(TEST_DIR + "/annotated.png") && session.getNumLayers() == 0,
+          "reopening starts a new set of layers");
+
+    return checkResult();
+}
@@ -5,6 +5,7 @@
 #include "visualizer.h"
 #include "Solver.h"
 #include "util.h"
+#include "VectorWriter.h"
 #include <X11/Xlib.h> 
 #include <Eigen/Dense>
 #include <Eigen/Geometry>
@@ -111,8 +112,10 @@ int main () {
     pcl::PointCloud<pcl::PointXYZ>::Ptr transformed_CAD_cloud = 
         mainUtility.TransformCloud(input_cloud_CAD, T_CS_final);
 
+    // the structure plane follows directly from the solved pose, 
+    // GetCloudPlane is only needed for structure clouds that are not planar
     pcl::ModelCoefficients::Ptr CAD_plane = 
-        mainUtility.GetCloudPlane(transformed_CAD_cloud);
+        mainUtility.GetStructurePlane(T_CS_final);
 
     std::cout << "Model coefficients: " << CAD_plane->values[0] << " " 
                                         << CAD_plane->values[1] << " "
@@ -125,7 +128,7 @@ int main () {
     printf("created test crack points \n");
 
     pcl::PointCloud<pcl::PointXYZ>::Ptr back_projected_crack_points = 
-        mainUtility.BackProject(crack_points, transformed_CAD_cloud, CAD_plane);
+        mainUtility.BackProject(crack_points, T_CS_final);
 
     printf("completed back projection \n");
 
@@ -173,9 +176,52 @@ int main () {
     std::vector<cam_cad::point> output_points_CAD;
     ImageBuffer.flattenCloud(CAD_crack_points, &output_points_CAD);
 
+    std::string CAD_image_file = "/home/cameron/wkrpt300_images/sim_CAD.jpg";
+    std::string annotated_file = CAD_image_file.substr(0, CAD_image_file.find_last_of('.')) + "_annotated";
+
     bool write_success = 
-        ImageBuffer.writeToImage(&output_points_CAD, "/home/cameron/wkrpt300_images/sim_CAD.jpg",
-                                 "/home/cameron/wkrpt300_images/sim_CAD_annotated.jpg");
+        ImageBuffer.writeToImage(&output_points_CAD, CAD_image_file, annotated_file + ".jpg");
+
+    //Write crack data to vector overlay*********//
+    // same drawing coordinates and size as the image output, without rounding to pixels
+    cam_cad::VectorWriter vector_writer;
+    cv::Mat CAD_image = cv::imread(CAD_image_file, cv::IMREAD_UNCHANGED);
+
+    if (!CAD_image.empty() && vector_writer.open(annotated_file + ".svg", CAD_image.cols, CAD_image.rows)) {
+        vector_writer.addPolyline(CAD_crack_points);
+        vector_writer.close();
+    }
+
+    //Batch defect transfer************//
+    // the two arms of the cross as separate labelled defects, transferred together in one pass
+    std::vector<cam_cad::LabelledShape> crack_shapes(2), CAD_crack_shapes;
+    size_t arm_length = crack_points->size() / 2;
+
+    for (size_t i = 0; i < crack_points->size(); i++) {
+        cam_cad::LabelledShape& arm = crack_shapes[i < arm_length ? 0 : 1];
+        arm.points.push_back(cam_cad::point(crack_points->at(i).x, crack_points->at(i).y));
+    }
+
+    for (size_t d = 0; d < crack_shapes.size(); d++) {
+        crack_shapes[d].label = "crack";
+        crack_shapes[d].id = d;
+        crack_shapes[d].closed = false;
+    }
+
+    mainUtility.TransferShapes(crack_shapes, T_CS_final, 0.01, &CAD_crack_shapes);
+
+    // must match the single cloud transfer above point for point
+    double max_difference = 0;
+    size_t output_index = 0;
+    for (auto& shape : CAD_crack_shapes) {
+        for (auto& p : shape.points) {
+            cam_cad::point& q = output_points_CAD.at(output_index++);
+            max_difference = std::max<double>(max_difference, std::hypot(p.x - q.x, p.y - q.y));
+        }
+    }
+
+    printf("batch transfer of %zu defects, max difference to the single cloud transfer: %f px \n", 
+           CAD_crack_shapes.size(), max_difference);
 
     printf("exiting program \n");
 
@@ -188,11 +234,11 @@ pcl::PointCloud<pcl::PointXYZ>::Ptr
     pcl::PointCloud<pcl::PointXYZ>::Ptr crack_cloud (new pcl::PointCloud<pcl::PointXYZ>);
 
     // get center of structure cloud
-    uint16_t num_points = input_cloud_camera_->size();
+    size_t num_points = input_cloud_camera_->size();
 
     // determine central x and y values
     float max_x = 0, max_y = 0, min_x = 2048, min_y = 2048;
-    for (uint16_t point_index = 0; point_index < num_points; point_index ++) {
+    for (size_t point_index = 0; point_index < num_points; point_index ++) {
         if (input_cloud_camera_->at(point_index).x > max_x) max_x = 
             input_cloud_camera_->at(point_index).x; 
         if (input_cloud_camera_->at(point_index).y > max_y) max_y = 
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include "BatchRunner.h"
+#include "scenario_fixture.h"
+#include "test_check.h"
+#include <Eigen/Dense>
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Program to test the batch runner (BatchRunner) on a synthetic scenario. Manifests that
+ * are missing, unparsable, lack "solution_parameters" or "jobs", or have a key of the wrong type
+ * must be rejected by ReadManifest. A batch of one good job followed by a job with a missing
+ * label file and a job without "CAD_labels" must run every job: the good job converges within 2%
+ * of the true translation and transfers its defects, the bad jobs fail with an error, and the
+ * results file reports all three jobs with their id, convergence, error, pose and timings.
+ * The program returns 1 if any check fails.
+ */
+
+#ifndef CAM_CAD_CONFIG_DIR
+#define CAM_CAD_CONFIG_DIR "config"
+#endif
+
+const std::string TEST_DIR = "/tmp/cam_cad_batch_runner_test";
+
+bool writeText (std::string file_name_, std::string text_) {
+    std::ofstream file(file_name_);
+    file << text_;
+    return file.good();
+}
+
+int main () {
+
+    std::string config_dir = CAM_CAD_CONFIG_DIR;
+
+    cam_cad::ScenarioConfig scenario;
+    scenario.num_images = 1;
+    scenario.camera_model = config_dir + "/Radtan_test.json";
+    scenario.solution_parameters = config_dir + "/SolutionParameters.json";
+    scenario.pixel_noise = 0;
+    scenario.outlier_rate = 0;
+
+    nlohmann::json manifest;
+    if (!generateScenario(scenario, TEST_DIR, manifest) || manifest["jobs"].size() != 1) {
+        check(false, "scenario generated");
+        return 1;
+    }
+
+    //manifest block******************//
+
+    {
+        cam_cad::BatchRunner runner;
+        check(!runner.ReadManifest(TEST_DIR + "/does_not_exist.json"), "missing manifest rejected");
+
+        writeText(TEST_DIR + "/unparsable.json", "{\"jobs\": [");
+        check(!runner.ReadManifest(TEST_DIR + "/unparsable.json"), "unparsable manifest rejected");
+
+        nlohmann::json no_parameters = manifest;
+        no_parameters.erase("solution_parameters");
+        writeManifest(TEST_DIR + "/no_parameters.json", no_parameters);
+        check(!runner.ReadManifest(TEST_DIR + "/no_parameters.json"),
+              "manifest without solution_parameters rejected");
+
+        nlohmann::json no_jobs = manifest;
+        no_jobs["jobs"] = "all of them";
+        writeManifest(TEST_DIR + "/no_jobs.json", no_jobs);
+        check(!runner.ReadManifest(TEST_DIR + "/no_jobs.json"), "manifest without a jobs array rejected");
+
+        nlohmann::json wrong_type = manifest;
+        wrong_type["workers"] = "many";
+        writeManifest(TEST_DIR + "/wrong_type.json", wrong_type);
+        check(!runner.ReadManifest(TEST_DIR + "/wrong_type.json"), "manifest key of the wrong type rejected");
+    }
+
+    //batch block*********************//
+
+    nlohmann::json good_job = manifest["jobs"][0];
+
+    nlohmann::json missing_labels = good_job;
+    missing_labels["id"] = "missing_labels";
+    missing_labels["camera_labels"] = "images/does_not_exist.json";
+
+    nlohmann::json no_CAD = good_job;
+    no_CAD["id"] = "no_CAD";
+    no_CAD.erase("CAD_labels");
+
+    manifest["jobs"] = {good_job, missing_labels, no_CAD};
+    manifest["workers"] = 2;
+    manifest["results"] = "results.json";
+    check(writeManifest(TEST_DIR + "/manifest.json", manifest), "manifest written");
+
+    cam_cad::BatchRunner runner;
+    check(runner.ReadManifest(TEST_DIR + "/manifest.json"), "manifest read");
+    check(!runner.Run(), "run reports the failed jobs");
+
+    const std::vector<cam_cad::BatchJobResult>& results = runner.GetResults();
+    check(results.size() == 3, "every job has a result");
+    if (results.size() != 3) return checkResult();
+
+    std::string good_id = good_job["id"];
+    const cam_cad::BatchJobResult& good = results[0];
+    check(good.id == good_id && good.success && good.converged && good.error.empty(), "good job converged");
+
+    Eigen::Matrix4d T_truth = readTransform(good_job["truth_T_CS"]);
+    double translation_error = (good.T_CS.block(0, 3, 3, 1) - T_truth.block(0, 3, 3, 1)).norm() /
+                               T_truth.block(0, 3, 3, 1).norm();
+    check(translation_error < 0.02, "good job within 2% of the true translation (" +
+          std::to_string(100 * translation_error) + "%)");
+
+    std::vector<cam_cad::LabelledShape> defects_camera;
+    cam_cad::ImageBuffer image_buffer;
+    image_buffer.readShapes(TEST_DIR + "/" + good_job["defect_labels"].get<std::string>(), &defects_camera);
+    check(good.num_defects == defects_camera.size() && good.num_defect_points > 0 && good.num_dropped_points == 0,
+          "good job defects transferred");
+
+    check(results[1].id == "missing_labels" && !results[1].success && !results[1].converged &&
+          results[1].error == "failed to read camera labels", "job with a missing label file failed");
+    check(results[2].id == "no_CAD" && !results[2].success && !results[2].error.empty(),
+          "job without CAD labels failed");
+
+    //results block*******************//
+
+    check(runner.WriteResults(), "results written");
+
+    nlohmann::json written;
+    try {
+        std::ifstream results_file(TEST_DIR + "/results.json");
+        results_file >> written;
+    }
+    catch (const nlohmann::json::exception& e) {
+        check(false, std::string("results file parsed: ") + e.what());
+        return checkResult();
+    }
+
+    check(written["num_jobs"] == 3 && written["num_converged"] == 1 && written.contains("wall_time_ms"),
+          "results summary");
+    check(written["jobs"].size() == 3, "results list every job");
+    if (written["jobs"].size() != 3) return checkResult();
+
+    const nlohmann::json& good_json = written["jobs"][0];
+    bool same_pose = good_json["T_CS"].size() == 16 && readTransform(good_json["T_CS"]) == good.T_CS;
+    check(good_json["id"] == good_id && good_json["success"] == true && good_json["converged"] == true &&
+          good_json["error"] == "" && same_pose, "good job results");
+    check(good_json["solution_iterations"] == good.solution_iterations &&
+          good_json["initial_pixel_error"] == good.initial_pixel_error &&
+          good_json["num_defects"] == good.num_defects, "good job solution statistics");
+
+    bool timings = true;
+    for (std::string stage : {"read", "solve", "transfer", "write", "total"})
+        timings &= good_json["timing_ms"].contains(stage) && good_json["timing_ms"][stage] >= 0;
+    check(timings && good_json["timing_ms"]["total"] > 0, "good job timings");
+
+    const nlohmann::json& bad_json = written["jobs"][1];
+    check(bad_json["id"] == "missing_labels" && bad_json["success"] == false && bad_json["converged"] == false &&
+          bad_json["error"] == "failed to read camera labels", "failed job results");
+    check(written["jobs"][2]["id"] == "no_CAD" && written["jobs"][2]["error"] != "", "job without CAD results");
+
+    return checkResult();
+}
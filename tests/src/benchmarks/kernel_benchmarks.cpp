@@ -0,0 +1,406 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include "ImageBuffer.h"
+#include "visualizer.h"
+#include "Solver.h"
+#include "solver_stages.h"
+#include "util.h"
+#include <benchmark/benchmark.h>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+
+/**
+ * @brief microbenchmarks for the kernels of the pose estimation and defect transfer.
+ * All inputs are synthetic and generated with a fixed seed: a planar CAD cloud viewed by the
+ * Radtan_test camera model from a known pose, the matching (noisy) camera cloud, label files and
+ * a blank image, so the numbers are comparable between runs and between commits.
+ * Each kernel is run over a range of cloud sizes and reports points per second.
+ *
+ * usage: kernel_benchmarks [google benchmark options, e.g. --benchmark_filter=CorrEst
+ *                           --benchmark_out=results.json --benchmark_out_format=json]
+ */
+
+#ifndef CAM_CAD_CONFIG_DIR
+#define CAM_CAD_CONFIG_DIR "config"
+#endif
+
+const int64_t MIN_POINTS = 1 << 8;
+const int64_t MAX_POINTS = 1 << 21;
+// the random label points are far apart, densifyPoints adds hundreds of points per segment
+const int64_t MAX_DENSIFY_POINTS = 1 << 13;
+// one ceres residual block per correspondence
+const int64_t MAX_CERES_POINTS = 1 << 15;
+
+const uint32_t SEED = 5489;
+const std::string BENCHMARK_DIR = "/tmp/cam_cad_benchmarks";
+
+/**
+ * @brief synthetic inputs of one size, generated once and shared by all benchmarks
+ */
+struct bench_data {
+    pcl::PointCloud<pcl::PointXYZ>::Ptr CAD_cloud; // centered and scaled, z = 0
+    pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud; // CAD cloud in the camera frame
+    pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud; // CAD cloud projected into the image
+    pcl::PointCloud<pcl::PointXYZ>::Ptr camera_cloud; // noisy projection (image labels)
+    pcl::CorrespondencesPtr corrs;
+    std::vector<cam_cad::point> label_points; // polyline in pixels
+    std::string label_file;
+};
+
+std::shared_ptr<cam_cad::Util> bench_util;
+std::string solution_parameters_file, image_file;
+Eigen::Matrix4d T_CS;
+
+std::string cameraModelFile () {
+    return std::string(CAM_CAD_CONFIG_DIR) + "/Radtan_test.json";
+}
+
+/**
+ * @brief writes the shared files (solution parameters pointing at the test camera model and a
+ * blank image) and loads the camera model, called once before any benchmark runs
+ */
+bool setupBenchmarks () {
+    std::error_code error;
+    std::filesystem::create_directories(BENCHMARK_DIR, error);
+    if (error) {
+        printf("failed to create %s: %s\n", BENCHMARK_DIR.c_str(), error.message().c_str());
+        return false;
+    }
+
+    nlohmann::json J;
+    std::ifstream params_in(std::string(CAM_CAD_CONFIG_DIR) + "/SolutionParameters.json");
+    if (!params_in.is_open()) {
+        printf("failed to open %s/SolutionParameters.json\n", CAM_CAD_CONFIG_DIR);
+        return false;
+    }
+    params_in >> J;
+    J["camera_intrinsics"] = cameraModelFile();
+    J["visualize"] = false;
+    J["minimizer_progress_to_stdout"] = false;
+    J["transform_progress_to_stdout"] = false;
+
+    solution_parameters_file = BENCHMARK_DIR + "/SolutionParameters.json";
+    std::ofstream params_out(solution_parameters_file);
+    params_out << J.dump(2);
+    params_out.close();
+
+    image_file = BENCHMARK_DIR + "/blank.png";
+    cv::Mat image(1536, 2048, CV_8UC3, cv::Scalar(255, 255, 255));
+    if (!cv::imwrite(image_file, image)) return false;
+
+    bench_util = std::make_shared<cam_cad::Util>();
+    bench_util->ReadCameraModel(cameraModelFile());
+
+    // camera 10 m in front of the (4 m x 3.4 m) structure, slightly rotated
+    T_CS = Eigen::Matrix4d::Identity();
+    Eigen::VectorXd perturbation(6, 1);
+    perturbation << 3, -2, 1, 0.1, -0.2, 10;
+    T_CS = bench_util->PerturbTransformDegM(T_CS, perturbation);
+
+    return true;
+}
+
+/**
+ * @brief generates (and caches) the inputs for a size
+ */
+const bench_data& getData (int64_t num_points_) {
+    static std::map<int64_t, bench_data> data_sets;
+
+    auto existing = data_sets.find(num_points_);
+    if (existing != data_sets.end()) return existing->second;
+
+    bench_data& data = data_sets[num_points_];
+    std::mt19937 gen(SEED + num_points_);
+
+    // CAD points uniformly over a 400 x 340 px drawing, centered and scaled like the solver input
+    std::uniform_real_distribution<float> unif_x(-200, 200), unif_y(-170, 170);
+    data.CAD_cloud.reset(new pcl::PointCloud<pcl::PointXYZ>);
+    for (int64_t i = 0; i < num_points_; i++)
+        data.CAD_cloud->push_back(pcl::PointXYZ(0.01 * unif_x(gen), 0.01 * unif_y(gen), 0));
+
+    data.trans_cloud = bench_util->TransformCloud(data.CAD_cloud, T_CS);
+    data.proj_cloud = bench_util->ProjectCloud(data.trans_cloud);
+
+    // image labels are the projection with a few pixels of noise
+    std::normal_distribution<float> noise(0, 2);
+    data.camera_cloud.reset(new pcl::PointCloud<pcl::PointXYZ>);
+    for (auto& point : *data.proj_cloud)
+        data.camera_cloud->push_back(pcl::PointXYZ(point.x + noise(gen), point.y + noise(gen), 0));
+
+    data.corrs.reset(new pcl::Correspondences);
+    bench_util->getCorrespondences(data.corrs, data.proj_cloud, data.camera_cloud, 1000);
+
+    // integer label polyline in the same format as the labelled images
+    std::uniform_int_distribution<int> unif_pixel(0, 1500);
+    nlohmann::json points = nlohmann::json::array();
+    for (int64_t i = 0; i < num_points_; i++) {
+        cam_cad::point label_point(unif_pixel(gen), unif_pixel(gen));
+        data.label_points.push_back(label_point);
+        points.push_back({int(label_point.x), int(label_point.y)});
+    }
+
+    nlohmann::json J;
+    J["shapes"] = {{{"label", "benchmark"}, {"points", points}}};
+    data.label_file = BENCHMARK_DIR + "/labels_" + std::to_string(num_points_) + ".json";
+    std::ofstream fout(data.label_file);
+    fout << J.dump();
+
+    return data;
+}
+
+static void BM_ReadPoints (benchmark::State& state) {
+    const bench_data& data = getData(state.range(0));
+    cam_cad::ImageBuffer image_buffer;
+
+    for (auto _ : state) {
+        std::vector<cam_cad::point> points;
+        image_buffer.readPoints(data.label_file, &points);
+        benchmark::DoNotOptimize(points.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ReadPoints)->RangeMultiplier(8)->Range(MIN_POINTS, MAX_POINTS)->Unit(benchmark::kMicrosecond);
+
+static void BM_DensifyPoints (benchmark::State& state) {
+    const bench_data& data = getData(state.range(0));
+    cam_cad::ImageBuffer image_buffer;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<cam_cad::point> points = data.label_points;
+        state.ResumeTiming();
+
+        image_buffer.densifyPoints(&points, 10);
+        benchmark::DoNotOptimize(points.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DensifyPoints)->RangeMultiplier(8)->Range(MIN_POINTS, MAX_DENSIFY_POINTS)->Unit(benchmark::kMicrosecond);
+
+static void BM_SimplifyPoints (benchmark::State& state) {
+    const bench_data& data = getData(state.range(0));
+    cam_cad::ImageBuffer image_buffer;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<cam_cad::point> points = data.label_points;
+        state.ResumeTiming();
+
+        image_buffer.simplifyPoints(&points, 1);
+        benchmark::DoNotOptimize(points.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SimplifyPoints)->RangeMultiplier(8)->Range(MIN_POINTS, MAX_POINTS)->Unit(benchmark::kMicrosecond);
+
+static void BM_TransformCloud (benchmark::State& state) {
+    const bench_data& data = getData(state.range(0));
+
+    for (auto _ : state) {
+        pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud =
+            bench_util->TransformCloud(data.CAD_cloud, T_CS);
+        benchmark::DoNotOptimize(trans_cloud->points.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransformCloud)->RangeMultiplier(8)->Range(MIN_POINTS, MAX_POINTS)->Unit(benchmark::kMicrosecond);
+
+static void BM_ProjectCloud (benchmark::State& state) {
+    const bench_data& data = getData(state.range(0));
+
+    for (auto _ : state) {
+        pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud = bench_util->ProjectCloud(data.trans_cloud);
+        benchmark::DoNotOptimize(proj_cloud->points.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ProjectCloud)->RangeMultiplier(8)->Range(MIN_POINTS, MAX_POINTS)->Unit(benchmark::kMicrosecond);
+
+static void BM_CorrEst (benchmark::State& state) {
+    const bench_data& data = getData(state.range(0));
+
+    for (auto _ : state) {
+        pcl::CorrespondencesPtr corrs (new pcl::Correspondences);
+        bench_util->CorrEst(data.CAD_cloud, data.camera_cloud, T_CS, corrs, "centroid");
+        benchmark::DoNotOptimize(corrs->data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CorrEst)->RangeMultiplier(8)->Range(MIN_POINTS, MAX_POINTS)->Unit(benchmark::kMicrosecond);
+
+// same as BM_CorrEst with the buffers and search tree of a warm workspace, as in the solver loop
+static void BM_CorrEstWorkspace (benchmark::State& state) {
+    const bench_data& data = getData(state.range(0));
+
+    cam_cad::SolverWorkspace workspace;
+    workspace.BeginProblem(data.CAD_cloud->size(), data.camera_cloud->size());
+    pcl::CorrespondencesPtr corrs = workspace.GetCorrespondences();
+
+    for (auto _ : state) {
+        bench_util->CorrEst(data.CAD_cloud, data.camera_cloud, T_CS, corrs, "centroid", workspace);
+        benchmark::DoNotOptimize(corrs->data());
+    }
+
+    workspace.Update();
+    state.counters["allocations"] = workspace.GetStats().num_allocations;
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CorrEstWorkspace)->RangeMultiplier(8)->Range(MIN_POINTS, MAX_POINTS)->Unit(benchmark::kMicrosecond);
+
+// same as BM_CorrEstWorkspace with the float32 transform and projection
+static void BM_CorrEstFloat (benchmark::State& state) {
+    const bench_data& data = getData(state.range(0));
+
+    cam_cad::Util util;
+    util.ReadCameraModel(cameraModelFile());
+    util.SetFloatPrecision(true);
+
+    cam_cad::SolverWorkspace workspace;
+    workspace.BeginProblem(data.CAD_cloud->size(), data.camera_cloud->size());
+    pcl::CorrespondencesPtr corrs = workspace.GetCorrespondences();
+
+    for (auto _ : state) {
+        util.CorrEst(data.CAD_cloud, data.camera_cloud, T_CS, corrs, "centroid", workspace);
+        benchmark::DoNotOptimize(corrs->data());
+    }
+
+    state.counters["float_projection"] = util.UsesFloatProjection();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CorrEstFloat)->RangeMultiplier(8)->Range(MIN_POINTS, MAX_POINTS)->Unit(benchmark::kMicrosecond);
+
+static void BM_GetCorrespondences (benchmark::State& state) {
+    const bench_data& data = getData(state.range(0));
+
+    for (auto _ : state) {
+        pcl::CorrespondencesPtr corrs (new pcl::Correspondences);
+        bench_util->getCorrespondences(corrs, data.proj_cloud, data.camera_cloud, 1000);
+        benchmark::DoNotOptimize(corrs->data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetCorrespondences)->RangeMultiplier(8)->Range(MIN_POINTS, MAX_POINTS)->Unit(benchmark::kMicrosecond);
+
+static void BM_BuildCeresProblem (benchmark::State& state) {
+    const bench_data& data = getData(state.range(0));
+
+    std::shared_ptr<cam_cad::Util> util (new cam_cad::Util);
+    std::shared_ptr<cam_cad::Visualizer> vis (new cam_cad::Visualizer ("benchmark"));
+    cam_cad::SolverStages solver(vis, util, solution_parameters_file);
+    solver.LoadInitialPose(T_CS);
+
+    for (auto _ : state) {
+        std::shared_ptr<ceres::Problem> problem = solver.SetupCeresOptions();
+        solver.BuildCeresProblem(problem, data.corrs, util->GetCameraModel(),
+                                 data.camera_cloud, data.CAD_cloud);
+        benchmark::DoNotOptimize(problem.get());
+    }
+
+    state.SetItemsProcessed(state.iterations() * data.corrs->size());
+}
+BENCHMARK(BM_BuildCeresProblem)->RangeMultiplier(8)->Range(MIN_POINTS, MAX_CERES_POINTS)->Unit(benchmark::kMicrosecond);
+
+static void BM_SolveCeresProblem (benchmark::State& state) {
+    const bench_data& data = getData(state.range(0));
+
+    std::shared_ptr<cam_cad::Util> util (new cam_cad::Util);
+    std::shared_ptr<cam_cad::Visualizer> vis (new cam_cad::Visualizer ("benchmark"));
+    cam_cad::SolverStages solver(vis, util, solution_parameters_file);
+
+    for (auto _ : state) {
+        // every solution starts from the same pose on a freshly built problem
+        state.PauseTiming();
+        solver.LoadInitialPose(T_CS);
+        std::shared_ptr<ceres::Problem> problem = solver.SetupCeresOptions();
+        solver.BuildCeresProblem(problem, data.corrs, util->GetCameraModel(),
+                                 data.camera_cloud, data.CAD_cloud);
+        state.ResumeTiming();
+
+        solver.SolveCeresProblem(problem, false);
+    }
+
+    state.SetItemsProcessed(state.iterations() * data.corrs->size());
+}
+BENCHMARK(BM_SolveCeresProblem)->RangeMultiplier(8)->Range(MIN_POINTS, MAX_CERES_POINTS)->Unit(benchmark::kMillisecond);
+
+static void BM_BackProject (benchmark::State& state) {
+    const bench_data& data = getData(state.range(0));
+
+    for (auto _ : state) {
+        pcl::PointCloud<pcl::PointXYZ>::Ptr back_projected =
+            bench_util->BackProject(data.camera_cloud, T_CS);
+        benchmark::DoNotOptimize(back_projected->points.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BackProject)->RangeMultiplier(8)->Range(MIN_POINTS, MAX_POINTS)->Unit(benchmark::kMicrosecond);
+
+// the camera cloud split into 256 labelled defects, transferred to CAD pixels together
+static void BM_TransferShapes (benchmark::State& state) {
+    const bench_data& data = getData(state.range(0));
+    const size_t num_defects = 256;
+
+    std::vector<cam_cad::LabelledShape> defects(num_defects);
+    for (size_t i = 0; i < data.camera_cloud->size(); i++) {
+        const pcl::PointXYZ& p = data.camera_cloud->at(i);
+        defects[i * num_defects / data.camera_cloud->size()].points.push_back(cam_cad::point(p.x, p.y));
+    }
+
+    cam_cad::Util util;
+    util.ReadCameraModel(cameraModelFile());
+    util.SetCloudOffsetxy(0, 0);
+
+    for (auto _ : state) {
+        std::vector<cam_cad::LabelledShape> defects_CAD;
+        util.TransferShapes(defects, T_CS, 0.01, &defects_CAD);
+        benchmark::DoNotOptimize(defects_CAD.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransferShapes)->RangeMultiplier(8)->Range(MIN_POINTS, MAX_POINTS)->Unit(benchmark::kMicrosecond);
+
+static void BM_WriteToImage (benchmark::State& state) {
+    const bench_data& data = getData(state.range(0));
+    cam_cad::ImageBuffer image_buffer;
+    std::string target_file = BENCHMARK_DIR + "/annotated.png";
+
+    for (auto _ : state) {
+        std::vector<cam_cad::point> points = data.label_points;
+        image_buffer.writeToImage(&points, image_file, target_file, "red");
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_WriteToImage)->RangeMultiplier(8)->Range(MIN_POINTS, MAX_POINTS)->Unit(benchmark::kMillisecond);
+
+int main (int argc, char** argv) {
+
+    benchmark::Initialize(&argc, argv);
+
+    if (!setupBenchmarks()) {
+        printf("failed to set up benchmark inputs in %s\n", BENCHMARK_DIR.c_str());
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include "EdgeMap.h"
+#include "test_check.h"
+#include <cmath>
+#include <string>
+
+/**
+ * @brief Program to test the edge map input mode on a synthetic camera image: a bright
+ * rectangle on a dark background, with a noise-free outline of about 10^4 edge pixels at full
+ * resolution. The edges of every level must lie on the outline, respect the point budget and
+ * the region of interest, and get fewer with every coarser level.
+ * The program returns 1 if any check fails.
+ */
+
+const cv::Rect outline(400, 300, 3000, 2000);
+
+// distance of a point to the rectangle outline in pixels
+double outlineDistance (const cam_cad::point& p_) {
+    double left = std::abs(p_.x - outline.x), right = std::abs(p_.x - (outline.x + outline.width));
+    double top = std::abs(p_.y - outline.y), bottom = std::abs(p_.y - (outline.y + outline.height));
+    return std::min(std::min(left, right), std::min(top, bottom));
+}
+
+int main () {
+
+    cv::Mat image(2600, 3800, CV_8UC1, cv::Scalar(0));
+    cv::rectangle(image, outline, cv::Scalar(255), cv::FILLED);
+
+    //full image block****************//
+
+    cam_cad::EdgeMapParameters params;
+    params.max_points = 2000;
+    params.num_levels = 4;
+
+    cam_cad::EdgeMap edge_map(params);
+    check(edge_map.Extract(image), "edges extracted");
+    check(edge_map.GetNumLevels() == 4, "4 levels extracted");
+    check(edge_map.GetNumEdgePixels(0) > params.max_points,
+          std::to_string(edge_map.GetNumEdgePixels(0)) + " edge pixels at full resolution");
+
+    for (uint8_t level = 0; level < edge_map.GetNumLevels(); level++) {
+        std::vector<cam_cad::point> points;
+        edge_map.GetPoints(level, &points);
+
+        double max_distance = 0;
+        for (auto& p : points) max_distance = std::max(max_distance, outlineDistance(p));
+
+        // a pixel of level l covers 2^l full resolution pixels
+        double tolerance = 2.0 * (1 << level) + 1;
+
+        std::string name = "level " + std::to_string(level) + ": " + std::to_string(points.size()) + " points";
+        check(!points.empty() && points.size() <= params.max_points, name + " within budget");
+        check(max_distance <= tolerance, name + " on the outline (max " +
+              std::to_string(max_distance) + " px)");
+
+        if (level > 0)
+            check(edge_map.GetNumEdgePixels(level) < edge_map.GetNumEdgePixels(level - 1),
+                  name + " has fewer edge pixels than the finer level");
+    }
+
+    //region of interest block********//
+
+    // only the left side of the outline lies within the region of interest
+    params.roi = cv::Rect(200, 200, 600, 2200);
+    cam_cad::EdgeMap roi_map(params);
+    check(roi_map.Extract(image), "edges extracted in the region of interest");
+
+    std::vector<cam_cad::point> roi_points;
+    roi_map.GetPoints(0, &roi_points);
+
+    bool inside = !roi_points.empty();
+    for (auto& p : roi_points) {
+        if (p.x < params.roi.x || p.y < params.roi.y || p.x >= params.roi.x + params.roi.width ||
+            p.y >= params.roi.y + params.roi.height) inside = false;
+    }
+    check(inside, std::to_string(roi_points.size()) + " points inside the region of interest");
+
+    params.roi = cv::Rect(5000, 5000, 100, 100);
+    cam_cad::EdgeMap outside_map(params);
+    check(!outside_map.Extract(image), "region of interest outside of the image rejected");
+
+    return checkResult();
+}
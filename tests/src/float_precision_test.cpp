@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include "ImageBuffer.h"
+#include "visualizer.h"
+#include "Solver.h"
+#include "util.h"
+#include "test_check.h"
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+/**
+ * @brief accuracy regression check of the float32 transform and projection path against the
+ * double path on the labelled images of tests/test_data. For every image, from its recorded pose:
+ * - the projections of the CAD cloud must agree to within 0.01 px
+ * - at least 99% of the correspondences must be identical
+ * - solutions in both precisions must agree on convergence, the solved translations to within
+ *   1 mm per m and the final pixel errors to within 0.1 px
+ * The program returns 1 if any check fails.
+ */
+
+#ifndef CAM_CAD_TEST_DATA_DIR
+#define CAM_CAD_TEST_DATA_DIR "tests/test_data"
+#endif
+
+#ifndef CAM_CAD_CONFIG_DIR
+#define CAM_CAD_CONFIG_DIR "config"
+#endif
+
+const std::vector<std::string> IMAGES = {
+    "-0.000000_-1.000000", "-0.000000_0.000000", "-0.000000_1.000000", "-1.000000_-1.000000",
+    "-1.000000_0.000000", "-1.000000_1.000000", "-3.000000_0.000000", "1.000000_-1.000000",
+    "1.000000_0.000000", "1.000000_1.000000"};
+
+struct solution {
+    bool converged;
+    Eigen::Matrix4d T_CS;
+    double final_pixel_error;
+};
+
+solution solve (bool float_precision_, std::string image_,
+                pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_,
+                pcl::PointCloud<pcl::PointXYZ>::ConstPtr camera_cloud_) {
+    std::string test_data = CAM_CAD_TEST_DATA_DIR;
+    std::shared_ptr<cam_cad::Util> util (new cam_cad::Util);
+    std::shared_ptr<cam_cad::Visualizer> vis (new cam_cad::Visualizer ("solution visualizer"));
+
+    cam_cad::Solver solver(vis, util, std::string(CAM_CAD_CONFIG_DIR) + "/SolutionParameters.json");
+    solver.SetVisualization(false);
+    solver.SetCameraModel(std::string(CAM_CAD_CONFIG_DIR) + "/Radtan_test.json");
+    solver.SetFloatPrecision(float_precision_);
+    solver.LoadInitialPose(test_data + "/poses/" + image_ + ".json", test_data + "/poses/struct_world.json");
+    solver.TransformPose(test_data + "/poses/camera_robot.json");
+
+    solution result;
+    result.converged = solver.SolveOptimization(CAD_cloud_, camera_cloud_);
+    result.T_CS = solver.GetTransform();
+    result.final_pixel_error = solver.GetFinalPixelError();
+    return result;
+}
+
+int main () {
+
+    std::string test_data = CAM_CAD_TEST_DATA_DIR;
+    std::string camera_model_file = std::string(CAM_CAD_CONFIG_DIR) + "/Radtan_test.json";
+
+    cam_cad::ImageBuffer image_buffer;
+    std::vector<cam_cad::point> CAD_points;
+    pcl::PointCloud<pcl::PointXYZ>::Ptr CAD_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+
+    if (!image_buffer.readPoints(test_data + "/labelled_images/sim_CAD.json", &CAD_points)) {
+        printf("failed to read test data from %s\n", test_data.c_str());
+        return 1;
+    }
+
+    image_buffer.densifyPoints(&CAD_points, 2);
+    image_buffer.populateCloud(&CAD_points, CAD_cloud, 0);
+
+    cam_cad::Util double_util, float_util;
+    double_util.originCloudxy(CAD_cloud);
+    double_util.ReadCameraModel(camera_model_file);
+    float_util.ReadCameraModel(camera_model_file);
+    float_util.SetFloatPrecision(true);
+
+    check(!double_util.UsesFloatProjection(), "double path projects in double");
+    check(float_util.UsesFloatProjection(), "float projection validated for Radtan_test");
+
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_const = CAD_cloud;
+    pcl::PointCloud<pcl::PointXYZ>::Ptr CAD_cloud_scaled = double_util.ScaleCloud(CAD_cloud_const, 0.01);
+
+    for (auto& image : IMAGES) {
+        std::vector<cam_cad::point> camera_points;
+        pcl::PointCloud<pcl::PointXYZ>::Ptr camera_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+
+        if (!image_buffer.readPoints(test_data + "/labelled_images/" + image + ".json", &camera_points)) {
+            check(false, image + ": read camera labels");
+            continue;
+        }
+
+        image_buffer.densifyPoints(&camera_points, 10);
+        image_buffer.populateCloud(&camera_points, camera_cloud, 0);
+
+        //projection block****************//
+
+        cam_cad::Solver pose_reader(std::make_shared<cam_cad::Visualizer>("solution visualizer"),
+                                    std::make_shared<cam_cad::Util>(),
+                                    std::string(CAM_CAD_CONFIG_DIR) + "/SolutionParameters.json");
+        pose_reader.LoadInitialPose(test_data + "/poses/" + image + ".json",
+                                    test_data + "/poses/struct_world.json");
+        pose_reader.TransformPose(test_data + "/poses/camera_robot.json");
+        Eigen::Matrix4d T_CS = pose_reader.GetTransform();
+
+        cam_cad::SolverWorkspace double_workspace, float_workspace;
+        double_workspace.BeginProblem(CAD_cloud_scaled->size(), camera_cloud->size());
+        float_workspace.BeginProblem(CAD_cloud_scaled->size(), camera_cloud->size());
+
+        pcl::CorrespondencesPtr double_corrs = double_workspace.GetCorrespondences();
+        pcl::CorrespondencesPtr float_corrs = float_workspace.GetCorrespondences();
+
+        double_util.CorrEst(CAD_cloud_scaled, camera_cloud, T_CS, double_corrs, "centroid", double_workspace);
+        float_util.CorrEst(CAD_cloud_scaled, camera_cloud, T_CS, float_corrs, "centroid", float_workspace);
+
+        pcl::PointCloud<pcl::PointXYZ>::Ptr double_proj = double_workspace.GetProjectedCloud();
+        pcl::PointCloud<pcl::PointXYZ>::Ptr float_proj = float_workspace.GetProjectedCloud();
+
+        bool same_size = double_proj->size() == float_proj->size();
+        double max_difference = 0;
+        for (size_t i = 0; same_size && i < double_proj->size(); i++) {
+            max_difference = std::max<double>(max_difference, std::hypot(
+                double_proj->at(i).x - float_proj->at(i).x, double_proj->at(i).y - float_proj->at(i).y));
+        }
+
+        check(same_size && max_difference < 0.01, image + ": projections agree (max " +
+              std::to_string(max_difference) + " px)");
+
+        size_t num_same = 0;
+        if (double_corrs->size() == float_corrs->size()) {
+            for (size_t i = 0; i < double_corrs->size(); i++) {
+                if (double_corrs->at(i).index_query == float_corrs->at(i).index_query &&
+                    double_corrs->at(i).index_match == float_corrs->at(i).index_match) num_same++;
+            }
+        }
+        double same_fraction = double(num_same) / std::max<size_t>(double_corrs->size(), 1);
+
+        check(same_fraction >= 0.99, image + ": " + std::to_string(100 * same_fraction) +
+              "% identical correspondences");
+
+        //Solver Block*******************//
+
+        solution double_solution = solve(false, image, CAD_cloud, camera_cloud);
+        solution float_solution = solve(true, image, CAD_cloud, camera_cloud);
+
+        Eigen::Vector3d double_t = double_solution.T_CS.block(0, 3, 3, 1);
+        Eigen::Vector3d float_t = float_solution.T_CS.block(0, 3, 3, 1);
+        double translation_difference = (double_t - float_t).norm() / std::max(double_t.norm(), 1e-9);
+        double error_difference =
+            std::abs(double_solution.final_pixel_error - float_solution.final_pixel_error);
+
+        check(double_solution.converged == float_solution.converged, image + ": same convergence (" +
+              std::string(double_solution.converged ? "converged" : "not converged") + ")");
+        check(translation_difference < 1e-3, image + ": solved translations agree (" +
+              std::to_string(1000 * translation_difference) + " mm/m)");
+        check(error_difference < 0.1, image + ": final pixel errors agree (" +
+              std::to_string(error_difference) + " px)");
+    }
+
+    return checkResult();
+}
@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include "ScenarioGenerator.h"
+
+/**
+ * @brief program to generate a synthetic dataset (CAD faces, camera labels, defects, ground 
+ * truth poses and a batch manifest) for load and scaling tests 
+ * usage: generate_scenarios <scenario.json> <output dir> [-n images] [-s seed] [-j workers]
+ * see config/example_scenario.json and ScenarioGenerator.h for the parameters. The generated 
+ * manifest can be run directly with beam_2DCAD_projection <output dir>/manifest.json
+ */
+int main (int argc, char** argv) {
+
+    if (argc < 3) {
+        printf("usage: %s <scenario.json> <output dir> [-n images] [-s seed] [-j workers]\n", argv[0]);
+        return 1;
+    }
+
+    cam_cad::ScenarioGenerator generator;
+
+    if (!generator.ReadConfig(argv[1])) return 1;
+
+    cam_cad::ScenarioConfig config = generator.GetConfig();
+    uint16_t num_workers = 0;
+
+    // overrides, so one configuration can produce datasets of any size
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) config.num_images = std::stoul(argv[++i]);
+        else if (arg == "-s" && i + 1 < argc) config.seed = std::stoul(argv[++i]);
+        else if (arg == "-j" && i + 1 < argc) num_workers = std::stoi(argv[++i]);
+        else {
+            printf("unknown argument: %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    generator.SetConfig(config);
+
+    return generator.Generate(argv[2], num_workers) ? 0 : 1;
+}
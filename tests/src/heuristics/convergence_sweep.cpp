@@ -0,0 +1,401 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include "ImageBuffer.h"
+#include "visualizer.h"
+#include "Solver.h"
+#include "util.h"
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief benchmark program to find the convergence rate with respect to the initial perturbation
+ * from a known good pose, the number of ceres iterations at each step of the overall solution
+ * and the solution parameters.
+ * The reference pose is found by solving once from the recorded pose of the test image,
+ * perturbations are then applied to it in 5 levels:
+ * level  translation (% of largest translation in reference)  rotation (degrees)
+ *     1                                                  0-5                 0-2
+ *     2                                                 5-10                 2-5
+ *     3                                                10-15                 5-8
+ *     4                                                15-20                8-10
+ *     5                                                20-25               10-12
+ * every component of a perturbation is drawn from the level band with a random sign. The
+ * perturbations only depend on the seed, the level and their index, so every sweep (and every
+ * run with the same seed) solves from exactly the same initial poses regardless of the number of workers.
+ * Each (solution parameters, max ceres iterations, level, perturbation) run is solved independently
+ * on a pool of worker threads.
+ *
+ * usage: convergence_sweep [-j workers] [-s seed] [-n perturbations per level]
+ *                          [-i max ceres iterations list, e.g. 5,10,25]
+ *                          [-c solution parameters file]... [-o results.csv | results.json]
+ *                          [-r renderings directory]
+ *
+ * Results (success rate, solution iterations, final pixel error and wall time for each
+ * parameters file, iteration limit and level) are written as CSV or, for a .json output, as
+ * json with the individual runs included. Visualization is always disabled, with -r every run is
+ * rendered headlessly to its own png sequence <renderings directory>/c<parameters file index>_i<max
+ * ceres iterations>_l<level>_p<perturbation>.
+ */
+
+#ifndef CAM_CAD_TEST_DATA_DIR
+#define CAM_CAD_TEST_DATA_DIR "tests/test_data"
+#endif
+
+#ifndef CAM_CAD_CONFIG_DIR
+#define CAM_CAD_CONFIG_DIR "config"
+#endif
+
+const uint8_t NUM_LEVELS = 5;
+
+struct sweep_run {
+    uint32_t config;
+    uint16_t max_ceres_iterations;
+    uint8_t level;
+    uint32_t perturbation;
+    bool converged;
+    int solution_iterations;
+    double initial_pixel_error;
+    double final_pixel_error;
+    double wall_ms;
+};
+
+Eigen::Matrix4d perturbPose (const Eigen::Matrix4d& T_, uint32_t seed_, uint8_t level_,
+                             uint32_t perturbation_, double max_translation_);
+
+bool writeResults (std::string file_name_, const std::vector<sweep_run>& runs_,
+                   const std::vector<std::string>& configs_,
+                   const std::vector<uint16_t>& max_ceres_iterations_, uint32_t seed_);
+
+cam_cad::Util mainUtility;
+
+int main (int argc, char** argv) {
+
+    uint32_t num_workers = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t seed = 5489;
+    uint32_t num_perturbations = 100;
+    std::vector<uint16_t> max_ceres_iterations {25};
+    std::vector<std::string> configs;
+    std::string results_file = "convergence_sweep.csv";
+    std::string renderings_dir;
+
+    std::string test_data = CAM_CAD_TEST_DATA_DIR;
+    std::string camera_file_location = test_data + "/labelled_images/-3.000000_0.000000.json";
+    std::string CAD_file_location = test_data + "/labelled_images/sim_CAD.json";
+    std::string robot_pose_location = test_data + "/poses/-3.000000_0.000000.json";
+    std::string struct_pose_location = test_data + "/poses/struct_world.json";
+    std::string camera_robot_location = test_data + "/poses/camera_robot.json";
+    std::string camera_model_location = std::string(CAM_CAD_CONFIG_DIR) + "/Radtan_test.json";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) num_workers = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "-s" && i + 1 < argc) seed = std::stoul(argv[++i]);
+        else if (arg == "-n" && i + 1 < argc) num_perturbations = std::stoul(argv[++i]);
+        else if (arg == "-c" && i + 1 < argc) configs.push_back(argv[++i]);
+        else if (arg == "-o" && i + 1 < argc) results_file = argv[++i];
+        else if (arg == "-r" && i + 1 < argc) renderings_dir = argv[++i];
+        else if (arg == "-i" && i + 1 < argc) {
+            max_ceres_iterations.clear();
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ','))
+                max_ceres_iterations.push_back(std::stoi(item));
+        }
+        else {
+            printf("unknown argument: %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    if (configs.empty())
+        configs.push_back(std::string(CAM_CAD_CONFIG_DIR) + "/SolutionParameters.json");
+
+    if (!renderings_dir.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(renderings_dir, error);
+        if (error) {
+            printf("failed to create %s: %s\n", renderings_dir.c_str(), error.message().c_str());
+            return 1;
+        }
+    }
+
+    //image and CAD data input block//
+
+    cam_cad::ImageBuffer ImageBuffer;
+    std::vector<cam_cad::point> input_points_camera, input_points_CAD;
+    pcl::PointCloud<pcl::PointXYZ>::Ptr input_cloud_camera (new pcl::PointCloud<pcl::PointXYZ>);
+    pcl::PointCloud<pcl::PointXYZ>::Ptr input_cloud_CAD (new pcl::PointCloud<pcl::PointXYZ>);
+
+    if (!ImageBuffer.readPoints(camera_file_location, &input_points_camera) ||
+        !ImageBuffer.readPoints(CAD_file_location, &input_points_CAD)) {
+        printf("failed to read test data from %s\n", test_data.c_str());
+        return 1;
+    }
+
+    ImageBuffer.densifyPoints(&input_points_camera, 10);
+    ImageBuffer.densifyPoints(&input_points_CAD, 2);
+
+    ImageBuffer.populateCloud(&input_points_camera, input_cloud_camera, 0);
+    ImageBuffer.populateCloud(&input_points_CAD, input_cloud_CAD, 0);
+
+    mainUtility.originCloudxy(input_cloud_CAD);
+
+    //reference pose block************//
+
+    // solve once from the recorded pose, the solution is the pose all perturbations are applied to
+    std::vector<Eigen::Matrix4d> reference_poses;
+
+    for (auto& config : configs) {
+        std::shared_ptr<cam_cad::Util> solverUtility (new cam_cad::Util);
+        std::shared_ptr<cam_cad::Visualizer> solverVisualizer
+            (new cam_cad::Visualizer ("solution visualizer"));
+
+        cam_cad::Solver solver(solverVisualizer, solverUtility, config);
+        solver.SetVisualization(false);
+        solver.SetCameraModel(camera_model_location);
+        solver.LoadInitialPose(robot_pose_location, struct_pose_location);
+        solver.TransformPose(camera_robot_location);
+
+        if (!solver.SolveOptimization(input_cloud_CAD, input_cloud_camera)) {
+            printf("reference solution did not converge for %s\n", config.c_str());
+            return 1;
+        }
+
+        reference_poses.push_back(solver.GetTransform());
+    }
+
+    //sweep block*********************//
+
+    std::vector<sweep_run> runs;
+
+    for (uint32_t config = 0; config < configs.size(); config++)
+        for (auto max_iterations : max_ceres_iterations)
+            for (uint8_t level = 0; level < NUM_LEVELS; level++)
+                for (uint32_t perturbation = 0; perturbation < num_perturbations; perturbation++) {
+                    sweep_run run;
+                    run.config = config;
+                    run.max_ceres_iterations = max_iterations;
+                    run.level = level;
+                    run.perturbation = perturbation;
+                    runs.push_back(run);
+                }
+
+    printf("running %zu solutions on %u workers \n", runs.size(), num_workers);
+
+    std::atomic<size_t> next_run {0};
+
+    auto worker = [&]() {
+        for (size_t i = next_run++; i < runs.size(); i = next_run++) {
+            sweep_run& run = runs[i];
+            const Eigen::Matrix4d& reference = reference_poses[run.config];
+
+            double max_translation = reference.block(0, 3, 3, 1).cwiseAbs().maxCoeff();
+
+            Eigen::Matrix4d init_T = perturbPose(reference, seed, run.level,
+                                                 run.perturbation, max_translation);
+
+            auto start = std::chrono::steady_clock::now();
+
+            std::shared_ptr<cam_cad::Util> solverUtility_i (new cam_cad::Util);
+            std::shared_ptr<cam_cad::Visualizer> solverVisualizer_i
+                (new cam_cad::Visualizer ("solution visualizer"));
+
+            cam_cad::Solver solver_i(solverVisualizer_i, solverUtility_i, configs[run.config]);
+
+            solver_i.SetVisualization(false);
+            solver_i.SetCameraModel(camera_model_location);
+            solver_i.LoadInitialPose(init_T);
+            solver_i.SetMaxMinimizerIterations(run.max_ceres_iterations);
+
+            // the workers solve side by side, every run renders to its own directory
+            if (!renderings_dir.empty()) {
+                std::string output = renderings_dir + "/c" + std::to_string(run.config) + 
+                    "_i" + std::to_string(run.max_ceres_iterations) + "_l" + std::to_string(run.level + 1) + 
+                    "_p" + std::to_string(run.perturbation);
+                solver_i.SetRenderer(std::make_shared<cam_cad::ConvergenceRenderer>(output));
+            }
+
+            run.converged = solver_i.SolveOptimization(input_cloud_CAD, input_cloud_camera);
+
+            run.wall_ms = std::chrono::duration<double, std::milli>
+                (std::chrono::steady_clock::now() - start).count();
+            run.solution_iterations = solver_i.GetSolutionIterations();
+            run.initial_pixel_error = solver_i.GetInitialPixelError();
+            run.final_pixel_error = solver_i.GetFinalPixelError();
+        }
+    };
+
+    auto sweep_start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < num_workers; i++)
+        workers.emplace_back(worker);
+    for (auto& thread : workers)
+        thread.join();
+
+    double sweep_s = std::chrono::duration<double>
+        (std::chrono::steady_clock::now() - sweep_start).count();
+
+    printf("sweep finished in %.1f s \n", sweep_s);
+
+    if (!writeResults(results_file, runs, configs, max_ceres_iterations, seed)) return 1;
+
+    printf("results written to %s \n", results_file.c_str());
+
+    return 0;
+}
+
+Eigen::Matrix4d perturbPose (const Eigen::Matrix4d& T_, uint32_t seed_, uint8_t level_,
+                             uint32_t perturbation_, double max_translation_) {
+
+    double min_translations_level[NUM_LEVELS] = {0, 0.05, 0.10, 0.15, 0.20};
+    double max_translations_level[NUM_LEVELS] = {0.05, 0.10, 0.15, 0.20, 0.25};
+    double min_rotations_level[NUM_LEVELS] = {0, 2, 5, 8, 10};
+    double max_rotations_level[NUM_LEVELS] = {2, 5, 8, 10, 12};
+
+    // each perturbation has its own generator so it does not depend on the order runs are solved in
+    std::seed_seq seq {seed_, uint32_t(level_), perturbation_};
+    std::mt19937 gen(seq);
+
+    std::uniform_real_distribution<double> trans_unif
+        (min_translations_level[level_] * max_translation_,
+         max_translations_level[level_] * max_translation_);
+    std::uniform_real_distribution<double> rot_unif
+        (min_rotations_level[level_], max_rotations_level[level_]);
+    std::bernoulli_distribution sign;
+
+    // alpha, beta, gamma, x, y, z
+    double components[6];
+
+    for (uint8_t rot = 0; rot < 3; rot++)
+        components[rot] = (sign(gen) ? 1 : -1) * rot_unif(gen);
+
+    for (uint8_t trans = 3; trans < 6; trans++)
+        components[trans] = (sign(gen) ? 1 : -1) * trans_unif(gen);
+
+    Eigen::Matrix4d init_T = T_;
+
+    Eigen::VectorXd perturbation(6, 1);
+    perturbation << components[0], 0, 0, 0, 0, 0;
+    init_T = mainUtility.PerturbTransformDegM(init_T, perturbation);
+    perturbation << 0, components[1], 0, 0, 0, 0;
+    init_T = mainUtility.PerturbTransformDegM(init_T, perturbation);
+    perturbation << 0, 0, components[2], 0, 0, 0;
+    init_T = mainUtility.PerturbTransformDegM(init_T, perturbation);
+    perturbation << 0, 0, 0, components[3], components[4], components[5];
+    init_T = mainUtility.PerturbTransformDegM(init_T, perturbation);
+
+    return init_T;
+}
+
+bool writeResults (std::string file_name_, const std::vector<sweep_run>& runs_,
+                   const std::vector<std::string>& configs_,
+                   const std::vector<uint16_t>& max_ceres_iterations_, uint32_t seed_) {
+
+    bool json_output = file_name_.size() >= 5 &&
+                       file_name_.compare(file_name_.size() - 5, 5, ".json") == 0;
+
+    nlohmann::json J;
+    J["seed"] = seed_;
+    J["summary"] = nlohmann::json::array();
+    J["runs"] = nlohmann::json::array();
+
+    std::ofstream fout(file_name_);
+
+    if (!fout.is_open()) {
+        printf("failed to open %s\n", file_name_.c_str());
+        return false;
+    }
+
+    if (!json_output)
+        fout << "config,max_ceres_iterations,level,runs,success_rate,mean_solution_iterations,"
+             << "max_solution_iterations,mean_final_pixel_error,mean_wall_ms,max_wall_ms\n";
+
+    for (uint32_t config = 0; config < configs_.size(); config++) {
+        for (auto max_iterations : max_ceres_iterations_) {
+            for (uint8_t level = 0; level < NUM_LEVELS; level++) {
+
+                uint32_t num_runs = 0, num_succeeded = 0;
+                int max_solution_iterations = 0;
+                double solution_iterations = 0, final_pixel_error = 0, wall_ms = 0, max_wall_ms = 0;
+
+                for (auto& run : runs_) {
+                    if (run.config != config || run.max_ceres_iterations != max_iterations ||
+                        run.level != level) continue;
+
+                    num_runs++;
+                    wall_ms += run.wall_ms;
+                    max_wall_ms = std::max(max_wall_ms, run.wall_ms);
+
+                    // iterations and error are only meaningful for successful solutions
+                    if (run.converged) {
+                        num_succeeded++;
+                        solution_iterations += run.solution_iterations;
+                        final_pixel_error += run.final_pixel_error;
+                        max_solution_iterations =
+                            std::max(max_solution_iterations, run.solution_iterations);
+                    }
+                }
+
+                if (num_runs == 0) continue;
+
+                double success_rate = double(num_succeeded) / num_runs;
+                if (num_succeeded > 0) {
+                    solution_iterations /= num_succeeded;
+                    final_pixel_error /= num_succeeded;
+                }
+                wall_ms /= num_runs;
+
+                if (json_output) {
+                    J["summary"].push_back({{"config", configs_[config]},
+                                            {"max_ceres_iterations", max_iterations},
+                                            {"level", level + 1},
+                                            {"runs", num_runs},
+                                            {"success_rate", success_rate},
+                                            {"mean_solution_iterations", solution_iterations},
+                                            {"max_solution_iterations", max_solution_iterations},
+                                            {"mean_final_pixel_error", final_pixel_error},
+                                            {"mean_wall_ms", wall_ms},
+                                            {"max_wall_ms", max_wall_ms}});
+                }
+                else {
+                    fout << configs_[config] << "," << max_iterations << "," << level + 1 << ","
+                         << num_runs << "," << success_rate << "," << solution_iterations << ","
+                         << max_solution_iterations << "," << final_pixel_error << ","
+                         << wall_ms << "," << max_wall_ms << "\n";
+                }
+            }
+        }
+    }
+
+    if (json_output) {
+        for (auto& run : runs_) {
+            J["runs"].push_back({{"config", configs_[run.config]},
+                                 {"max_ceres_iterations", run.max_ceres_iterations},
+                                 {"level", run.level + 1},
+                                 {"perturbation", run.perturbation},
+                                 {"converged", run.converged},
+                                 {"solution_iterations", run.solution_iterations},
+                                 {"initial_pixel_error", run.initial_pixel_error},
+                                 {"final_pixel_error", run.final_pixel_error},
+                                 {"wall_ms", run.wall_ms}});
+        }
+
+        fout << J.dump(2) << std::endl;
+    }
+
+    return true;
+}
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include "ImageBuffer.h"
+#include "visualizer.h"
+#include "Solver.h"
+#include "JointSolver.h"
+#include "util.h"
+#include "scenario_fixture.h"
+#include "test_check.h"
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <nlohmann/json.hpp>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Program to test the joint refinement of several images of one CAD face (JointSolver) on
+ * a synthetic scenario. Every image is first solved on its own with a CAD scale 5% off the true
+ * scale, which the independent solutions absorb into their camera translations. The joint
+ * refinement starts from these solutions, with the initial poses of the scenario as measured
+ * poses, and must recover the true scale to within 1% without raising the pixel errors. Without
+ * a translation prior, or with the scale refinement disabled, the scale must stay fixed.
+ * The program returns 1 if any check fails.
+ */
+
+#ifndef CAM_CAD_CONFIG_DIR
+#define CAM_CAD_CONFIG_DIR "config"
+#endif
+
+const std::string TEST_DIR = "/tmp/cam_cad_joint_refinement_test";
+const double TRUE_SCALE = 0.01;
+const double INITIAL_SCALE = 0.0095;
+
+int main () {
+
+    std::string config_dir = CAM_CAD_CONFIG_DIR;
+    std::string camera_model_file = config_dir + "/Radtan_test.json";
+
+    //scenario block******************//
+
+    cam_cad::ScenarioConfig scenario;
+    scenario.num_images = 8;
+    scenario.camera_model = camera_model_file;
+    scenario.cloud_scale = TRUE_SCALE;
+    scenario.outline_vertices = 400;
+    scenario.num_openings = 1;
+    scenario.opening_vertices = 50;
+    scenario.pixel_noise = 0.5;
+    scenario.outlier_rate = 0;
+    scenario.initial_rotation_error = 1;
+    scenario.initial_translation_error = 0.05;
+
+    nlohmann::json manifest;
+    if (!generateScenario(scenario, TEST_DIR, manifest)) {
+        check(false, "scenario generated");
+        return 1;
+    }
+
+    // solution parameters of the repository with the test camera and the wrong scale
+    nlohmann::json parameters;
+    std::ifstream parameters_file(config_dir + "/SolutionParameters.json");
+    parameters_file >> parameters;
+    parameters["camera_intrinsics"] = camera_model_file;
+    parameters["cloud_scale"] = INITIAL_SCALE;
+    parameters["joint_refinement"] = {{"refine_scale", true}, {"translation_prior_sigma", 0.05}};
+
+    std::string parameters_file_name = TEST_DIR + "/SolutionParameters.json";
+    std::ofstream parameters_out(parameters_file_name);
+    parameters_out << parameters.dump(2);
+    parameters_out.close();
+
+    cam_cad::ImageBuffer image_buffer;
+    std::vector<cam_cad::point> CAD_points;
+
+    if (!image_buffer.readPoints(TEST_DIR + "/CAD/CAD_0.json", &CAD_points)) {
+        check(false, "read CAD labels");
+        return 1;
+    }
+
+    image_buffer.densifyPoints(&CAD_points, 2);
+    pcl::PointCloud<pcl::PointXYZ>::Ptr CAD_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+    image_buffer.populateCloud(&CAD_points, CAD_cloud, 0);
+
+    cam_cad::Util CAD_util;
+    CAD_util.originCloudxy(CAD_cloud);
+
+    //independent solution block******//
+
+    std::vector<cam_cad::JointImage> images;
+    double independent_error = 0;
+
+    for (auto& job : manifest["jobs"]) {
+        std::string id = job["id"];
+        std::vector<cam_cad::point> camera_points;
+
+        if (!image_buffer.readPoints(TEST_DIR + "/" + job["camera_labels"].get<std::string>(), &camera_points)) {
+            check(false, id + ": read camera labels");
+            continue;
+        }
+
+        image_buffer.densifyPoints(&camera_points, 10);
+        pcl::PointCloud<pcl::PointXYZ>::Ptr camera_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+        image_buffer.populateCloud(&camera_points, camera_cloud, 0);
+
+        cam_cad::JointImage image;
+        image.id = id;
+        image.util = std::make_shared<cam_cad::Util>();
+        image.camera_cloud = camera_cloud;
+        image.T_CS_measured = readTransform(job["T_CS"]);
+
+        cam_cad::Solver solver(std::make_shared<cam_cad::Visualizer>("solution visualizer"), image.util,
+                               parameters_file_name);
+        solver.SetVisualization(false);
+        solver.LoadInitialPose(image.T_CS_measured);
+        solver.SolveOptimization(CAD_cloud, camera_cloud);
+
+        image.T_CS = solver.GetTransform();
+        independent_error += solver.GetFinalPixelError();
+        images.push_back(image);
+    }
+
+    check(images.size() == scenario.num_images, std::to_string(images.size()) + " images solved independently");
+    if (images.empty()) return 1;
+    independent_error /= images.size();
+
+    //joint solution block************//
+
+    std::vector<cam_cad::JointImage> joint_images = images;
+    cam_cad::JointSolver joint_solver(parameters_file_name);
+    bool converged = joint_solver.Solve(CAD_cloud, &joint_images);
+
+    double scale_error = std::abs(joint_solver.GetCloudScale() - TRUE_SCALE) / TRUE_SCALE;
+
+    check(converged, "joint solution converged in " + std::to_string(joint_solver.GetSolutionIterations()) +
+          " iterations");
+    check(scale_error < 0.01, "CAD scale " + std::to_string(joint_solver.GetCloudScale()) + " within 1% of " +
+          std::to_string(TRUE_SCALE));
+    check(joint_solver.GetFinalPixelError() <= independent_error + 0.5,
+          "pixel error " + std::to_string(joint_solver.GetFinalPixelError()) + " (independent " +
+          std::to_string(independent_error) + ")");
+
+    // with the true scale, the solved translations must match the ground truth
+    double max_translation_error = 0;
+    for (size_t i = 0; i < joint_images.size(); i++) {
+        Eigen::Matrix4d T_truth = readTransform(manifest["jobs"][i]["truth_T_CS"]);
+        Eigen::Vector3d t_error = joint_images[i].T_CS.block(0, 3, 3, 1) - T_truth.block(0, 3, 3, 1);
+        max_translation_error = std::max(max_translation_error, t_error.norm() / T_truth.block(0, 3, 3, 1).norm());
+    }
+    check(max_translation_error < 0.02, "solved translations within 2% of the ground truth (max " +
+          std::to_string(100 * max_translation_error) + "%)");
+
+    //fixed scale block***************//
+
+    std::vector<cam_cad::JointImage> fixed_images = images;
+    cam_cad::JointSolver fixed_solver(parameters_file_name);
+    fixed_solver.SetRefineScale(false);
+    fixed_solver.Solve(CAD_cloud, &fixed_images);
+    check(fixed_solver.GetCloudScale() == INITIAL_SCALE, "scale held fixed when its refinement is disabled");
+
+    std::vector<cam_cad::JointImage> unobservable_images = images;
+    cam_cad::JointSolver unobservable_solver(parameters_file_name);
+    unobservable_solver.SetTranslationPriorSigma(0);
+    unobservable_solver.Solve(CAD_cloud, &unobservable_images);
+    check(unobservable_solver.GetCloudScale() == INITIAL_SCALE, "scale held fixed without a translation prior");
+
+    return checkResult();
+}
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include "ImageBuffer.h"
+#include "visualizer.h"
+#include "Solver.h"
+#include "util.h"
+#include "test_check.h"
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <nlohmann/json.hpp>
+#include <unistd.h>
+#include <cmath>
+#include <fstream>
+#include <string>
+
+/**
+ * @brief Program to test the pipeline on clouds larger than 65535 points (multi-million point
+ * labels and dense edge maps). A label ring at high resolution coordinates (beyond 2048 px) is
+ * written in the labelled image format, read back, densified, centered and projected with the
+ * Radtan_test camera model, and the correspondence estimation and solver are run on it.
+ * Every stage checks its sizes and indices, the program returns 1 if any check fails.
+ *
+ * usage: large_cloud_test [-n label points (default 2^21)] [-s solver points (default 2^17)]
+ */
+
+#ifndef CAM_CAD_CONFIG_DIR
+#define CAM_CAD_CONFIG_DIR "config"
+#endif
+
+const std::string TEST_DIR = "/tmp/cam_cad_large_cloud_test";
+
+/**
+ * @brief ring of points in pixels, centered at (3000, 2500) with radius 150
+ */
+std::vector<cam_cad::point> ring (size_t num_points_) {
+    std::vector<cam_cad::point> points;
+    points.reserve(num_points_);
+    for (size_t i = 0; i < num_points_; i++) {
+        double angle = 2 * M_PI * i / num_points_;
+        points.push_back(cam_cad::point(3000 + 150 * std::cos(angle), 2500 + 150 * std::sin(angle)));
+    }
+    return points;
+}
+
+int main (int argc, char** argv) {
+
+    size_t num_points = 1 << 21, num_solver_points = 1 << 17;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        if (opt == 'n') num_points = std::stoul(optarg);
+        else if (opt == 's') num_solver_points = std::stoul(optarg);
+        else {
+            printf("usage: large_cloud_test [-n label points] [-s solver points]\n");
+            return 1;
+        }
+    }
+
+    std::string mkdir = "mkdir -p " + TEST_DIR;
+    if (system(mkdir.c_str()) != 0) return 1;
+
+    cam_cad::ImageBuffer image_buffer;
+    std::shared_ptr<cam_cad::Util> util (new cam_cad::Util);
+    std::string camera_model_file = std::string(CAM_CAD_CONFIG_DIR) + "/Radtan_test.json";
+    util->ReadCameraModel(camera_model_file);
+
+    //label input block***************//
+
+    std::vector<cam_cad::point> written = ring(num_points);
+
+    nlohmann::json points = nlohmann::json::array();
+    for (auto& p : written)
+        points.push_back({int(p.x), int(p.y)});
+
+    nlohmann::json J;
+    J["shapes"] = {{{"label", "large_cloud"}, {"points", points}}};
+    std::string label_file = TEST_DIR + "/labels.json";
+    std::ofstream fout(label_file);
+    fout << J.dump();
+    fout.close();
+
+    std::vector<cam_cad::point> label_points;
+    check(image_buffer.readPoints(label_file, &label_points), "read labels");
+    check(label_points.size() == num_points, "all " + std::to_string(num_points) + " label points read");
+    check(!label_points.empty() && label_points.back().x == int(written.back().x) &&
+          label_points.back().y == int(written.back().y), "last label point read in order");
+
+    // densify a sparser copy so the number of points grows past the input size
+    std::vector<cam_cad::point> sparse_points;
+    for (size_t i = 0; i < label_points.size(); i += 16)
+        sparse_points.push_back(label_points[i]);
+    size_t sparse_size = sparse_points.size();
+    image_buffer.densifyPoints(&sparse_points, 2);
+    check(sparse_points.size() >= sparse_size, "densified " + std::to_string(sparse_size) +
+          " points to " + std::to_string(sparse_points.size()));
+    check(!sparse_points.empty() && sparse_points.front().x == label_points.front().x,
+          "densified points keep their order");
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr label_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+    image_buffer.populateCloud(&label_points, label_cloud, 0);
+    check(label_cloud->size() == num_points, "label cloud populated");
+
+    // the ring lies beyond 2048 px, so centering must not depend on the image size
+    util->originCloudxy(label_cloud);
+    float max_x = -FLT_MAX, min_x = FLT_MAX;
+    for (auto& p : *label_cloud) {
+        max_x = std::max(max_x, p.x);
+        min_x = std::min(min_x, p.x);
+    }
+    check(std::abs(max_x + min_x) <= 2, "label cloud centered on the origin");
+
+    //projection block****************//
+
+    // camera 10 m in front of the structure, slightly rotated
+    Eigen::Matrix4d T_CS = Eigen::Matrix4d::Identity();
+    Eigen::VectorXd perturbation(6, 1);
+    perturbation << 3, -2, 1, 0.1, -0.2, 10;
+    T_CS = util->PerturbTransformDegM(T_CS, perturbation);
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr CAD_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+    image_buffer.populateCloud(&written, CAD_cloud, 0);
+    util->originCloudxy(CAD_cloud);
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr CAD_cloud_const = CAD_cloud;
+    pcl::PointCloud<pcl::PointXYZ>::Ptr CAD_cloud_scaled = util->ScaleCloud(CAD_cloud_const, 0.01);
+    check(CAD_cloud_scaled->size() == num_points, "CAD cloud scaled");
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud = util->TransformCloud(CAD_cloud_scaled, T_CS);
+    pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud = util->ProjectCloud(trans_cloud);
+    check(trans_cloud->size() == num_points, "CAD cloud transformed");
+    check(proj_cloud->size() == num_points, "CAD cloud projected");
+
+    // correspondences with the true pose match every point to itself
+    cam_cad::SolverWorkspace workspace;
+    workspace.BeginProblem(num_points, proj_cloud->size());
+    pcl::CorrespondencesPtr corrs = workspace.GetCorrespondences();
+    util->CorrEst(CAD_cloud_scaled, proj_cloud, T_CS, corrs, "none", workspace);
+
+    size_t max_index = 0;
+    double error = 0;
+    for (auto& corr : *corrs) {
+        max_index = std::max<size_t>(max_index, corr.index_query);
+        const pcl::PointXYZ& p = proj_cloud->at(corr.index_query);
+        const pcl::PointXYZ& q = proj_cloud->at(corr.index_match);
+        error += std::sqrt(std::pow(p.x - q.x, 2) + std::pow(p.y - q.y, 2));
+    }
+    error /= std::max<size_t>(corrs->size(), 1);
+
+    check(corrs->size() == num_points, "one correspondence per projected point");
+    check(max_index == num_points - 1, "correspondence indices reach the last point");
+    check(error < 0.5, "correspondence error " + std::to_string(error) + " px");
+
+    //Solver Block*******************//
+
+    std::vector<cam_cad::point> solver_points = ring(num_solver_points);
+    pcl::PointCloud<pcl::PointXYZ>::Ptr solver_CAD_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+    image_buffer.populateCloud(&solver_points, solver_CAD_cloud, 0);
+    util->originCloudxy(solver_CAD_cloud);
+
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr solver_CAD_cloud_const = solver_CAD_cloud;
+    pcl::PointCloud<pcl::PointXYZ>::Ptr solver_camera_cloud =
+        util->ProjectCloud(util->TransformCloud(util->ScaleCloud(solver_CAD_cloud_const, 0.01), T_CS));
+
+    nlohmann::json params;
+    std::ifstream params_in(std::string(CAM_CAD_CONFIG_DIR) + "/SolutionParameters.json");
+    if (!params_in.is_open()) {
+        printf("failed to open %s/SolutionParameters.json\n", CAM_CAD_CONFIG_DIR);
+        return 1;
+    }
+    params_in >> params;
+    params["camera_intrinsics"] = camera_model_file;
+    params["cloud_scale"] = 0.01;
+    params["visualize"] = false;
+    params["minimizer_progress_to_stdout"] = false;
+    params["transform_progress_to_stdout"] = false;
+
+    std::string params_file = TEST_DIR + "/SolutionParameters.json";
+    std::ofstream params_out(params_file);
+    params_out << params.dump(2);
+    params_out.close();
+
+    std::shared_ptr<cam_cad::Util> solver_util (new cam_cad::Util);
+    std::shared_ptr<cam_cad::Visualizer> vis (new cam_cad::Visualizer ("solution visualizer"));
+    cam_cad::Solver solver(vis, solver_util, params_file);
+
+    Eigen::Matrix4d T_initial = T_CS;
+    perturbation << 1, 1, 1, 0.05, 0.05, 0.1;
+    T_initial = util->PerturbTransformDegM(T_initial, perturbation);
+    solver.LoadInitialPose(T_initial);
+
+    bool converged = solver.SolveOptimization(solver_CAD_cloud, solver_camera_cloud);
+    check(converged, "solution with " + std::to_string(num_solver_points) + " points converged");
+    check(solver.GetFinalPixelError() < solver.GetInitialPixelError(), "solution reduced the pixel error");
+
+    solver.GetWorkspace()->PrintStats();
+
+    return checkResult();
+}
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include "ImageBuffer.h"
+#include "PoseEstimator.h"
+#include "scenario_fixture.h"
+#include "test_check.h"
+#include <Eigen/Dense>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Program to test the in-memory interface of the python module (PoseEstimator) on a
+ * synthetic scenario. Every image is solved from the label points held in memory, the solved
+ * translations must be within 2% of the ground truth, back projected pixels must lie on the
+ * structure plane and the defects transferred with the true pose must match the true CAD defects.
+ * Estimators solving in parallel threads must reproduce the sequential solutions exactly.
+ * The program returns 1 if any check fails.
+ */
+
+#ifndef CAM_CAD_CONFIG_DIR
+#define CAM_CAD_CONFIG_DIR "config"
+#endif
+
+const std::string TEST_DIR = "/tmp/cam_cad_pose_estimator_test";
+
+int main () {
+
+    std::string config_dir = CAM_CAD_CONFIG_DIR;
+    std::string camera_model_file = config_dir + "/Radtan_test.json";
+    std::string parameters_file = config_dir + "/SolutionParameters.json";
+
+    cam_cad::ScenarioConfig scenario;
+    scenario.num_images = 4;
+    scenario.camera_model = camera_model_file;
+    scenario.pixel_noise = 0;
+    scenario.outlier_rate = 0;
+
+    nlohmann::json manifest;
+    if (!generateScenario(scenario, TEST_DIR, manifest)) {
+        check(false, "scenario generated");
+        return 1;
+    }
+
+    cam_cad::ImageBuffer image_buffer;
+    std::vector<cam_cad::point> CAD_points;
+
+    if (!image_buffer.readPoints(TEST_DIR + "/CAD/CAD_0.json", &CAD_points)) {
+        check(false, "read CAD labels");
+        return 1;
+    }
+
+    cam_cad::PoseEstimator estimator(parameters_file, camera_model_file);
+
+    cam_cad::PoseSolution solution;
+    check(!estimator.Solve(&CAD_points[0].x, CAD_points.size(), Eigen::Matrix4d::Identity(), &solution),
+          "solve without a CAD face fails");
+    check(!estimator.SetCAD(nullptr, 0), "empty CAD outline rejected");
+    check(estimator.SetCAD(&CAD_points[0].x, CAD_points.size()), "CAD face set");
+
+    //sequential block****************//
+
+    std::vector<std::vector<cam_cad::point>> camera_points(manifest["jobs"].size());
+    std::vector<cam_cad::PoseSolution> solutions(manifest["jobs"].size());
+    std::vector<Eigen::Matrix4d> initial_poses;
+
+    for (size_t i = 0; i < manifest["jobs"].size(); i++) {
+        const nlohmann::json& job = manifest["jobs"][i];
+        std::string id = job["id"];
+        initial_poses.push_back(readTransform(job["T_CS"]));
+
+        if (!image_buffer.readPoints(TEST_DIR + "/" + job["camera_labels"].get<std::string>(), &camera_points[i])) {
+            check(false, id + ": read camera labels");
+            continue;
+        }
+
+        Eigen::Matrix4d T_truth = readTransform(job["truth_T_CS"]);
+
+        check(estimator.Solve(&camera_points[i][0].x, camera_points[i].size(), initial_poses[i],
+                              &solutions[i]) && solutions[i].converged,
+              id + ": converged in " + std::to_string(solutions[i].solution_iterations) + " iterations");
+
+        Eigen::Vector3d t_error = solutions[i].T_CS.block(0, 3, 3, 1) - T_truth.block(0, 3, 3, 1);
+        double translation_error = t_error.norm() / T_truth.block(0, 3, 3, 1).norm();
+        check(translation_error < 0.02, id + ": translation within 2% of the ground truth (" +
+              std::to_string(100 * translation_error) + "%)");
+
+        // back projected camera labels lie on the structure plane
+        pcl::PointCloud<pcl::PointXYZ>::Ptr back_projected =
+            estimator.BackProject(&camera_points[i][0].x, camera_points[i].size(), T_truth);
+
+        Eigen::Vector3d normal = T_truth.block(0, 2, 3, 1);
+        Eigen::Vector3d origin = T_truth.block(0, 3, 3, 1);
+        double max_plane_distance = 0;
+        for (auto& p : *back_projected)
+            max_plane_distance = std::max(max_plane_distance,
+                                          std::abs(normal.dot(Eigen::Vector3d(p.x, p.y, p.z) - origin)));
+
+        check(back_projected->size() == camera_points[i].size() && max_plane_distance < 1e-3,
+              id + ": back projected onto the structure plane (max " + std::to_string(max_plane_distance) + ")");
+
+        // defects transferred with the true pose match the true CAD defects
+        std::vector<cam_cad::LabelledShape> defects_camera, defects_truth, defects_CAD;
+        if (!image_buffer.readShapes(TEST_DIR + "/" + job["defect_labels"].get<std::string>(), &defects_camera) ||
+            !image_buffer.readShapes(TEST_DIR + "/" + job["truth_defects"].get<std::string>(), &defects_truth)) {
+            check(false, id + ": read defects");
+            continue;
+        }
+
+        estimator.TransferShapes(defects_camera, T_truth, &defects_CAD);
+
+        bool same_shapes = defects_CAD.size() == defects_truth.size();
+        double mean_error = 0;
+        size_t num_points = 0;
+        for (size_t d = 0; same_shapes && d < defects_CAD.size(); d++) {
+            same_shapes = defects_CAD[d].points.size() == defects_truth[d].points.size();
+            for (size_t p = 0; same_shapes && p < defects_CAD[d].points.size(); p++, num_points++) {
+                mean_error += std::hypot(defects_CAD[d].points[p].x - defects_truth[d].points[p].x,
+                                         defects_CAD[d].points[p].y - defects_truth[d].points[p].y);
+            }
+        }
+        mean_error /= std::max<size_t>(num_points, 1);
+
+        check(same_shapes && mean_error < 2, id + ": transferred defects match the truth (mean " +
+              std::to_string(mean_error) + " CAD px)");
+    }
+
+    //parallel block******************//
+
+    // one estimator per thread, as python thread pools use the module
+    std::vector<cam_cad::PoseSolution> parallel_solutions(solutions.size());
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < solutions.size(); i++) {
+        threads.push_back(std::thread([&, i]() {
+            if (camera_points[i].empty()) return;
+            cam_cad::PoseEstimator thread_estimator(parameters_file, camera_model_file);
+            thread_estimator.SetCAD(&CAD_points[0].x, CAD_points.size());
+            thread_estimator.Solve(&camera_points[i][0].x, camera_points[i].size(),
+                                   initial_poses[i], &parallel_solutions[i]);
+        }));
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    bool identical = true;
+    for (size_t i = 0; i < solutions.size(); i++)
+        identical &= parallel_solutions[i].T_CS == solutions[i].T_CS;
+    check(identical, "parallel estimators reproduce the sequential solutions");
+
+    return checkResult();
+}
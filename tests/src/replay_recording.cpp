@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include "visualizer.h"
+#include "SolveRecorder.h"
+#include <X11/Xlib.h> 
+
+/**
+ * @brief program to replay a solver recording (see SolveRecorder.h) in the visualizer
+ * usage: replay_recording <recording.rec>
+ * step through the recorded iterations with 'n' (next) and 'p' (previous), quit with 'q'
+ */
+int main (int argc, char** argv) {
+
+    if (argc < 2) {
+        printf("usage: %s <recording.rec>\n", argv[0]);
+        return 1;
+    }
+
+    cam_cad::SolveRecorder recorder;
+
+    if (!recorder.Load(argv[1])) return 1;
+
+    uint32_t num_frames = recorder.GetNumFrames();
+
+    printf("%u recorded iterations (%u dropped while recording)\n", num_frames, 
+           recorder.GetNumDropped());
+
+    if (num_frames == 0) return 0;
+
+    cam_cad::Visualizer vis("solution replay");
+    vis.startVis();
+
+    uint32_t index = 0;
+    char command = ' ';
+
+    while (command != 'q') {
+        cam_cad::RecordedFrame frame;
+        pcl::PointCloud<pcl::PointXYZ>::Ptr camera_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+        pcl::PointCloud<pcl::PointXYZ>::Ptr trans_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+        pcl::PointCloud<pcl::PointXYZ>::Ptr proj_cloud (new pcl::PointCloud<pcl::PointXYZ>);
+        pcl::CorrespondencesPtr corrs (new pcl::Correspondences);
+
+        recorder.GetFrame(index, frame, camera_cloud, trans_cloud, proj_cloud, corrs);
+
+        printf("\nframe %u of %u: solver iteration %u, pixel error %.2f\n", index + 1, num_frames, 
+               frame.iteration, frame.pixel_error);
+        std::string sep = "\n----------------------------------------\n";
+        std::cout << frame.T_CS << sep;
+
+        vis.displayClouds(camera_cloud, trans_cloud, proj_cloud, corrs, 
+                          "camera_cloud", "transformed_cloud", "projected_cloud");
+
+        command = ' ';
+        while (command != 'n' && command != 'p' && command != 'q') 
+            std::cin >> command;
+
+        if (command == 'n' && index + 1 < num_frames) index++;
+        if (command == 'p' && index > 0) index--;
+    }
+
+    vis.endVis();
+
+    return 0;
+}
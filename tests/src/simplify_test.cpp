@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include "ImageBuffer.h"
+#include "test_check.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Program to test the simplification of label outlines (ImageBuffer::simplifyPoints) on
+ * densely sampled synthetic outlines and on the labels of tests/test_data. For every outline and
+ * tolerance, the distance of every input point to the simplified outline must be within the
+ * tolerance, the reported deviation must match the measured one and near-collinear points must
+ * be removed. The program returns 1 if any check fails.
+ */
+
+#ifndef CAM_CAD_TEST_DATA_DIR
+#define CAM_CAD_TEST_DATA_DIR "tests/test_data"
+#endif
+
+double segmentDistance (const cam_cad::point& p_, const cam_cad::point& a_, const cam_cad::point& b_) {
+    double dx = b_.x - a_.x, dy = b_.y - a_.y;
+    double length2 = dx * dx + dy * dy;
+    double t = (length2 > 0) ? std::min(1.0, std::max(0.0, ((p_.x - a_.x) * dx + (p_.y - a_.y) * dy) / length2)) : 0;
+    return std::hypot(p_.x - (a_.x + t * dx), p_.y - (a_.y + t * dy));
+}
+
+// largest distance of an input point to the simplified outline
+double measureDeviation (const std::vector<cam_cad::point>& input_,
+                         const std::vector<cam_cad::point>& simplified_, bool closed_) {
+    size_t num_segments = closed_ ? simplified_.size() : simplified_.size() - 1;
+    double max_deviation = 0;
+
+    for (auto& p : input_) {
+        double distance = HUGE_VAL;
+        for (size_t i = 0; i < num_segments; i++)
+            distance = std::min(distance, segmentDistance(p, simplified_[i], simplified_[(i + 1) % simplified_.size()]));
+        max_deviation = std::max(max_deviation, distance);
+    }
+
+    return max_deviation;
+}
+
+void checkOutline (std::string name_, const std::vector<cam_cad::point>& input_, float tolerance_,
+                   bool closed_, double min_removed_fraction_) {
+    cam_cad::ImageBuffer image_buffer;
+    std::vector<cam_cad::point> simplified = input_;
+    float reported = -1;
+
+    size_t num_removed = image_buffer.simplifyPoints(&simplified, tolerance_, closed_, &reported);
+    double measured = measureDeviation(input_, simplified, closed_);
+
+    name_ += " (" + std::to_string(tolerance_) + " px)";
+
+    check(num_removed + simplified.size() == input_.size(), name_ + ": removed points counted");
+    check(double(num_removed) >= min_removed_fraction_ * input_.size(),
+          name_ + ": " + std::to_string(num_removed) + " of " + std::to_string(input_.size()) + " points removed");
+    check(measured <= tolerance_ + 1e-3, name_ + ": max deviation " + std::to_string(measured) + " px");
+    check(reported >= 0 && reported <= tolerance_ && std::abs(reported - measured) < 1e-3,
+          name_ + ": reported deviation " + std::to_string(reported) + " px");
+    check(simplified.front().x == input_.front().x && simplified.front().y == input_.front().y,
+          name_ + ": first point kept");
+
+    if (!closed_)
+        check(simplified.back().x == input_.back().x && simplified.back().y == input_.back().y,
+              name_ + ": last point kept");
+}
+
+int main () {
+
+    //synthetic outline block*********//
+
+    // rectangle sampled every half pixel with sub pixel jitter, as traced by a labelling tool
+    std::vector<cam_cad::point> rectangle;
+    const float corners[5][2] = {{100, 100}, {900, 100}, {900, 600}, {100, 600}, {100, 100}};
+    for (int side = 0; side < 4; side++) {
+        float dx = corners[side + 1][0] - corners[side][0], dy = corners[side + 1][1] - corners[side][1];
+        int num_steps = int(2 * std::hypot(dx, dy));
+        for (int i = 0; i < num_steps; i++) {
+            float jitter = 0.2f * std::sin(0.7f * rectangle.size());
+            rectangle.push_back(cam_cad::point(corners[side][0] + dx * i / num_steps + jitter * (dy != 0),
+                                               corners[side][1] + dy * i / num_steps + jitter * (dx != 0)));
+        }
+    }
+
+    std::vector<cam_cad::point> circle;
+    for (int i = 0; i < 10000; i++) {
+        double angle = 2 * M_PI * i / 10000;
+        circle.push_back(cam_cad::point(500 + 200 * std::cos(angle), 400 + 200 * std::sin(angle)));
+    }
+
+    std::vector<cam_cad::point> open_arc(circle.begin(), circle.begin() + 2500);
+
+    checkOutline("rectangle", rectangle, 1, true, 0.99);
+    checkOutline("rectangle", rectangle, 0.25, true, 0.5);
+    checkOutline("circle", circle, 0.5, true, 0.99);
+    checkOutline("circle", circle, 0.05, true, 0.9);
+    checkOutline("open arc", open_arc, 0.5, false, 0.99);
+
+    cam_cad::ImageBuffer image_buffer;
+    std::vector<cam_cad::point> unchanged = circle;
+    check(image_buffer.simplifyPoints(&unchanged, 0) == 0 && unchanged.size() == circle.size(),
+          "zero tolerance keeps every point");
+
+    std::vector<cam_cad::point> segment(circle.begin(), circle.begin() + 2);
+    check(image_buffer.simplifyPoints(&segment, 10) == 0 && segment.size() == 2,
+          "two point outline kept");
+
+    //labelled image block************//
+
+    std::string test_data = CAM_CAD_TEST_DATA_DIR;
+
+    for (std::string labels : {"sim_CAD", "-1.000000_1.000000"}) {
+        std::vector<cam_cad::point> label_points;
+
+        if (!image_buffer.readPoints(test_data + "/labelled_images/" + labels + ".json", &label_points)) {
+            check(false, labels + ": read labels");
+            continue;
+        }
+
+        checkOutline(labels, label_points, 1, true, 0);
+        checkOutline(labels, label_points, 3, true, 0);
+    }
+
+    return checkResult();
+}
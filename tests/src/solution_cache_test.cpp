@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include "SolutionCache.h"
+#include "BatchRunner.h"
+#include "scenario_fixture.h"
+#include "test_check.h"
+#include <Eigen/Dense>
+#include <nlohmann/json.hpp>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Program to test the solution cache (SolutionCache) and its use by the batch runner.
+ * The cache must evict the least recently used solutions, read back exactly what it wrote and
+ * key on the exact initial pose. A batch of a synthetic scenario that is run a second time must
+ * look up every solution with identical poses, and editing one camera label file must only
+ * solve that job again. An unreadable cache file must not fail the batch.
+ * The program returns 1 if any check fails.
+ */
+
+#ifndef CAM_CAD_CONFIG_DIR
+#define CAM_CAD_CONFIG_DIR "config"
+#endif
+
+const std::string TEST_DIR = "/tmp/cam_cad_solution_cache_test";
+
+cam_cad::CachedSolution makeSolution (double value_) {
+    cam_cad::CachedSolution solution;
+    solution.T_CS(0, 3) = value_;
+    solution.T_CS(1, 2) = value_ / 3;
+    solution.converged = true;
+    solution.initial_pixel_error = value_ * 7;
+    solution.final_pixel_error = 1 / value_;
+    solution.solution_iterations = int(value_);
+    return solution;
+}
+
+uint32_t countCached (const std::vector<cam_cad::BatchJobResult>& results_) {
+    uint32_t num_cached = 0;
+    for (auto& result : results_)
+        if (result.cached) num_cached++;
+    return num_cached;
+}
+
+int main () {
+
+    //cache block*********************//
+
+    cam_cad::SolutionCache cache(3);
+    cam_cad::CachedSolution solution;
+
+    check(!cache.Get(1, solution), "empty cache misses");
+
+    for (uint64_t key = 1; key <= 3; key++)
+        cache.Put(key, makeSolution(key + 0.1));
+
+    // 1 becomes the most recently used, so 2 is evicted by 4
+    check(cache.Get(1, solution) && solution.T_CS(0, 3) == 1.1, "cached solution found");
+    cache.Put(4, makeSolution(4.1));
+
+    check(cache.GetSize() == 3 && cache.GetNumEvicted() == 1, "cache holds at most 3 solutions");
+    check(!cache.Get(2, solution), "least recently used solution evicted");
+    check(cache.Get(1, solution) && cache.Get(3, solution) && cache.Get(4, solution),
+          "recently used solutions kept");
+
+    cache.Put(0xfedcba9876543210ULL, makeSolution(M_PI));
+    std::string cache_file = "/tmp/cam_cad_solution_cache_test.json";
+    check(cache.Save(cache_file), "cache saved");
+    check(!std::ifstream(cache_file + ".tmp").is_open(), "temporary cache file renamed");
+    check(!cache.Save(TEST_DIR + "/no_such_directory/cache.json"), "unwritable cache reported");
+
+    cam_cad::SolutionCache loaded(3);
+    check(loaded.Load(cache_file) && loaded.GetSize() == 3, "cache loaded");
+
+    cam_cad::CachedSolution expected = makeSolution(M_PI);
+    bool exact = loaded.Get(0xfedcba9876543210ULL, solution) && solution.T_CS == expected.T_CS &&
+                 solution.initial_pixel_error == expected.initial_pixel_error &&
+                 solution.final_pixel_error == expected.final_pixel_error &&
+                 solution.solution_iterations == expected.solution_iterations && solution.converged;
+    check(exact, "solution read back exactly with a 64 bit key");
+
+    // the least recently used order is kept in the file, 3 was used before 4
+    loaded.Put(5, makeSolution(5.1));
+    check(!loaded.Get(3, solution) && loaded.Get(4, solution), "eviction order kept between runs");
+
+    loaded.SetMaxEntries(1);
+    check(loaded.GetSize() == 1, "smaller limit evicts solutions");
+
+    // damaged entries are skipped, the others are still looked up
+    {
+        std::ofstream damaged_file(cache_file);
+        damaged_file << R"({"solutions": [{"key": "not hex", "T_CS": [1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1]},
+                                          {"key": 7, "T_CS": [1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1]},
+                                          {"key": "8", "T_CS": ["x",0,0,0,0,1,0,0,0,0,1,0,0,0,0,1]},
+                                          {"key": "9", "T_CS": [1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1]}]})";
+    }
+    cam_cad::SolutionCache damaged;
+    check(damaged.Load(cache_file) && damaged.GetSize() == 1 && damaged.Get(9, solution),
+          "damaged entries skipped");
+
+    cam_cad::SolutionCache missing;
+    check(missing.Load(TEST_DIR + "/does_not_exist.json") && missing.GetSize() == 0,
+          "missing cache file is an empty cache");
+    std::remove(cache_file.c_str());
+
+    Eigen::Matrix4d T = Eigen::Matrix4d::Identity();
+    Eigen::Matrix4d T_moved = T;
+    T_moved(2, 3) = std::nextafter(0.0, 1.0);
+    check(cam_cad::SolutionCache::HashTransform(T, 0) != cam_cad::SolutionCache::HashTransform(T_moved, 0),
+          "smallest change of the initial pose changes the key");
+
+    //batch block*********************//
+
+    std::string config_dir = CAM_CAD_CONFIG_DIR;
+
+    cam_cad::ScenarioConfig scenario;
+    scenario.num_images = 4;
+    scenario.camera_model = config_dir + "/Radtan_test.json";
+    scenario.solution_parameters = config_dir + "/SolutionParameters.json";
+    scenario.outlier_rate = 0;
+
+    nlohmann::json manifest;
+    if (!generateScenario(scenario, TEST_DIR, manifest)) {
+        check(false, "scenario generated");
+        return 1;
+    }
+    manifest["solution_cache"] = "solution_cache.json";
+    std::remove((TEST_DIR + "/solution_cache.json").c_str());
+    check(writeManifest(TEST_DIR + "/manifest.json", manifest), "manifest written");
+
+    std::vector<cam_cad::BatchJobResult> first_results;
+    {
+        cam_cad::BatchRunner runner;
+        check(runner.ReadManifest(TEST_DIR + "/manifest.json"), "manifest read");
+        check(runner.Run(), "first run succeeded");
+        first_results = runner.GetResults();
+        check(countCached(first_results) == 0, "first run solves every job");
+        check(runner.GetSolutionCache().GetSize() == scenario.num_images, "every solution cached");
+    }
+
+    {
+        cam_cad::BatchRunner runner;
+        runner.ReadManifest(TEST_DIR + "/manifest.json");
+        check(runner.Run(), "second run succeeded");
+
+        const std::vector<cam_cad::BatchJobResult>& results = runner.GetResults();
+        check(countCached(results) == scenario.num_images, "second run looks up every job");
+
+        bool identical = results.size() == first_results.size();
+        for (size_t i = 0; identical && i < results.size(); i++) {
+            identical = results[i].T_CS == first_results[i].T_CS &&
+                        results[i].converged == first_results[i].converged &&
+                        results[i].solution_iterations == first_results[i].solution_iterations &&
+                        results[i].num_defects == first_results[i].num_defects;
+        }
+        check(identical, "cached results identical to the solved ones");
+    }
+
+    // an edited label file changes the key of its job only
+    std::string edited_labels = TEST_DIR + "/" + manifest["jobs"][0]["camera_labels"].get<std::string>();
+    {
+        std::ofstream labels_file(edited_labels, std::ios::app);
+        labels_file << "\n";
+    }
+
+    {
+        cam_cad::BatchRunner runner;
+        runner.ReadManifest(TEST_DIR + "/manifest.json");
+        check(runner.Run(), "run after the edit succeeded");
+
+        const std::vector<cam_cad::BatchJobResult>& results = runner.GetResults();
+        check(!results[0].cached && countCached(results) == scenario.num_images - 1,
+              "only the edited job is solved again");
+    }
+
+    // an unreadable cache is an empty one and is replaced by the run
+    {
+        std::ofstream cache_out(TEST_DIR + "/solution_cache.json");
+        cache_out << "{\"solutions\": [";
+    }
+
+    {
+        cam_cad::BatchRunner runner;
+        runner.ReadManifest(TEST_DIR + "/manifest.json");
+        check(runner.Run(), "run with an unreadable cache succeeded");
+        check(countCached(runner.GetResults()) == 0, "unreadable cache treated as empty");
+
+        cam_cad::SolutionCache replaced;
+        check(replaced.Load(TEST_DIR + "/solution_cache.json") && replaced.GetSize() == scenario.num_images,
+              "unreadable cache replaced");
+    }
+
+    return checkResult();
+}
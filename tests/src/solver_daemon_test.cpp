@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include "ImageBuffer.h"
+#include "SolverDaemon.h"
+#include "scenario_fixture.h"
+#include "test_check.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <Eigen/Dense>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Program to test the solver daemon (SolverDaemon) on a synthetic scenario. Requests are
+ * answered through HandleRequest: ping, malformed requests, estimate_pose on every image (the
+ * solved translations must be within 2% of the ground truth) and transfer_defects with the true
+ * pose (the transferred defects must match the true CAD defects). The daemon is then served on a
+ * socket, where a stalled request must time out, an oversized request must be refused and a
+ * shutdown request must end Serve. The program returns 1 if any check fails.
+ */
+
+#ifndef CAM_CAD_CONFIG_DIR
+#define CAM_CAD_CONFIG_DIR "config"
+#endif
+
+const std::string TEST_DIR = "/tmp/cam_cad_solver_daemon_test";
+const std::string SOCKET_PATH = "/tmp/cam_cad_solver_daemon_test.sock";
+
+// connects to the daemon socket, -1 on failure
+int connectClient () {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    SOCKET_PATH.copy(address.sun_path, SOCKET_PATH.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (sockaddr*)&address, sizeof(address)) < 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+// reads one response line, an empty object if the daemon closed the connection first
+nlohmann::json readResponse (int fd_) {
+    std::string line;
+    char c;
+    while (read(fd_, &c, 1) == 1 && c != '\n')
+        line += c;
+    return line.empty() ? nlohmann::json::object() : nlohmann::json::parse(line);
+}
+
+bool sendText (int fd_, const std::string& text_) {
+    return send(fd_, text_.data(), text_.size(), MSG_NOSIGNAL) == (ssize_t)text_.size();
+}
+
+int main () {
+
+    std::string config_dir = CAM_CAD_CONFIG_DIR;
+
+    cam_cad::ScenarioConfig scenario;
+    scenario.num_images = 3;
+    scenario.camera_model = config_dir + "/Radtan_test.json";
+    scenario.pixel_noise = 0;
+    scenario.outlier_rate = 0;
+
+    nlohmann::json manifest;
+    if (!generateScenario(scenario, TEST_DIR, manifest)) {
+        check(false, "scenario generated");
+        return 1;
+    }
+
+    cam_cad::SolverDaemon daemon;
+
+    //request block*******************//
+
+    check(daemon.HandleRequest({{"type", "ping"}})["ok"] == true, "ping answered");
+
+    nlohmann::json response = daemon.HandleRequest({{"type", "solve_everything"}});
+    check(response["ok"] == false && response.contains("error"), "unknown request type refused");
+
+    response = daemon.HandleRequest({{"type", "estimate_pose"}, {"CAD_labels", TEST_DIR + "/CAD/CAD_0.json"}});
+    check(response["ok"] == false && response.contains("error"), "request without solution parameters refused");
+
+    nlohmann::json base_request = {{"config", config_dir + "/SolutionParameters.json"},
+                                   {"camera_model", scenario.camera_model},
+                                   {"CAD_labels", TEST_DIR + "/CAD/CAD_0.json"}};
+
+    nlohmann::json no_pose = base_request;
+    no_pose["type"] = "estimate_pose";
+    no_pose["camera_points"] = {{10, 10}, {100, 10}, {100, 100}};
+    response = daemon.HandleRequest(no_pose);
+    check(response["ok"] == false && response.contains("error"), "request without an initial pose refused");
+
+    nlohmann::json short_pose = no_pose;
+    short_pose["T_CS"] = {1, 0, 0};
+    response = daemon.HandleRequest(short_pose);
+    check(response["ok"] == false && response.contains("error"), "T_CS without 16 values refused");
+
+    //solution block******************//
+
+    cam_cad::ImageBuffer image_buffer;
+
+    for (auto& job : manifest["jobs"]) {
+        std::string id = job["id"];
+        Eigen::Matrix4d T_truth = readTransform(job["truth_T_CS"]);
+
+        nlohmann::json request = base_request;
+        request["type"] = "estimate_pose";
+        request["camera_labels"] = TEST_DIR + "/" + job["camera_labels"].get<std::string>();
+        request["T_CS"] = job["T_CS"];
+
+        response = daemon.HandleRequest(request);
+        check(response["ok"] == true && response["converged"] == true && response["T_CS"].size() == 16,
+              id + ": pose estimated");
+        if (response["ok"] != true) continue;
+
+        Eigen::Matrix4d T_CS = readTransform(response["T_CS"]);
+        double translation_error = (T_CS.block(0, 3, 3, 1) - T_truth.block(0, 3, 3, 1)).norm() /
+                                   T_truth.block(0, 3, 3, 1).norm();
+        check(translation_error < 0.02, id + ": translation within 2% of the ground truth (" +
+              std::to_string(100 * translation_error) + "%)");
+
+        // defects transferred with the true pose match the true CAD defects
+        request = base_request;
+        request["type"] = "transfer_defects";
+        request["defect_labels"] = TEST_DIR + "/" + job["defect_labels"].get<std::string>();
+        request["T_CS"] = job["truth_T_CS"];
+
+        response = daemon.HandleRequest(request);
+
+        std::vector<cam_cad::LabelledShape> defects_truth;
+        image_buffer.readShapes(TEST_DIR + "/" + job["truth_defects"].get<std::string>(), &defects_truth);
+
+        bool same_shapes = response["ok"] == true && response["num_dropped_points"] == 0 &&
+                           response["defects"].size() == defects_truth.size();
+        double mean_error = 0;
+        size_t num_points = 0;
+        for (size_t d = 0; same_shapes && d < defects_truth.size(); d++) {
+            const nlohmann::json& points = response["defects"][d]["points"];
+            same_shapes = points.size() == defects_truth[d].points.size();
+            for (size_t p = 0; same_shapes && p < points.size(); p++, num_points++) {
+                mean_error += std::hypot(points[p][0].get<double>() - defects_truth[d].points[p].x,
+                                         points[p][1].get<double>() - defects_truth[d].points[p].y);
+            }
+        }
+        mean_error /= std::max<size_t>(num_points, 1);
+
+        check(same_shapes && mean_error < 2, id + ": transferred defects match the truth (mean " +
+              std::to_string(mean_error) + " CAD px)");
+    }
+
+    //socket block********************//
+
+    daemon.SetRequestLimits(200, 1024);
+    if (!daemon.Start(SOCKET_PATH)) {
+        check(false, "daemon started");
+        return checkResult();
+    }
+
+    std::thread server([&daemon]() { daemon.Serve(); });
+
+    int client = connectClient();
+    check(client >= 0 && sendText(client, "{\"type\": \"ping\"}\n") && readResponse(client)["ok"] == true,
+          "ping answered over the socket");
+    check(sendText(client, "{\"type\": ") && readResponse(client)["error"] == "request timed out",
+          "stalled request timed out");
+    close(client);
+
+    client = connectClient();
+    check(sendText(client, std::string(2000, ' ')) && readResponse(client)["ok"] == false,
+          "oversized request refused");
+    close(client);
+
+    client = connectClient();
+    check(sendText(client, "not json\n") && readResponse(client)["ok"] == false, "malformed json refused");
+    check(sendText(client, "{\"type\": \"shutdown\"}\n") && readResponse(client)["ok"] == true,
+          "shutdown answered");
+    close(client);
+
+    server.join();
+    check(connectClient() < 0, "socket closed after shutdown");
+
+    return checkResult();
+}
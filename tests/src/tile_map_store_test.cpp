@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include "TileMapStore.h"
+#include "AnnotationSession.h"
+#include "test_check.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Program to test the tiled drawing store (TileMapStore) on a blank 300 x 250 drawing
+ * split into 100 pixel tiles (3 x 3 tiles, the bottom row 50 pixels high). Pixels on either side
+ * of a tile boundary must land in their own tiles, a diagonal crack must only rewrite the tiles
+ * it crosses, a line next to a boundary must not rewrite the neighbouring tile, a filled polygon
+ * must also fill the tiles it covers completely, and exported regions and drawings must stitch
+ * the tiles back together. The program returns 1 if any check fails.
+ */
+
+const std::string TEST_DIR = "/tmp/cam_cad_tile_map_store_test";
+
+bool isColor (const cv::Mat& image_, int u_, int v_, cv::Vec3b color_) {
+    cv::Vec3b pixel = image_.at<cv::Vec3b>(v_, u_);
+    return pixel[0] == color_[0] && pixel[1] == color_[1] && pixel[2] == color_[2];
+}
+
+// true if any pixel of the tile has the color
+bool tileHasColor (cam_cad::TileMapStore& store_, uint32_t row_, uint32_t col_, cv::Vec3b color_) {
+    cv::Mat tile;
+    if (!store_.renderTile(row_, col_, tile)) return false;
+    for (int v = 0; v < tile.rows; v++)
+        for (int u = 0; u < tile.cols; u++)
+            if (isColor(tile, u, v, color_)) return true;
+    return false;
+}
+
+int main () {
+
+    std::filesystem::create_directories(TEST_DIR);
+
+    cv::Mat drawing(250, 300, CV_8UC3, cv::Scalar(255, 255, 255));
+    check(cv::imwrite(TEST_DIR + "/drawing.png", drawing), "drawing written");
+
+    cv::Vec3b red = cam_cad::AnnotationSession::getColor("red");
+    cv::Vec3b blue = cam_cad::AnnotationSession::getColor("blue");
+    cv::Vec3b green = cam_cad::AnnotationSession::getColor("green");
+
+    cam_cad::TileMapStore store;
+    check(store.create(TEST_DIR + "/drawing.png", TEST_DIR, 100), "store created");
+    check(store.getRows() == 3 && store.getCols() == 3, "3 x 3 tiles");
+
+    //tile boundary block*************//
+
+    std::vector<cam_cad::point> pixels = {cam_cad::point(99, 99), cam_cad::point(100, 100)};
+    uint32_t writes = store.getNumTileWrites();
+    check(store.addPoints(&pixels, "blue"), "pixels on both sides of a boundary added");
+    check(store.getNumTileWrites() - writes == 2, "one write for each tile of the pixels");
+
+    cv::Mat tile;
+    check(store.renderTile(0, 0, tile) && isColor(tile, 99, 99, blue), "last pixel of tile (0, 0)");
+    check(store.renderTile(1, 1, tile) && isColor(tile, 0, 0, blue), "first pixel of tile (1, 1)");
+    check(store.renderTile(2, 2, tile) && tile.cols == 100 && tile.rows == 50, "edge tile is smaller");
+
+    //crossing shape block************//
+
+    // the diagonal crosses 5 of the 9 tiles of its bounding box
+    std::vector<cam_cad::point> crack = {cam_cad::point(5, 5), cam_cad::point(295, 245)};
+    writes = store.getNumTileWrites();
+    check(store.addPolyline(&crack, "red"), "diagonal crack added");
+    check(store.getNumTileWrites() - writes == 5, "only the crossed tiles written (" +
+          std::to_string(store.getNumTileWrites() - writes) + ")");
+    check(tileHasColor(store, 0, 0, red) && tileHasColor(store, 2, 2, red), "crack drawn at both ends");
+    check(!tileHasColor(store, 2, 0, red) && !tileHasColor(store, 0, 2, red),
+          "tiles off the crack untouched");
+
+    // the thickness margin reaches tile (1, 0), the line does not
+    std::vector<cam_cad::point> edge_line = {cam_cad::point(10, 98), cam_cad::point(90, 98)};
+    writes = store.getNumTileWrites();
+    check(store.addPolyline(&edge_line, "green"), "line next to a boundary added");
+    check(store.getNumTileWrites() - writes == 1 && !tileHasColor(store, 1, 0, green),
+          "neighbouring tile not written");
+
+    std::vector<cam_cad::point> outside = {cam_cad::point(-50, -50), cam_cad::point(-10, -20)};
+    writes = store.getNumTileWrites();
+    check(store.addPolyline(&outside, "red") && store.getNumTileWrites() == writes,
+          "shape outside of the drawing writes nothing");
+
+    //filled shape block**************//
+
+    // the polygon covers tile (1, 1) completely, its outline does not cross it
+    std::vector<cam_cad::point> polygon = {cam_cad::point(50, 50), cam_cad::point(250, 50),
+                                           cam_cad::point(250, 240), cam_cad::point(50, 240)};
+    check(store.addPolygon(&polygon, "green"), "polygon added");
+    check(store.renderTile(1, 1, tile) && isColor(tile, 50, 50, green), "covered tile filled");
+
+    //export block********************//
+
+    check(store.exportRegion(95, 95, 10, 10, TEST_DIR + "/region.png"), "region exported");
+    cv::Mat region = cv::imread(TEST_DIR + "/region.png", 1);
+    check(region.cols == 10 && region.rows == 10, "region has the requested size");
+
+    check(!store.exportRegion(10, 10, 0, 10, TEST_DIR + "/empty.png") &&
+          !store.exportRegion(10, 10, 10, 0, TEST_DIR + "/empty.png"), "empty regions rejected");
+    check(!store.exportRegion(300, 0, 10, 10, TEST_DIR + "/outside.png"), "region outside rejected");
+
+    check(store.exportImage(TEST_DIR + "/annotated.png"), "drawing exported");
+    cv::Mat annotated = cv::imread(TEST_DIR + "/annotated.png", 1);
+    check(annotated.cols == 300 && annotated.rows == 250, "exported drawing has the drawing size");
+    check(isColor(annotated, 150, 150, green) && isColor(annotated, 20, 98, green) &&
+          isColor(annotated, 5, 5, red), "tiles stitched in place");
+
+    //index block*********************//
+
+    check(store.flush(), "index written");
+    cam_cad::TileMapStore reopened;
+    check(reopened.open(TEST_DIR) && reopened.getWidth() == 300 && reopened.getHeight() == 250,
+          "store reopened from its index");
+
+    return checkResult();
+}
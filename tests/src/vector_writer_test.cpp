@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <cstdint>
+#include <iostream>
+#include "VectorWriter.h"
+#include "test_check.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Program to test the vector overlay writer (VectorWriter) by reading back what it wrote.
+ * The SVG and DXF overlays of the same defects must return every vertex without rounding (DXF
+ * with y flipped about the drawing height), keep open and closed outlines apart, escape the SVG
+ * group id and replace the characters DXF does not allow in layer names.
+ * The program returns 1 if any check fails.
+ */
+
+const std::string TEST_DIR = "/tmp";
+
+const uint32_t WIDTH = 640, HEIGHT = 480;
+
+std::string readFile (std::string file_name_) {
+    std::ifstream file(file_name_);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// reads the "x,y x,y ..." points attribute of every svg polyline and polygon
+std::vector<std::vector<cam_cad::point>> readSVG (const std::string& svg_, uint32_t& num_polygons_) {
+    std::vector<std::vector<cam_cad::point>> shapes;
+    num_polygons_ = 0;
+    size_t start = 0;
+
+    while ((start = svg_.find("points=\"", start)) != std::string::npos) {
+        if (svg_.compare(svg_.rfind('<', start), 8, "<polygon") == 0)
+            num_polygons_++;
+
+        start += 8;
+        std::stringstream points(svg_.substr(start, svg_.find('"', start) - start));
+        std::vector<cam_cad::point> shape;
+        float x, y;
+        char comma;
+        while (points >> x >> comma >> y)
+            shape.push_back(cam_cad::point(x, y));
+        shapes.push_back(shape);
+    }
+
+    return shapes;
+}
+
+// reads the vertices of every dxf polyline from its group code / value pairs
+std::vector<std::vector<cam_cad::point>> readDXF (const std::string& dxf_, std::vector<std::string>& layers_,
+                                                  uint32_t& num_closed_) {
+    std::vector<std::vector<cam_cad::point>> shapes;
+    std::stringstream lines(dxf_);
+    std::string code, value, entity;
+    num_closed_ = 0;
+
+    while (std::getline(lines, code) && std::getline(lines, value)) {
+        int group = std::stoi(code);
+        if (group == 0) {
+            entity = value;
+            if (entity == "POLYLINE") shapes.push_back(std::vector<cam_cad::point>());
+            if (entity == "VERTEX") shapes.back().push_back(cam_cad::point(0, 0));
+        }
+        else if (group == 8) {
+            layers_.push_back(value);
+        }
+        else if (entity == "POLYLINE" && group == 70 && value == "1") {
+            num_closed_++;
+        }
+        else if (entity == "VERTEX" && group == 10) {
+            shapes.back().back().x = std::stof(value);
+        }
+        else if (entity == "VERTEX" && group == 20) {
+            shapes.back().back().y = std::stof(value);
+        }
+    }
+
+    return shapes;
+}
+
+int main () {
+
+    std::vector<std::vector<cam_cad::point>> defects = {
+        {cam_cad::point(10.125f, 20.5f), cam_cad::point(300.0625f, 20.5f), cam_cad::point(300.0625f, 400.75f)},
+        {cam_cad::point(1.0f / 3, 2.0f / 3), cam_cad::point(639.999f, 479.001f)}};
+
+    //svg block***********************//
+
+    cam_cad::VectorWriter writer;
+    check(writer.open(TEST_DIR + "/cam_cad_vector_writer_test.svg", WIDTH, HEIGHT, "crack \"A\" & <B>"),
+          "svg opened");
+    check(writer.addPolyline(&defects[0], true) && writer.addPolyline(&defects[1], false, "blue"),
+          "svg defects written");
+    check(writer.getNumDefects() == 2, "svg counts its defects");
+    check(writer.close(), "svg closed");
+
+    std::string svg = readFile(TEST_DIR + "/cam_cad_vector_writer_test.svg");
+    check(svg.find("id=\"crack &quot;A&quot; &amp; &lt;B&gt;\"") != std::string::npos, "svg group id escaped");
+    check(svg.find("width=\"640\" height=\"480\"") != std::string::npos, "svg has the drawing size");
+
+    uint32_t num_polygons;
+    std::vector<std::vector<cam_cad::point>> svg_shapes = readSVG(svg, num_polygons);
+    bool svg_exact = svg_shapes.size() == defects.size();
+    for (size_t i = 0; svg_exact && i < defects.size(); i++) {
+        svg_exact = svg_shapes[i].size() == defects[i].size();
+        for (size_t j = 0; svg_exact && j < defects[i].size(); j++)
+            svg_exact = svg_shapes[i][j].x == defects[i][j].x && svg_shapes[i][j].y == defects[i][j].y;
+    }
+    check(svg_exact, "svg vertices read back exactly");
+    check(num_polygons == 1, "closed outline written as an svg polygon");
+
+    //dxf block***********************//
+
+    check(writer.open(TEST_DIR + "/cam_cad_vector_writer_test.dxf", WIDTH, HEIGHT, "crack<A>/B:\"1\"\n"),
+          "dxf opened");
+    check(writer.addPolyline(&defects[0], true) && writer.addPolyline(&defects[1], false),
+          "dxf defects written");
+    check(writer.close(), "dxf closed");
+
+    std::string dxf = readFile(TEST_DIR + "/cam_cad_vector_writer_test.dxf");
+    std::string dxf_end = "0\nENDSEC\n0\nEOF\n";
+    check(dxf.size() > dxf_end.size() && dxf.compare(dxf.size() - dxf_end.size(), dxf_end.size(), dxf_end) == 0,
+          "dxf ends with EOF");
+
+    std::vector<std::string> layers;
+    uint32_t num_closed;
+    std::vector<std::vector<cam_cad::point>> dxf_shapes = readDXF(dxf, layers, num_closed);
+
+    bool layers_sanitized = !layers.empty();
+    for (auto& layer : layers)
+        layers_sanitized &= layer == "crack_A__B__1__";
+    check(layers_sanitized, "dxf layer name sanitized (" + (layers.empty() ? "" : layers[0]) + ")");
+
+    bool dxf_exact = dxf_shapes.size() == defects.size();
+    for (size_t i = 0; dxf_exact && i < defects.size(); i++) {
+        dxf_exact = dxf_shapes[i].size() == defects[i].size();
+        for (size_t j = 0; dxf_exact && j < defects[i].size(); j++)
+            dxf_exact = dxf_shapes[i][j].x == defects[i][j].x &&
+                        dxf_shapes[i][j].y == (float)HEIGHT - defects[i][j].y;
+    }
+    check(dxf_exact, "dxf vertices read back exactly with y flipped");
+    check(num_closed == 1, "closed outline flagged in the dxf");
+
+    check(!writer.open(TEST_DIR + "/cam_cad_vector_writer_test.pdf", WIDTH, HEIGHT), "unsupported format rejected");
+
+    return checkResult();
+}